@@ -0,0 +1,125 @@
+#ifndef ASSETCACHE_HPP
+#define ASSETCACHE_HPP
+
+#include "Common.hpp"
+
+#include <functional>
+
+// 같은 Key(정규화한 경로 + Load 옵션)의 Asset을 하나만 만들어 공유한다.
+// Cache는 weak_ptr만 들고 있으므로 마지막 사용자가 놓으면 Asset은 바로 해제된다.
+// T는 GetMemorySize()를 제공해야 한다. (Stats의 GPU 메모리 합계에 사용)
+template <typename T>
+class AssetCache
+{
+public:
+    using AssetSPtr = std::shared_ptr<T>;
+    using Loader = std::function<AssetSPtr(void)>;
+
+    struct Stats {
+        size_t  hits { 0 };
+        size_t  misses { 0 };
+        size_t  liveCount { 0 };
+        size_t  memorySize { 0 };   // 살아 있는 Asset이 잡고 있는 byte
+    };
+
+    static AssetCache&  Get(void);
+    // 경로를 정규화해서 "./a/../b.png"와 "b.png"가 같은 Key가 되도록 한다.
+    static std::string  MakeKey(const std::string& path, uint32_t flags = 0);
+
+    // Cache에 살아 있으면 그대로, 없으면 loader로 만들어 등록한다. (실패하면 nullptr, 등록하지 않는다.)
+    AssetSPtr   Load(const std::string& key, const Loader& loader);
+    AssetSPtr   Find(const std::string& key) const;
+    // 이미 해제된 Asset의 Entry를 지운다.
+    void        Prune(void);
+    // liveCount / memorySize는 호출 시점에 계산한다.
+    Stats       GetStats(void);
+private:
+    std::unordered_map<std::string, std::weak_ptr<T>>   m_entries;
+    size_t      m_hits { 0 };
+    size_t      m_misses { 0 };
+
+    AssetCache() {};
+};
+
+template <typename T>
+AssetCache<T>&  AssetCache<T>::Get(void)
+{
+    static AssetCache<T>    instance;
+    return (instance);
+};
+
+template <typename T>
+std::string AssetCache<T>::MakeKey(const std::string& path, uint32_t flags)
+{
+    std::string     normalized = path;
+    std::replace(normalized.begin(), normalized.end(), '\\', '/');
+    std::error_code ec;
+    auto    absolute = std::filesystem::absolute(normalized, ec);
+    if (!ec)
+    {
+        auto    canonical = std::filesystem::weakly_canonical(absolute, ec);
+        normalized = (ec ? absolute : canonical).lexically_normal().generic_string();
+    }
+    return (normalized + "|" + std::to_string(flags));
+};
+
+template <typename T>
+typename AssetCache<T>::AssetSPtr   AssetCache<T>::Load(const std::string& key, const Loader& loader)
+{
+    auto    iter = this->m_entries.find(key);
+    if (iter != this->m_entries.end())
+    {
+        if (AssetSPtr asset = iter->second.lock())
+        {
+            ++this->m_hits;
+            return (asset);
+        }
+    }
+
+    ++this->m_misses;
+    AssetSPtr   asset = loader();
+    if (asset)
+        this->m_entries[key] = asset;
+    return (asset);
+};
+
+template <typename T>
+typename AssetCache<T>::AssetSPtr   AssetCache<T>::Find(const std::string& key) const
+{
+    auto    iter = this->m_entries.find(key);
+    if (iter == this->m_entries.end())
+        return (nullptr);
+    return (iter->second.lock());
+};
+
+template <typename T>
+void    AssetCache<T>::Prune(void)
+{
+    for (auto iter = this->m_entries.begin(); iter != this->m_entries.end();)
+    {
+        if (iter->second.expired())
+            iter = this->m_entries.erase(iter);
+        else
+            ++iter;
+    }
+};
+
+template <typename T>
+typename AssetCache<T>::Stats   AssetCache<T>::GetStats(void)
+{
+    Prune();
+    Stats   stats;
+    stats.hits = this->m_hits;
+    stats.misses = this->m_misses;
+    for (auto& entry : this->m_entries)
+    {
+        if (AssetSPtr asset = entry.second.lock())
+        {
+            ++stats.liveCount;
+            stats.memorySize += asset->GetMemorySize();
+        }
+    }
+    return (stats);
+};
+
+#endif
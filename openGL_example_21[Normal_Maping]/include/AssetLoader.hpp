@@ -0,0 +1,431 @@
+#ifndef ASSETLOADER_HPP
+#define ASSETLOADER_HPP
+
+#include "Common.hpp"
+#include "ThreadPool.hpp"
+#include "Texture.hpp"
+#include "CubeTexture.hpp"
+#include "PixelUploadRing.hpp"
+
+#include <atomic>
+#include <functional>
+#include <deque>
+
+// Image Decode(stbi_load 등 CPU 작업)는 ThreadPool의 Worker에서 하고,
+// GL Upload는 Render Loop에서 Update(budget)로 프레임마다 정해진 시간만큼만 처리한다.
+// Upload가 끝나기 전까지는 Placeholder Texture가 대신 쓰인다.
+// Upload는 PixelUploadRing(Staging PBO)을 거치므로 GPU 복사는 Rendering과 겹쳐서 진행된다.
+CLASS_PTR(AssetLoader);
+class AssetLoader
+{
+public:
+    // Main Thread에서 호출된다. Decode에 실패한 Image는 nullptr
+    using UploadFunc = std::function<void(std::vector<ImageUPtr>& images)>;
+
+    // ringSize : Staging PBO 크기. 이보다 큰 Image는 glTexImage2D로 바로 올린다.
+    static AssetLoaderUPtr  Create(ThreadPool* pool = nullptr, size_t ringSize = 32 * 1024 * 1024);
+    // 아직 Decode 중인 작업이 끝날 때까지 기다린 뒤 해제한다.
+    ~AssetLoader();
+
+    // filepaths를 각각 Worker에서 Decode하고, 모두 끝나면 Update()에서 upload를 호출한다.
+    void            LoadImages(const std::vector<std::string>& filepaths, bool flipVertical, UploadFunc upload);
+    // work는 Worker에서, 그 뒤 upload는 Update()에서 호출한다. (Decode 외의 CPU 작업용)
+    void            Run(std::function<void(void)> work, std::function<void(void)> upload);
+    // placeholderColor 4x4 Texture를 바로 돌려주고, Decode가 끝나면 같은 Object에 실제 Image를 올린다.
+    // Mip Chain도 Worker에서 만들어(sRGB -> Linear 평균) 모든 Level을 한 번에 올린다.
+    // Texture::Load와 같은 AssetCache Key를 쓰므로 같은 파일은 한 번만 읽는다. (.ktx2는 mmap 후 그대로 올린다.)
+    // alphaCutoff는 LoadCompressedTexture와 같다.
+    TextureSPtr     LoadTexture(const std::string& filepath, bool flipVertical = true,
+                                const glm::vec4& placeholderColor = glm::vec4(0.5f, 0.5f, 0.5f, 1.0f),
+                                float alphaCutoff = 0.0f);
+    // Worker에서 CompressedImage::Load(Decode + Mip + Block 압축 또는 KTX2 Cache)까지 하고 압축된 채로 올린다.
+    // alphaCutoff : Alpha Test를 하는 Texture(grass)의 기준값. Mip의 Alpha Coverage를 원본과 맞춘다.
+    // 압축 형식을 지원하지 않으면 LoadTexture와 같다.
+    TextureSPtr     LoadCompressedTexture(const std::string& filepath, bool flipVertical = true, bool normalMap = false,
+                                        const glm::vec4& placeholderColor = glm::vec4(0.5f, 0.5f, 0.5f, 1.0f),
+                                        float alphaCutoff = 0.0f);
+    CubeTextureSPtr LoadCubeTexture(const std::vector<std::string>& filepaths, bool flipVertical = false,
+                                    const glm::vec4& placeholderColor = glm::vec4(0.5f, 0.5f, 0.5f, 1.0f));
+    // Face 6개짜리 KTX2 한 파일을 읽는다. sourcePaths가 있으면 KTX2가 없거나 원본이 바뀌었을 때
+    // 6면을 Decode 해서 ktxPath로 다시 만든다. (다음 실행부터는 한 파일만 mmap)
+    CubeTextureSPtr LoadKtxCubeTexture(const std::string& ktxPath, const std::vector<std::string>& sourcePaths,
+                                        bool flipVertical = false,
+                                        const glm::vec4& placeholderColor = glm::vec4(0.5f, 0.5f, 0.5f, 1.0f));
+
+    // Render Loop에서 매 프레임 호출. budgetMs를 넘기면 다음 프레임으로 미룬다. (최소 1개는 처리)
+    uint32_t        Update(double budgetMs);
+    // Decode 중이거나 Upload를 기다리는 요청 수
+    uint32_t        GetPendingCount(void) const
+    { return (this->m_pending.load()); };
+    const PixelUploadRing*  GetUploadRing(void) const
+    { return (this->m_ring.get()); };
+
+    // CPU Mip Chain과 glGenerateMipmap 비교용 (BenchmarkMipmap, LoadTexture)
+    struct MipmapStats {
+        uint32_t    cpuCount { 0 };
+        double      cpuMs { 0.0 };      // Worker에서 Image::CreateMipChain에 걸린 시간 합
+        double      cpuMegapixels { 0.0 };
+        uint32_t    glCount { 0 };
+        double      glMs { 0.0 };       // glGenerateMipmap의 GPU 시간 합 (GL_TIME_ELAPSED)
+        double      glMegapixels { 0.0 };
+    };
+    // filepath를 한 번 Decode 해서 CPU Mip Chain과 glGenerateMipmap을 각각 한 번씩 돌려 Stats에 더한다.
+    // (AssetCache를 거치지 않는 임시 Texture)
+    void                BenchmarkMipmap(const std::string& filepath);
+    const MipmapStats&  GetMipmapStats(void) const
+    { return (this->m_mipmapStats); };
+private:
+    struct Request {
+        std::vector<ImageUPtr>  images;
+        UploadFunc              upload;
+        std::atomic<uint32_t>   remaining { 0 };
+        Request*                next { nullptr };
+    };
+
+    ThreadPool*             m_pool { nullptr };
+    // Worker -> Main Thread. Lock-Free Stack에 쌓고 Main Thread가 한 번에 떼어 간다.
+    std::atomic<Request*>   m_ready { nullptr };
+    // Main Thread 전용. Upload 순서는 완료 순서(FIFO)
+    std::deque<Request*>    m_uploads;
+    std::atomic<uint32_t>   m_pending { 0 };
+    std::atomic<uint32_t>   m_decoding { 0 };
+    PixelUploadRingUPtr     m_ring;
+    // PBO에서 복사가 끝날 시간을 주기 위해 Mipmap은 다음 Update에서 만든다.
+    std::vector<TextureSPtr>    m_mipmapQueue;
+    MipmapStats                 m_mipmapStats;
+    // glGenerateMipmap 묶음마다 GPU 시간 Query. 결과가 나오면 Stats에 더한다.
+    struct MipmapQuery {
+        uint32_t    query;
+        uint32_t    count;
+        double      megapixels;
+    };
+    std::deque<MipmapQuery>     m_mipmapQueries;
+
+    // Worker에서 Decode + CPU Mip Chain
+    struct MipChainResult {
+        ImageUPtr               image;
+        std::vector<ImageUPtr>  mips;
+        double                  ms { 0.0 };
+
+        void    Load(const std::string& filepath, bool flipVertical, float alphaCutoff = 0.0f)
+        {
+            image = Image::Load(filepath, flipVertical);
+            if (!image)
+                return ;
+            auto    start = std::chrono::steady_clock::now();
+            mips = image->CreateMipChain(MIP_FILTER_SRGB, alphaCutoff);
+            ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        };
+    };
+
+    AssetLoader() {};
+    void    UploadMipChain(Texture* texture, const MipChainResult& result);
+    void    PushReady(Request* request);
+    void    DrainReady(void);
+};
+
+AssetLoaderUPtr AssetLoader::Create(ThreadPool* pool, size_t ringSize)
+{
+    AssetLoaderUPtr loader = AssetLoaderUPtr(new AssetLoader());
+    loader->m_pool = pool ? pool : &ThreadPool::Get();
+    // Ring을 만들지 못하면 Client Memory에서 바로 올린다.
+    loader->m_ring = PixelUploadRing::Create(ringSize);
+    return (std::move(loader));
+};
+
+AssetLoader::~AssetLoader()
+{
+    while (this->m_decoding.load() > 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    DrainReady();
+    for (auto request : this->m_uploads)
+        delete request;
+    for (auto& query : this->m_mipmapQueries)
+        glDeleteQueries(1, &query.query);
+};
+
+void    AssetLoader::LoadImages(const std::vector<std::string>& filepaths, bool flipVertical, UploadFunc upload)
+{
+    Request*    request = new Request();
+    request->images.resize(filepaths.size());
+    request->upload = std::move(upload);
+    request->remaining = static_cast<uint32_t>(filepaths.size());
+    ++this->m_pending;
+    if (filepaths.empty())
+    {
+        PushReady(request);
+        return ;
+    }
+
+    this->m_decoding += static_cast<uint32_t>(filepaths.size());
+    // 면 / 파일마다 따로 Submit -> Skybox 6면도 동시에 Decode 된다.
+    for (size_t i = 0; i < filepaths.size(); ++i)
+    {
+        this->m_pool->Submit([this, request, i, filepath = filepaths[i], flipVertical]()
+        {
+            request->images[i] = Image::Load(filepath, flipVertical);
+            if (--request->remaining == 0)
+                PushReady(request);
+            --this->m_decoding;
+        });
+    }
+};
+
+void    AssetLoader::Run(std::function<void(void)> work, std::function<void(void)> upload)
+{
+    Request*    request = new Request();
+    request->upload = [upload = std::move(upload)](std::vector<ImageUPtr>&) { upload(); };
+    ++this->m_pending;
+    ++this->m_decoding;
+    this->m_pool->Submit([this, request, work = std::move(work)]()
+    {
+        work();
+        PushReady(request);
+        --this->m_decoding;
+    });
+};
+
+TextureSPtr AssetLoader::LoadTexture(const std::string& filepath, bool flipVertical,
+                                    const glm::vec4& placeholderColor, float alphaCutoff)
+{
+    // alphaCutoff가 없으면 Texture::Load와 같은 Key
+    uint32_t    flags = (flipVertical ? TEXTURE_LOAD_FLIP : 0)
+                        | (static_cast<uint32_t>(alphaCutoff * 255.0f + 0.5f) << TEXTURE_LOAD_ALPHA_CUTOFF_SHIFT);
+    return (AssetCache<Texture>::Get().Load(AssetCache<Texture>::MakeKey(filepath, flags),
+        [&]() -> TextureSPtr
+        {
+            TextureSPtr texture = Texture::CreateFromImage(
+                                    Image::CreateSingleColorImage(4, 4, placeholderColor).get());
+            if (std::filesystem::path(filepath).extension() == ".ktx2")
+            {
+                auto    result = std::make_shared<KtxImageUPtr>();
+                Run([result, filepath]() { *result = KtxImage::Load(filepath); },
+                    [this, texture, result]()
+                    {
+                        if (*result && (*result)->GetFaceCount() == 1)
+                            texture->SetImage(result->get(), this->m_ring.get());
+                    });
+                return (texture);
+            }
+            auto    result = std::make_shared<MipChainResult>();
+            Run([result, filepath, flipVertical, alphaCutoff]() { result->Load(filepath, flipVertical, alphaCutoff); },
+                [this, texture, result]()
+                {
+                    if (result->image)
+                        UploadMipChain(texture.get(), *result);
+                });
+            return (texture);
+        }));
+};
+
+TextureSPtr AssetLoader::LoadCompressedTexture(const std::string& filepath, bool flipVertical, bool normalMap,
+                                            const glm::vec4& placeholderColor, float alphaCutoff)
+{
+    if (!normalMap && !GLAD_GL_EXT_texture_compression_s3tc)
+        return (LoadTexture(filepath, flipVertical, placeholderColor, alphaCutoff));
+    // alphaCutoff가 없으면 Texture::LoadCompressed와 같은 Key
+    uint32_t    flags = TEXTURE_LOAD_COMPRESSED | (flipVertical ? TEXTURE_LOAD_FLIP : 0)
+                        | (normalMap ? TEXTURE_LOAD_NORMAL_MAP : 0)
+                        | (static_cast<uint32_t>(alphaCutoff * 255.0f + 0.5f) << TEXTURE_LOAD_ALPHA_CUTOFF_SHIFT);
+    return (AssetCache<Texture>::Get().Load(AssetCache<Texture>::MakeKey(filepath, flags),
+        [&]() -> TextureSPtr
+        {
+            TextureSPtr texture = Texture::CreateFromImage(
+                                    Image::CreateSingleColorImage(4, 4, placeholderColor).get());
+            // 압축(Block 행 단위 ParallelFor)도 Worker 안에서 돈다.
+            auto        result = std::make_shared<CompressedImageUPtr>();
+            Run([result, filepath, flipVertical, normalMap, alphaCutoff]()
+                { *result = CompressedImage::Load(filepath, flipVertical, normalMap, alphaCutoff); },
+                [this, texture, result]()
+                {
+                    if (*result && BlockCompressor::IsSupported((*result)->GetFormat()))
+                        texture->SetCompressedImage(result->get(), this->m_ring.get());
+                });
+            return (texture);
+        }));
+};
+
+CubeTextureSPtr AssetLoader::LoadCubeTexture(const std::vector<std::string>& filepaths, bool flipVertical,
+                                            const glm::vec4& placeholderColor)
+{
+    ImageUPtr           placeholder = Image::CreateSingleColorImage(1, 1, placeholderColor);
+    std::vector<Image*> faces(filepaths.size(), placeholder.get());
+    CubeTextureSPtr     texture = CubeTexture::CreateFromImages(faces);
+    if (!texture)
+        return (nullptr);
+    LoadImages(filepaths, flipVertical, [this, texture](std::vector<ImageUPtr>& images)
+    {
+        std::vector<Image*> faces;
+        for (auto& image : images)
+            faces.push_back(image.get());
+        texture->SetImages(faces, this->m_ring.get());
+    });
+    return (texture);
+};
+
+CubeTextureSPtr AssetLoader::LoadKtxCubeTexture(const std::string& ktxPath, const std::vector<std::string>& sourcePaths,
+                                                bool flipVertical, const glm::vec4& placeholderColor)
+{
+    ImageUPtr           placeholder = Image::CreateSingleColorImage(1, 1, placeholderColor);
+    std::vector<Image*> faces(6, placeholder.get());
+    CubeTextureSPtr     texture = CubeTexture::CreateFromImages(faces);
+    if (!texture)
+        return (nullptr);
+
+    struct Result {
+        KtxImageUPtr            ktx;
+        std::vector<ImageUPtr>  images;     // KTX2를 쓰지 못했을 때만 사용
+    };
+    auto    result = std::make_shared<Result>();
+    Run([this, result, ktxPath, sourcePaths, flipVertical]()
+    {
+        std::string stamp = KtxImage::MakeSourceStamp(sourcePaths);
+        result->ktx = KtxImage::Load(ktxPath);
+        if (result->ktx && result->ktx->GetFaceCount() == 6
+            && (sourcePaths.empty() || result->ktx->GetValue("SourceStamp") == stamp))
+            return ;
+        result->ktx.reset();
+        if (sourcePaths.size() != 6)
+            return ;
+
+        // 6면은 이 Worker와 다른 Worker가 나눠서 Decode 한다.
+        result->images.resize(6);
+        this->m_pool->ParallelFor(6, 1, [&](uint32_t, size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+                result->images[i] = Image::Load(sourcePaths[i], flipVertical);
+        });
+        std::vector<const Image*>   faces;
+        for (auto& image : result->images)
+        {
+            if (!image)
+                return ;
+            faces.push_back(image.get());
+        }
+        KtxImage::KeyValues keyValues = { { "KTXorientation", flipVertical ? "ru" : "rd" } };
+        if (!stamp.empty())
+            keyValues["SourceStamp"] = stamp;
+        // 다시 mmap 해서 다음 실행과 같은 경로로 올린다.
+        if (KtxImage::Write(ktxPath, faces, false, keyValues))
+        {
+            std::cout << "Cube map baked to ktx2: " << ktxPath << std::endl;
+            result->ktx = KtxImage::Load(ktxPath);
+        }
+    },
+    [this, texture, result]()
+    {
+        if (result->ktx)
+            texture->SetImages(result->ktx.get(), this->m_ring.get());
+        else if (result->images.size() == 6)
+        {
+            std::vector<Image*> faces;
+            for (auto& image : result->images)
+                faces.push_back(image.get());
+            texture->SetImages(faces, this->m_ring.get());
+        }
+    });
+    return (texture);
+};
+
+void    AssetLoader::UploadMipChain(Texture* texture, const MipChainResult& result)
+{
+    std::vector<const Image*>   levels { result.image.get() };
+    for (auto& mip : result.mips)
+        levels.push_back(mip.get());
+    texture->SetImageLevels(levels, this->m_ring.get());
+    ++this->m_mipmapStats.cpuCount;
+    this->m_mipmapStats.cpuMs += result.ms;
+    this->m_mipmapStats.cpuMegapixels += double(texture->GetWidth()) * texture->GetHeight() / 1e6;
+};
+
+void    AssetLoader::BenchmarkMipmap(const std::string& filepath)
+{
+    auto    result = std::make_shared<MipChainResult>();
+    Run([result, filepath]() { result->Load(filepath, true); },
+        [this, result]()
+        {
+            if (!result->image)
+                return ;
+            auto    placeholder = Image::CreateSingleColorImage(4, 4, glm::vec4(0.0f));
+            TextureSPtr cpuTexture = Texture::CreateFromImage(placeholder.get());
+            UploadMipChain(cpuTexture.get(), *result);
+            // Level 0만 올리고 다음 Update에서 GL_TIME_ELAPSED로 잰다. (Queue가 들고 있다가 놓는다.)
+            TextureSPtr glTexture = Texture::CreateFromImage(placeholder.get());
+            glTexture->SetImage(result->image.get(), this->m_ring.get(), false);
+            this->m_mipmapQueue.push_back(glTexture);
+        });
+};
+
+void    AssetLoader::PushReady(Request* request)
+{
+    request->next = this->m_ready.load(std::memory_order_relaxed);
+    while (!this->m_ready.compare_exchange_weak(request->next, request,
+                                                std::memory_order_release, std::memory_order_relaxed))
+        ;
+};
+
+void    AssetLoader::DrainReady(void)
+{
+    // Stack은 최근에 끝난 것이 위에 있으므로 뒤집어서 완료 순서대로 넣는다.
+    Request*    head = this->m_ready.exchange(nullptr, std::memory_order_acquire);
+    size_t      start = this->m_uploads.size();
+    for (; head; head = head->next)
+        this->m_uploads.insert(this->m_uploads.begin() + start, head);
+};
+
+uint32_t    AssetLoader::Update(double budgetMs)
+{
+    // 이전 프레임들의 glGenerateMipmap 시간 (끝난 것만)
+    while (!this->m_mipmapQueries.empty())
+    {
+        auto&   query = this->m_mipmapQueries.front();
+        int     available = 0;
+        glGetQueryObjectiv(query.query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            break;
+        GLuint64    elapsed = 0;
+        glGetQueryObjectui64v(query.query, GL_QUERY_RESULT, &elapsed);
+        this->m_mipmapStats.glCount += query.count;
+        this->m_mipmapStats.glMs += elapsed / 1e6;
+        this->m_mipmapStats.glMegapixels += query.megapixels;
+        glDeleteQueries(1, &query.query);
+        this->m_mipmapQueries.pop_front();
+    }
+    if (!this->m_mipmapQueue.empty())
+    {
+        MipmapQuery query { 0, static_cast<uint32_t>(this->m_mipmapQueue.size()), 0.0 };
+        glGenQueries(1, &query.query);
+        glBeginQuery(GL_TIME_ELAPSED, query.query);
+        for (auto& texture : this->m_mipmapQueue)
+        {
+            texture->GenerateMipmap();
+            query.megapixels += double(texture->GetWidth()) * texture->GetHeight() / 1e6;
+        }
+        glEndQuery(GL_TIME_ELAPSED);
+        this->m_mipmapQueries.push_back(query);
+        this->m_mipmapQueue.clear();
+    }
+
+    DrainReady();
+    auto        start = std::chrono::steady_clock::now();
+    uint32_t    uploaded = 0;
+    while (!this->m_uploads.empty())
+    {
+        double  elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (uploaded > 0 && elapsed >= budgetMs)
+            break;
+        Request*    request = this->m_uploads.front();
+        this->m_uploads.pop_front();
+        if (request->upload)
+            request->upload(request->images);
+        delete request;
+        --this->m_pending;
+        ++uploaded;
+    }
+    // 이번 프레임에 Staging Buffer를 읽는 명령을 모두 냈으므로 한 구간으로 묶는다.
+    if (this->m_ring)
+        this->m_ring->Fence();
+    return (uploaded);
+};
+
+#endif
@@ -0,0 +1,565 @@
+#ifndef BLOCKCOMPRESSOR_HPP
+#define BLOCKCOMPRESSOR_HPP
+
+#include "Common.hpp"
+#include "ThreadPool.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# include <emmintrin.h>
+# define BLOCK_COMPRESSOR_SSE2
+#endif
+
+// GPU Block 압축 형식 (4x4 Pixel 단위)
+enum BlockFormat : uint32_t {
+    BLOCK_FORMAT_BC1 = 1,   // RGB 565 Endpoint 2개 + 2bit Index        : 8 byte  (불투명 색)
+    BLOCK_FORMAT_BC3 = 3,   // BC4 Alpha + BC1 색                        : 16 byte (Alpha가 있는 색)
+    BLOCK_FORMAT_BC5 = 5,   // BC4 R + BC4 G                             : 16 byte (Tangent Space Normal)
+};
+
+// CPU Block 압축기.
+// BC1 : 주성분 축으로 Endpoint를 잡고 Index를 정한 뒤 최소제곱으로 Endpoint를 한 번 다시 맞춘다.
+// BC4 : 8단계 Mode로 min / max를 Endpoint로 쓴다. (BC3 Alpha, BC5 R / G)
+// Block 행 단위로 ThreadPool에 나눠 압축한다.
+class BlockCompressor
+{
+public:
+    static size_t       GetBlockSize(BlockFormat format)
+    { return (format == BLOCK_FORMAT_BC1 ? 8 : 16); };
+    static size_t       GetCompressedSize(BlockFormat format, int width, int height)
+    { return (static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * GetBlockSize(format)); };
+    static uint32_t     GetGLFormat(BlockFormat format);
+    static const char*  GetName(BlockFormat format);
+    // BC1 / BC3는 EXT_texture_compression_s3tc가 필요하다. (BC5 = RGTC는 Core)
+    static bool         IsSupported(BlockFormat format);
+    // Normal Map -> BC5, Alpha가 255가 아닌 Pixel이 있으면 BC3, 아니면 BC1
+    static BlockFormat  ChooseFormat(const uint8_t* pixels, int width, int height, int channelCount,
+                                    bool normalMap);
+
+    // pixels(width x height x channelCount)를 압축해 out에 채운다. (out은 GetCompressedSize 크기)
+    static void     Compress(const uint8_t* pixels, int width, int height, int channelCount,
+                            BlockFormat format, uint8_t* out, bool parallel = true);
+    // 압축 결과를 다시 풀어 원본과 비교한다. (형식이 쓰는 Channel만, 8bit 기준 dB)
+    static float    ComputePSNR(const uint8_t* pixels, int width, int height, int channelCount,
+                                BlockFormat format, const uint8_t* compressed);
+
+    static void     EncodeBC1(const uint8_t rgba[64], uint8_t out[8]);
+    static void     EncodeBC4(const uint8_t values[16], uint8_t out[8]);
+    static void     DecodeBC1(const uint8_t block[8], uint8_t rgba[64]);
+    static void     DecodeBC4(const uint8_t block[8], uint8_t values[16]);
+private:
+    static void     FetchBlock(const uint8_t* pixels, int width, int height, int channelCount,
+                                int blockX, int blockY, uint8_t rgba[64]);
+    static void     EncodeBlock(const uint8_t rgba[64], BlockFormat format, uint8_t* out);
+    static void     DecodeBlock(const uint8_t* block, BlockFormat format, uint8_t rgba[64]);
+
+    static uint16_t PackColor565(const float color[3]);
+    static void     UnpackColor565(uint16_t color, float out[3]);
+    static void     ComputeBC1Indices(const float r[16], const float g[16], const float b[16],
+                                    const float color0[3], const float color1[3], uint8_t indices[16]);
+    static float    ComputeBC1Error(const uint8_t rgba[64], uint16_t color0, uint16_t color1,
+                                    const uint8_t indices[16]);
+};
+
+uint32_t    BlockCompressor::GetGLFormat(BlockFormat format)
+{
+    switch (format)
+    {
+    case BLOCK_FORMAT_BC1: return (GL_COMPRESSED_RGB_S3TC_DXT1_EXT);
+    case BLOCK_FORMAT_BC3: return (GL_COMPRESSED_RGBA_S3TC_DXT5_EXT);
+    default: return (GL_COMPRESSED_RG_RGTC2);
+    }
+};
+
+const char* BlockCompressor::GetName(BlockFormat format)
+{
+    switch (format)
+    {
+    case BLOCK_FORMAT_BC1: return ("BC1");
+    case BLOCK_FORMAT_BC3: return ("BC3");
+    default: return ("BC5");
+    }
+};
+
+bool    BlockCompressor::IsSupported(BlockFormat format)
+{
+    if (format == BLOCK_FORMAT_BC5)
+        return (true);
+    return (GLAD_GL_EXT_texture_compression_s3tc != 0);
+};
+
+BlockFormat BlockCompressor::ChooseFormat(const uint8_t* pixels, int width, int height, int channelCount,
+                                        bool normalMap)
+{
+    if (normalMap)
+        return (BLOCK_FORMAT_BC5);
+    if (channelCount == 4)
+    {
+        size_t  count = static_cast<size_t>(width) * height;
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (pixels[i * 4 + 3] != 255)
+                return (BLOCK_FORMAT_BC3);
+        }
+    }
+    return (BLOCK_FORMAT_BC1);
+};
+
+void    BlockCompressor::Compress(const uint8_t* pixels, int width, int height, int channelCount,
+                                BlockFormat format, uint8_t* out, bool parallel)
+{
+    int     blocksX = (width + 3) / 4;
+    int     blocksY = (height + 3) / 4;
+    size_t  blockSize = GetBlockSize(format);
+    auto    compressRows = [&](uint32_t, size_t begin, size_t end)
+    {
+        uint8_t rgba[64];
+        for (size_t by = begin; by < end; ++by)
+        {
+            for (int bx = 0; bx < blocksX; ++bx)
+            {
+                FetchBlock(pixels, width, height, channelCount, bx, static_cast<int>(by), rgba);
+                EncodeBlock(rgba, format, out + (by * blocksX + bx) * blockSize);
+            }
+        }
+    };
+    if (parallel)
+        ThreadPool::Get().ParallelFor(blocksY, 4, compressRows);
+    else
+        compressRows(0, 0, blocksY);
+};
+
+float   BlockCompressor::ComputePSNR(const uint8_t* pixels, int width, int height, int channelCount,
+                                    BlockFormat format, const uint8_t* compressed)
+{
+    int     blocksX = (width + 3) / 4;
+    int     blocksY = (height + 3) / 4;
+    size_t  blockSize = GetBlockSize(format);
+    int     firstChannel = 0;
+    int     channelEnd = format == BLOCK_FORMAT_BC1 ? 3 : (format == BLOCK_FORMAT_BC3 ? 4 : 2);
+
+    double  squaredError = 0.0;
+    size_t  samples = 0;
+    uint8_t source[64], decoded[64];
+    for (int by = 0; by < blocksY; ++by)
+    {
+        for (int bx = 0; bx < blocksX; ++bx)
+        {
+            FetchBlock(pixels, width, height, channelCount, bx, by, source);
+            DecodeBlock(compressed + (static_cast<size_t>(by) * blocksX + bx) * blockSize, format, decoded);
+            // Image 밖으로 채운 부분은 빼고 계산한다.
+            int w = std::min(4, width - bx * 4);
+            int h = std::min(4, height - by * 4);
+            for (int y = 0; y < h; ++y)
+            {
+                for (int x = 0; x < w; ++x)
+                {
+                    for (int c = firstChannel; c < channelEnd; ++c)
+                    {
+                        double  diff = double(source[(y * 4 + x) * 4 + c]) - double(decoded[(y * 4 + x) * 4 + c]);
+                        squaredError += diff * diff;
+                        ++samples;
+                    }
+                }
+            }
+        }
+    }
+    if (samples == 0 || squaredError == 0.0)
+        return (99.0f);
+    double  mse = squaredError / samples;
+    return (static_cast<float>(10.0 * std::log10(255.0 * 255.0 / mse)));
+};
+
+void    BlockCompressor::FetchBlock(const uint8_t* pixels, int width, int height, int channelCount,
+                                    int blockX, int blockY, uint8_t rgba[64])
+{
+    // 4의 배수가 아닌 크기는 가장자리 Pixel을 반복한다.
+    for (int y = 0; y < 4; ++y)
+    {
+        int py = std::min(blockY * 4 + y, height - 1);
+        for (int x = 0; x < 4; ++x)
+        {
+            int             px = std::min(blockX * 4 + x, width - 1);
+            const uint8_t*  src = pixels + (static_cast<size_t>(py) * width + px) * channelCount;
+            uint8_t*        dst = rgba + (y * 4 + x) * 4;
+            switch (channelCount)
+            {
+            case 1:
+                dst[0] = dst[1] = dst[2] = src[0];
+                dst[3] = 255;
+                break;
+            case 2:
+                dst[0] = src[0];
+                dst[1] = src[1];
+                dst[2] = 0;
+                dst[3] = 255;
+                break;
+            case 3:
+                dst[0] = src[0];
+                dst[1] = src[1];
+                dst[2] = src[2];
+                dst[3] = 255;
+                break;
+            default:
+                memcpy(dst, src, 4);
+                break;
+            }
+        }
+    }
+};
+
+void    BlockCompressor::EncodeBlock(const uint8_t rgba[64], BlockFormat format, uint8_t* out)
+{
+    uint8_t channel[16];
+    switch (format)
+    {
+    case BLOCK_FORMAT_BC1:
+        EncodeBC1(rgba, out);
+        break;
+    case BLOCK_FORMAT_BC3:
+        for (int i = 0; i < 16; ++i)
+            channel[i] = rgba[i * 4 + 3];
+        EncodeBC4(channel, out);
+        EncodeBC1(rgba, out + 8);
+        break;
+    case BLOCK_FORMAT_BC5:
+        for (int c = 0; c < 2; ++c)
+        {
+            for (int i = 0; i < 16; ++i)
+                channel[i] = rgba[i * 4 + c];
+            EncodeBC4(channel, out + c * 8);
+        }
+        break;
+    }
+};
+
+void    BlockCompressor::DecodeBlock(const uint8_t* block, BlockFormat format, uint8_t rgba[64])
+{
+    uint8_t channel[16];
+    switch (format)
+    {
+    case BLOCK_FORMAT_BC1:
+        DecodeBC1(block, rgba);
+        break;
+    case BLOCK_FORMAT_BC3:
+        DecodeBC1(block + 8, rgba);
+        DecodeBC4(block, channel);
+        for (int i = 0; i < 16; ++i)
+            rgba[i * 4 + 3] = channel[i];
+        break;
+    case BLOCK_FORMAT_BC5:
+        for (int c = 0; c < 2; ++c)
+        {
+            DecodeBC4(block + c * 8, channel);
+            for (int i = 0; i < 16; ++i)
+                rgba[i * 4 + c] = channel[i];
+        }
+        for (int i = 0; i < 16; ++i)
+        {
+            rgba[i * 4 + 2] = 0;
+            rgba[i * 4 + 3] = 255;
+        }
+        break;
+    }
+};
+
+uint16_t    BlockCompressor::PackColor565(const float color[3])
+{
+    auto    quantize = [](float value, int maxValue) -> uint32_t
+    { return (static_cast<uint32_t>(glm::clamp(value, 0.0f, 255.0f) * maxValue / 255.0f + 0.5f)); };
+    return (static_cast<uint16_t>((quantize(color[0], 31) << 11) | (quantize(color[1], 63) << 5)
+                                    | quantize(color[2], 31)));
+};
+
+void    BlockCompressor::UnpackColor565(uint16_t color, float out[3])
+{
+    // 하위 bit를 상위 bit로 채워서 8bit로 늘린다. (GPU와 같은 값)
+    uint32_t    r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+    out[0] = static_cast<float>((r << 3) | (r >> 2));
+    out[1] = static_cast<float>((g << 2) | (g >> 4));
+    out[2] = static_cast<float>((b << 3) | (b >> 2));
+};
+
+void    BlockCompressor::ComputeBC1Indices(const float r[16], const float g[16], const float b[16],
+                                        const float color0[3], const float color1[3], uint8_t indices[16])
+{
+    // color0 -> color1 선분에 투영해서 가장 가까운 단계(0, 1/3, 2/3, 1)를 고른다.
+    float   dir[3] = { color1[0] - color0[0], color1[1] - color0[1], color1[2] - color0[2] };
+    float   length2 = dir[0] * dir[0] + dir[1] * dir[1] + dir[2] * dir[2];
+    if (length2 < 1e-6f)
+    {
+        memset(indices, 0, 16);
+        return ;
+    }
+    float   scale = 3.0f / length2;
+    // 단계 -> BC1 Index (0 : color0, 1 : color1, 2 : 2/3 c0 + 1/3 c1, 3 : 1/3 c0 + 2/3 c1)
+    static const uint8_t    remap[4] = { 0, 2, 3, 1 };
+    int     steps[16];
+#ifdef BLOCK_COMPRESSOR_SSE2
+    __m128  dirR = _mm_set1_ps(dir[0] * scale), dirG = _mm_set1_ps(dir[1] * scale), dirB = _mm_set1_ps(dir[2] * scale);
+    __m128  baseR = _mm_set1_ps(color0[0]), baseG = _mm_set1_ps(color0[1]), baseB = _mm_set1_ps(color0[2]);
+    __m128i zero = _mm_setzero_si128(), three = _mm_set1_epi32(3);
+    for (int i = 0; i < 16; i += 4)
+    {
+        __m128  t = _mm_add_ps(_mm_add_ps(
+                        _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(r + i), baseR), dirR),
+                        _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(g + i), baseG), dirG)),
+                        _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(b + i), baseB), dirB));
+        __m128i step = _mm_cvtps_epi32(t);  // 반올림
+        // SSE2에는 32bit min / max가 없으므로 비교 결과로 자른다.
+        step = _mm_and_si128(step, _mm_cmpgt_epi32(step, zero));
+        __m128i over = _mm_cmpgt_epi32(step, three);
+        step = _mm_or_si128(_mm_andnot_si128(over, step), _mm_and_si128(over, three));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(steps + i), step);
+    }
+#else
+    for (int i = 0; i < 16; ++i)
+    {
+        float   t = ((r[i] - color0[0]) * dir[0] + (g[i] - color0[1]) * dir[1] + (b[i] - color0[2]) * dir[2]) * scale;
+        steps[i] = glm::clamp(static_cast<int>(std::lround(t)), 0, 3);
+    }
+#endif
+    for (int i = 0; i < 16; ++i)
+        indices[i] = remap[steps[i]];
+};
+
+float   BlockCompressor::ComputeBC1Error(const uint8_t rgba[64], uint16_t color0, uint16_t color1,
+                                        const uint8_t indices[16])
+{
+    uint8_t block[8] = { static_cast<uint8_t>(color0), static_cast<uint8_t>(color0 >> 8),
+                        static_cast<uint8_t>(color1), static_cast<uint8_t>(color1 >> 8), 0, 0, 0, 0 };
+    for (int i = 0; i < 16; ++i)
+        block[4 + i / 4] |= indices[i] << ((i % 4) * 2);
+    uint8_t decoded[64];
+    DecodeBC1(block, decoded);
+    float   error = 0.0f;
+    for (int i = 0; i < 16; ++i)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            float   diff = float(rgba[i * 4 + c]) - float(decoded[i * 4 + c]);
+            error += diff * diff;
+        }
+    }
+    return (error);
+};
+
+void    BlockCompressor::EncodeBC1(const uint8_t rgba[64], uint8_t out[8])
+{
+    float   r[16], g[16], b[16];
+    float   mean[3] = { 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < 16; ++i)
+    {
+        r[i] = rgba[i * 4 + 0];
+        g[i] = rgba[i * 4 + 1];
+        b[i] = rgba[i * 4 + 2];
+        mean[0] += r[i];
+        mean[1] += g[i];
+        mean[2] += b[i];
+    }
+    for (int c = 0; c < 3; ++c)
+        mean[c] /= 16.0f;
+
+    // 공분산 행렬의 주성분 축 (Power Iteration)
+    float   cov[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < 16; ++i)
+    {
+        float   dr = r[i] - mean[0], dg = g[i] - mean[1], db = b[i] - mean[2];
+        cov[0] += dr * dr;
+        cov[1] += dr * dg;
+        cov[2] += dr * db;
+        cov[3] += dg * dg;
+        cov[4] += dg * db;
+        cov[5] += db * db;
+    }
+    float   axis[3] = { 1.0f, 1.0f, 1.0f };
+    for (int iter = 0; iter < 8; ++iter)
+    {
+        float   next[3] = {
+            cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2],
+            cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2],
+            cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2]
+        };
+        float   length = std::max(std::fabs(next[0]), std::max(std::fabs(next[1]), std::fabs(next[2])));
+        if (length < 1e-6f)
+            break;
+        for (int c = 0; c < 3; ++c)
+            axis[c] = next[c] / length;
+    }
+
+    // 축 위로 투영한 범위의 양 끝을 Endpoint로 (양 끝을 1/16 안으로 당겨 Outlier 영향을 줄인다.)
+    float   axisLength2 = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+    float   minT = 0.0f, maxT = 0.0f;
+    for (int i = 0; i < 16; ++i)
+    {
+        float   t = ((r[i] - mean[0]) * axis[0] + (g[i] - mean[1]) * axis[1] + (b[i] - mean[2]) * axis[2]) / axisLength2;
+        minT = std::min(minT, t);
+        maxT = std::max(maxT, t);
+    }
+    float   inset = (maxT - minT) / 16.0f;
+    minT += inset;
+    maxT -= inset;
+    float   end0[3], end1[3];
+    for (int c = 0; c < 3; ++c)
+    {
+        end0[c] = mean[c] + axis[c] * maxT;
+        end1[c] = mean[c] + axis[c] * minT;
+    }
+
+    uint16_t    color0 = PackColor565(end0);
+    uint16_t    color1 = PackColor565(end1);
+    float       palette0[3], palette1[3];
+    uint8_t     indices[16];
+    UnpackColor565(color0, palette0);
+    UnpackColor565(color1, palette1);
+    ComputeBC1Indices(r, g, b, palette0, palette1, indices);
+    float       bestError = ComputeBC1Error(rgba, std::max(color0, color1), std::min(color0, color1), indices);
+    if (color0 < color1)
+    {
+        std::swap(color0, color1);
+        std::swap(palette0[0], palette1[0]);
+        std::swap(palette0[1], palette1[1]);
+        std::swap(palette0[2], palette1[2]);
+        ComputeBC1Indices(r, g, b, palette0, palette1, indices);
+        bestError = ComputeBC1Error(rgba, color0, color1, indices);
+    }
+
+    // 정한 Index로 Endpoint를 최소제곱으로 다시 맞춰 보고 오차가 줄면 쓴다.
+    static const float  weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+    float   a = 0.0f, bb = 0.0f, cc = 0.0f;
+    float   x0[3] = { 0.0f, 0.0f, 0.0f }, x1[3] = { 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < 16; ++i)
+    {
+        float   w = weights[indices[i]];
+        float   pixel[3] = { r[i], g[i], b[i] };
+        a += (1.0f - w) * (1.0f - w);
+        bb += (1.0f - w) * w;
+        cc += w * w;
+        for (int c = 0; c < 3; ++c)
+        {
+            x0[c] += (1.0f - w) * pixel[c];
+            x1[c] += w * pixel[c];
+        }
+    }
+    float   det = a * cc - bb * bb;
+    if (std::fabs(det) > 1e-6f)
+    {
+        float   fit0[3], fit1[3];
+        for (int c = 0; c < 3; ++c)
+        {
+            fit0[c] = (cc * x0[c] - bb * x1[c]) / det;
+            fit1[c] = (a * x1[c] - bb * x0[c]) / det;
+        }
+        uint16_t    fitColor0 = PackColor565(fit0);
+        uint16_t    fitColor1 = PackColor565(fit1);
+        if (fitColor0 < fitColor1)
+            std::swap(fitColor0, fitColor1);
+        float       fitPalette0[3], fitPalette1[3];
+        uint8_t     fitIndices[16];
+        UnpackColor565(fitColor0, fitPalette0);
+        UnpackColor565(fitColor1, fitPalette1);
+        ComputeBC1Indices(r, g, b, fitPalette0, fitPalette1, fitIndices);
+        float   fitError = ComputeBC1Error(rgba, fitColor0, fitColor1, fitIndices);
+        if (fitError < bestError)
+        {
+            color0 = fitColor0;
+            color1 = fitColor1;
+            memcpy(indices, fitIndices, 16);
+        }
+    }
+    // color0 == color1이면 3색 Mode가 되지만 Index가 모두 0이므로 결과는 같다.
+    if (color0 == color1)
+        memset(indices, 0, 16);
+
+    out[0] = static_cast<uint8_t>(color0);
+    out[1] = static_cast<uint8_t>(color0 >> 8);
+    out[2] = static_cast<uint8_t>(color1);
+    out[3] = static_cast<uint8_t>(color1 >> 8);
+    for (int row = 0; row < 4; ++row)
+    {
+        out[4 + row] = static_cast<uint8_t>(indices[row * 4] | (indices[row * 4 + 1] << 2)
+                                            | (indices[row * 4 + 2] << 4) | (indices[row * 4 + 3] << 6));
+    }
+};
+
+void    BlockCompressor::EncodeBC4(const uint8_t values[16], uint8_t out[8])
+{
+    uint8_t minValue = 255, maxValue = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+        minValue = std::min(minValue, values[i]);
+        maxValue = std::max(maxValue, values[i]);
+    }
+    out[0] = maxValue;
+    out[1] = minValue;
+    uint64_t    bits = 0;
+    if (maxValue != minValue)
+    {
+        // 8단계 Mode (a0 > a1) : 0 -> a0, 1 -> a1, 2 ~ 7 -> a0에서 a1 쪽으로 1/7씩
+        float   scale = 7.0f / (maxValue - minValue);
+        for (int i = 0; i < 16; ++i)
+        {
+            int         step = static_cast<int>((values[i] - minValue) * scale + 0.5f);
+            uint64_t    index = step == 7 ? 0 : (step == 0 ? 1 : 8 - step);
+            bits |= index << (3 * i);
+        }
+    }
+    for (int i = 0; i < 6; ++i)
+        out[2 + i] = static_cast<uint8_t>(bits >> (8 * i));
+};
+
+void    BlockCompressor::DecodeBC1(const uint8_t block[8], uint8_t rgba[64])
+{
+    uint16_t    color0 = static_cast<uint16_t>(block[0] | (block[1] << 8));
+    uint16_t    color1 = static_cast<uint16_t>(block[2] | (block[3] << 8));
+    float       palette[4][4];
+    UnpackColor565(color0, palette[0]);
+    UnpackColor565(color1, palette[1]);
+    palette[0][3] = palette[1][3] = 255.0f;
+    for (int c = 0; c < 3; ++c)
+    {
+        if (color0 > color1)
+        {
+            palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+            palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+        }
+        else
+        {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2.0f;
+            palette[3][c] = 0.0f;
+        }
+    }
+    palette[2][3] = 255.0f;
+    palette[3][3] = color0 > color1 ? 255.0f : 0.0f;
+    for (int i = 0; i < 16; ++i)
+    {
+        int index = (block[4 + i / 4] >> ((i % 4) * 2)) & 3;
+        for (int c = 0; c < 4; ++c)
+            rgba[i * 4 + c] = static_cast<uint8_t>(palette[index][c] + 0.5f);
+    }
+};
+
+void    BlockCompressor::DecodeBC4(const uint8_t block[8], uint8_t values[16])
+{
+    float   palette[8];
+    palette[0] = block[0];
+    palette[1] = block[1];
+    if (block[0] > block[1])
+    {
+        for (int i = 1; i < 7; ++i)
+            palette[i + 1] = ((7 - i) * palette[0] + i * palette[1]) / 7.0f;
+    }
+    else
+    {
+        for (int i = 1; i < 5; ++i)
+            palette[i + 1] = ((5 - i) * palette[0] + i * palette[1]) / 5.0f;
+        palette[6] = 0.0f;
+        palette[7] = 255.0f;
+    }
+    uint64_t    bits = 0;
+    for (int i = 0; i < 6; ++i)
+        bits |= static_cast<uint64_t>(block[2 + i]) << (8 * i);
+    for (int i = 0; i < 16; ++i)
+        values[i] = static_cast<uint8_t>(palette[(bits >> (3 * i)) & 7] + 0.5f);
+};
+
+#endif
@@ -2,6 +2,7 @@
 #define BUFFER_HPP
 
 #include "Common.hpp"
+#include "GLStateCache.hpp"
 
 CLASS_PTR(Buffer);
 class Buffer
@@ -18,7 +19,8 @@ public:
     size_t      GetCount(void) const
     { return (this->m_count); };
     void        Bind(void) const
-    { glBindBuffer(this->m_bufferType, this->m_buffer); };
+    { GLStateCache::Get().BindBuffer(this->m_bufferType, this->m_buffer); };
+    void        SetData(const void* data, size_t size, size_t offset = 0) const;
 private:
     uint32_t    m_buffer{0}, m_bufferType{0}, m_usage{0};
     size_t      m_stride{0}, m_count{0};
@@ -40,7 +42,16 @@ BufferUPtr  Buffer::CreateWithData(uint32_t bufferType, uint32_t usage,
 Buffer::~Buffer()
 {
     if (this->m_buffer)
+    {
+        GLStateCache::Get().ForgetBuffer(this->m_buffer);
         glDeleteBuffers(1, &this->m_buffer);
+    }
+};
+
+void    Buffer::SetData(const void* data, size_t size, size_t offset) const
+{
+    Bind();
+    glBufferSubData(this->m_bufferType, offset, size, data);
 };
 
 bool    Buffer::init(uint32_t bufferType, uint32_t usage, 
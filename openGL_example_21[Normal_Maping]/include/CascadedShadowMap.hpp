@@ -0,0 +1,252 @@
+#ifndef CASCADEDSHADOWMAP_HPP
+#define CASCADEDSHADOWMAP_HPP
+
+#include "Common.hpp"
+#include "GLStateCache.hpp"
+#include "ShadowMap.hpp"
+
+// Directional Light용 Cascaded Shadow Map.
+// 카메라 Frustum을 깊이 방향으로 나눈 구간마다 GL_TEXTURE_2D_ARRAY의 한 Layer를 쓴다.
+// 각 구간은 경계 구를 감싸는 Ortho로 맞추고, 중심을 Texel 단위로 맞춰 카메라가 움직여도 그림자가 떨리지 않게 한다.
+CLASS_PTR(CascadedShadowMap);
+class CascadedShadowMap
+{
+public:
+    static const int    MAX_CASCADE_COUNT = 4;
+
+    // compare : GL_TEXTURE_COMPARE_MODE + GL_LINEAR (Shader에서는 sampler2DArrayShadow)
+    static CascadedShadowMapUPtr    Create(int resolution, int cascadeCount, bool compare = false);
+    ~CascadedShadowMap();
+
+    // 카메라 / 빛 방향으로 Split과 Cascade마다의 View / Projection을 다시 계산한다.
+    // fovy는 radian, shadowDistance보다 먼 곳은 그림자를 만들지 않는다.
+    void    Update(const glm::mat4& cameraView, float fovy, float aspect, float nearPlane, float farPlane,
+                    const glm::vec3& lightDirection);
+    // cascade번째 Layer를 Depth Attachment로 붙이고 Viewport를 맞춘다.
+    void    BindCascade(int cascade) const;
+    // Static Cache : 정적 물체만 그린 같은 크기의 Array. Cascade마다 따로 유효성을 따진다.
+    void            BindStaticCascade(int cascade) const;
+    void            CopyStaticCascade(int cascade) const;
+    ShadowCacheKey& GetStaticKey(int cascade)
+    { return (this->m_staticKeys[cascade]); };
+    void    BindTexture(uint32_t unit) const
+    { GLStateCache::Get().BindTexture(unit, GL_TEXTURE_2D_ARRAY, this->m_texture); };
+    void    SetCompareMode(bool compare);
+    bool    IsCompareMode(void) const
+    { return (this->m_compare); };
+
+    // 0이면 균등 분할, 1이면 Log 분할 (Practical Split Scheme)
+    void    SetSplitLambda(float lambda)
+    { this->m_splitLambda = glm::clamp(lambda, 0.0f, 1.0f); };
+    float   GetSplitLambda(void) const
+    { return (this->m_splitLambda); };
+    void    SetShadowDistance(float distance)
+    { this->m_shadowDistance = distance; };
+    float   GetShadowDistance(void) const
+    { return (this->m_shadowDistance); };
+    // Frustum 밖에서 그림자를 드리우는 물체를 위해 빛 쪽으로 더 잡는 깊이
+    void    SetCasterMargin(float margin)
+    { this->m_casterMargin = margin; };
+
+    uint32_t            Get(void) const
+    { return (this->m_texture); };
+    int                 GetResolution(void) const
+    { return (this->m_resolution); };
+    int                 GetCascadeCount(void) const
+    { return (this->m_cascadeCount); };
+    // cascade 구간이 끝나는 view space 깊이 (양수)
+    float               GetSplit(int cascade) const
+    { return (this->m_splits[cascade]); };
+    const glm::mat4&    GetView(int cascade) const
+    { return (this->m_views[cascade]); };
+    const glm::mat4&    GetProjection(int cascade) const
+    { return (this->m_projections[cascade]); };
+    glm::mat4           GetTransform(int cascade) const
+    { return (this->m_projections[cascade] * this->m_views[cascade]); };
+    // 한 Texel이 덮는 World 크기
+    float               GetTexelSize(int cascade) const
+    { return (this->m_texelSizes[cascade]); };
+private:
+    uint32_t    m_frameBuffer { 0 };
+    uint32_t    m_texture { 0 };
+    uint32_t    m_staticFrameBuffer { 0 };
+    uint32_t    m_staticTexture { 0 };
+    ShadowCacheKey  m_staticKeys[MAX_CASCADE_COUNT];
+    int         m_resolution { 0 };
+    int         m_cascadeCount { 0 };
+    bool        m_compare { false };
+    float       m_splitLambda { 0.75f };
+    float       m_shadowDistance { 50.0f };
+    float       m_casterMargin { 30.0f };
+
+    float       m_splits[MAX_CASCADE_COUNT] { 0.0f };
+    float       m_texelSizes[MAX_CASCADE_COUNT] { 0.0f };
+    glm::mat4   m_views[MAX_CASCADE_COUNT];
+    glm::mat4   m_projections[MAX_CASCADE_COUNT];
+
+    CascadedShadowMap() {};
+    bool    init(int resolution, int cascadeCount);
+    bool    initTarget(uint32_t& frameBuffer, uint32_t& texture);
+};
+
+CascadedShadowMapUPtr   CascadedShadowMap::Create(int resolution, int cascadeCount, bool compare)
+{
+    auto    shadowMap = CascadedShadowMapUPtr(new CascadedShadowMap());
+    if (!shadowMap->init(resolution, cascadeCount))
+        return (nullptr);
+    shadowMap->SetCompareMode(compare);
+    return (std::move(shadowMap));
+};
+
+CascadedShadowMap::~CascadedShadowMap()
+{
+    for (auto frameBuffer : { this->m_frameBuffer, this->m_staticFrameBuffer })
+    {
+        if (!frameBuffer)
+            continue;
+        GLStateCache::Get().ForgetFramebuffer(frameBuffer);
+        glDeleteFramebuffers(1, &frameBuffer);
+    }
+    for (auto texture : { this->m_texture, this->m_staticTexture })
+    {
+        if (!texture)
+            continue;
+        GLStateCache::Get().ForgetTexture(texture);
+        glDeleteTextures(1, &texture);
+    }
+};
+
+bool    CascadedShadowMap::init(int resolution, int cascadeCount)
+{
+    if (cascadeCount < 1 || cascadeCount > MAX_CASCADE_COUNT)
+    {
+        putError("cascade count must be 1 ~ " + std::to_string(MAX_CASCADE_COUNT));
+        return (false);
+    }
+    this->m_resolution = resolution;
+    this->m_cascadeCount = cascadeCount;
+    return (initTarget(this->m_frameBuffer, this->m_texture)
+            && initTarget(this->m_staticFrameBuffer, this->m_staticTexture));
+};
+
+bool    CascadedShadowMap::initTarget(uint32_t& frameBuffer, uint32_t& texture)
+{
+    glGenTextures(1, &texture);
+    GLStateCache::Get().BindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_DEPTH_COMPONENT32F, this->m_resolution, this->m_resolution,
+                    this->m_cascadeCount);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    glm::vec4   borderColor(1.0f);
+    glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, glm::value_ptr(borderColor));
+
+    glGenFramebuffers(1, &frameBuffer);
+    GLStateCache::Get().BindFramebuffer(frameBuffer);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    auto    status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    GLStateCache::Get().BindFramebuffer(0);
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        putError("failed to complete cascaded shadow map framebuffer: " + std::to_string(status));
+        return (false);
+    }
+    return (true);
+};
+
+void    CascadedShadowMap::SetCompareMode(bool compare)
+{
+    this->m_compare = compare;
+    uint32_t    filter = compare ? GL_LINEAR : GL_NEAREST;
+    GLStateCache::Get().BindTexture(GL_TEXTURE_2D_ARRAY, this->m_texture);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, compare ? GL_COMPARE_REF_TO_TEXTURE : GL_NONE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+};
+
+void    CascadedShadowMap::Update(const glm::mat4& cameraView, float fovy, float aspect, float nearPlane,
+                                float farPlane, const glm::vec3& lightDirection)
+{
+    // Split : Log 분할과 균등 분할을 lambda로 섞는다.
+    float   shadowFar = std::min(farPlane, this->m_shadowDistance);
+    for (int cascade = 0; cascade < this->m_cascadeCount; ++cascade)
+    {
+        float   ratio = static_cast<float>(cascade + 1) / this->m_cascadeCount;
+        float   logSplit = nearPlane * std::pow(shadowFar / nearPlane, ratio);
+        float   uniformSplit = nearPlane + (shadowFar - nearPlane) * ratio;
+        this->m_splits[cascade] = glm::mix(uniformSplit, logSplit, this->m_splitLambda);
+    }
+
+    // 모든 Cascade가 같은 방향의 Light View를 쓴다. (원점 기준, 이동은 Ortho 범위로)
+    glm::vec3   direction = glm::normalize(lightDirection);
+    glm::vec3   up = std::abs(direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::mat4   lightView = glm::lookAt(glm::vec3(0.0f), direction, up);
+    glm::mat4   inverseView = glm::inverse(cameraView);
+    float       tanY = std::tan(fovy * 0.5f);
+    float       tanX = tanY * aspect;
+
+    float   sliceNear = nearPlane;
+    for (int cascade = 0; cascade < this->m_cascadeCount; ++cascade)
+    {
+        float   sliceFar = this->m_splits[cascade];
+
+        // 구간의 8 꼭짓점 (World)
+        glm::vec3   corners[8];
+        glm::vec3   center(0.0f);
+        for (int index = 0; index < 8; ++index)
+        {
+            float   depth = (index & 4) ? sliceFar : sliceNear;
+            glm::vec4   viewCorner((index & 1 ? 1.0f : -1.0f) * tanX * depth,
+                                    (index & 2 ? 1.0f : -1.0f) * tanY * depth, -depth, 1.0f);
+            corners[index] = glm::vec3(inverseView * viewCorner);
+            center += corners[index];
+        }
+        center /= 8.0f;
+
+        // 경계 구 : 카메라가 돌아도 크기가 변하지 않는다. (반지름도 조금씩만 바뀌도록 올림)
+        float   radius = 0.0f;
+        for (auto& corner : corners)
+            radius = std::max(radius, glm::length(corner - center));
+        radius = std::ceil(radius * 16.0f) / 16.0f;
+
+        // 중심을 Texel 크기의 배수로 맞춘다.
+        float       texelSize = radius * 2.0f / this->m_resolution;
+        glm::vec3   lightCenter = glm::vec3(lightView * glm::vec4(center, 1.0f));
+        lightCenter.x = std::floor(lightCenter.x / texelSize) * texelSize;
+        lightCenter.y = std::floor(lightCenter.y / texelSize) * texelSize;
+
+        // Light View는 -z를 보므로 깊이는 -z. 빛 쪽(near)으로 casterMargin만큼 더 잡는다.
+        this->m_views[cascade] = lightView;
+        this->m_projections[cascade] = glm::ortho(lightCenter.x - radius, lightCenter.x + radius,
+                                                lightCenter.y - radius, lightCenter.y + radius,
+                                                -lightCenter.z - radius - this->m_casterMargin,
+                                                -lightCenter.z + radius);
+        this->m_texelSizes[cascade] = texelSize;
+        sliceNear = sliceFar;
+    }
+};
+
+void    CascadedShadowMap::BindCascade(int cascade) const
+{
+    GLStateCache::Get().BindFramebuffer(this->m_frameBuffer);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, this->m_texture, 0, cascade);
+    glViewport(0, 0, this->m_resolution, this->m_resolution);
+};
+
+void    CascadedShadowMap::BindStaticCascade(int cascade) const
+{
+    GLStateCache::Get().BindFramebuffer(this->m_staticFrameBuffer);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, this->m_staticTexture, 0, cascade);
+    glViewport(0, 0, this->m_resolution, this->m_resolution);
+};
+
+void    CascadedShadowMap::CopyStaticCascade(int cascade) const
+{
+    glCopyImageSubData(this->m_staticTexture, GL_TEXTURE_2D_ARRAY, 0, 0, 0, cascade,
+                    this->m_texture, GL_TEXTURE_2D_ARRAY, 0, 0, 0, cascade,
+                    this->m_resolution, this->m_resolution, 1);
+};
+
+#endif
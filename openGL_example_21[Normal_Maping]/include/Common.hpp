@@ -19,6 +19,10 @@
 #include <filesystem>
 
 #include <vector>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <unordered_map>
 
 #define CLASS_PTR(klassName)\
 class klassName;\
@@ -35,6 +39,11 @@ int	putError(std::string str)
 	return (-1);
 };
 
+void	putLog(std::string str)
+{
+	std::cout << str << std::endl;
+};
+
 std::optional<std::string>  LoadTextFile(const std::string& filename)
 {
     std::ifstream   fin(filename);
@@ -48,6 +57,32 @@ std::optional<std::string>  LoadTextFile(const std::string& filename)
     return (text.str());
 };
 
+// FNV-1a 64bit : Cache 파일 이름 등 Key를 만들 때 사용한다.
+uint64_t    HashString(const std::string& str, uint64_t seed = 0xcbf29ce484222325ULL)
+{
+    uint64_t    hash = seed;
+    for (unsigned char ch : str)
+    {
+        hash ^= ch;
+        hash *= 0x100000001b3ULL;
+    }
+    return (hash);
+};
+
+// 파일 크기 / 수정 시간 : Cache가 원본과 같은지 확인할 때 사용한다.
+bool    GetFileStamp(const std::string& filepath, uint64_t& size, int64_t& time)
+{
+    std::error_code ec;
+    size = static_cast<uint64_t>(std::filesystem::file_size(filepath, ec));
+    if (ec)
+        return (false);
+    auto    writeTime = std::filesystem::last_write_time(filepath, ec);
+    if (ec)
+        return (false);
+    time = static_cast<int64_t>(writeTime.time_since_epoch().count());
+    return (true);
+};
+
 glm::vec3   GetAttenuationCoeff(float distance) {
     const auto linear_coeff = glm::vec4(
         8.4523112e-05,
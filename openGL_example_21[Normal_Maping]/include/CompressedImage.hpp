@@ -0,0 +1,208 @@
+#ifndef COMPRESSEDIMAGE_HPP
+#define COMPRESSEDIMAGE_HPP
+
+#include "Common.hpp"
+#include "Image.hpp"
+#include "BlockCompressor.hpp"
+#include "KtxImage.hpp"
+
+// Mip Chain 전체를 Block 압축한 Image.
+// 처음 Load 할 때 Decode -> Mip 생성 -> 압축 후 ./cache/texture/*.ktx2로 저장하고,
+// 다음부터는 원본 크기 / 수정 시간(KTX2 Key / Value "SourceStamp")이 같으면
+// Cache 파일을 mmap 해서 바로 Upload 한다.
+CLASS_PTR(CompressedImage);
+class CompressedImage
+{
+public:
+    using Level = KtxImage::Level;
+
+    // Worker Thread에서 호출해도 된다. (GL 호출 없음)
+    // alphaCutoff : Alpha Test 기준값. 0보다 크면 Mip의 Alpha Test 통과 비율을 원본과 같게 맞춘다.
+    static CompressedImageUPtr  Load(const std::string& filepath, bool flipVertical = true, bool normalMap = false,
+                                    float alphaCutoff = 0.0f);
+    // image와 그 Mip Level을 모두 압축한다. normalMap이면 RG만 BC5로 저장한다.
+    // Mip은 CPU에서 만든다. (색은 sRGB -> Linear에서 평균, Normal은 다시 정규화)
+    static CompressedImageUPtr  Compress(const Image* image, bool normalMap = false, float alphaCutoff = 0.0f);
+    static std::string          GetCachePath(const std::string& sourcePath, bool flipVertical, bool normalMap,
+                                            float alphaCutoff = 0.0f);
+    static uint32_t             GetVkFormat(BlockFormat format);
+
+    BlockFormat     GetFormat(void) const
+    { return (this->m_format); };
+    uint32_t        GetGLFormat(void) const
+    { return (BlockCompressor::GetGLFormat(this->m_format)); };
+    int             GetWidth(void) const
+    { return (this->m_levels.empty() ? 0 : this->m_levels[0].width); };
+    int             GetHeight(void) const
+    { return (this->m_levels.empty() ? 0 : this->m_levels[0].height); };
+    int             GetLevelCount(void) const
+    { return (static_cast<int>(this->m_levels.size())); };
+    const Level&    GetLevel(int level) const
+    { return (this->m_levels[level]); };
+    // Level 0 기준 (압축 전 대비, dB)
+    float           GetPSNR(void) const
+    { return (this->m_psnr); };
+
+    bool    Write(const std::string& sourcePath, bool flipVertical, bool normalMap, float alphaCutoff = 0.0f) const;
+private:
+    BlockFormat             m_format { BLOCK_FORMAT_BC1 };
+    std::vector<Level>      m_levels;
+    float                   m_psnr { 0.0f };
+    // 둘 중 하나가 Level Data를 들고 있다.
+    std::vector<uint8_t>    m_storage;
+    KtxImageUPtr            m_file;
+
+    CompressedImage() {};
+    bool    initFromCache(const std::string& sourcePath, bool flipVertical, bool normalMap, float alphaCutoff);
+    // Mip 생성 방식이 바뀌면 Cache를 다시 만들도록 KTX2 Key / Value에 남긴다.
+    static std::string  GetMipDescription(bool normalMap, float alphaCutoff);
+};
+
+CompressedImageUPtr CompressedImage::Load(const std::string& filepath, bool flipVertical, bool normalMap,
+                                        float alphaCutoff)
+{
+    CompressedImageUPtr cached = CompressedImageUPtr(new CompressedImage());
+    if (cached->initFromCache(filepath, flipVertical, normalMap, alphaCutoff))
+    {
+        std::cout << "Texture loaded from bc cache: " << filepath << " ("
+                << BlockCompressor::GetName(cached->m_format) << ", "
+                << cached->GetWidth() << "x" << cached->GetHeight() << ")" << std::endl;
+        return (cached);
+    }
+
+    auto    image = Image::Load(filepath, flipVertical);
+    if (!image)
+        return (nullptr);
+    auto    start = std::chrono::steady_clock::now();
+    auto    compressed = Compress(image.get(), normalMap, alphaCutoff);
+    if (!compressed)
+        return (nullptr);
+    double  seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // 처리량은 압축한 모든 Level의 원본 byte 기준
+    double  sourceBytes = 0.0;
+    for (auto& level : compressed->m_levels)
+        sourceBytes += double(level.width) * level.height * image->GetChannelCount();
+    std::cout << "Texture compressed: " << filepath << " ("
+            << BlockCompressor::GetName(compressed->m_format) << ", "
+            << compressed->GetWidth() << "x" << compressed->GetHeight() << ", "
+            << compressed->GetLevelCount() << " levels) "
+            << sourceBytes / (1024.0 * 1024.0) / std::max(seconds, 1e-6) << " MB/s, PSNR "
+            << compressed->m_psnr << " dB" << std::endl;
+    compressed->Write(filepath, flipVertical, normalMap, alphaCutoff);
+    return (compressed);
+};
+
+CompressedImageUPtr CompressedImage::Compress(const Image* image, bool normalMap, float alphaCutoff)
+{
+    if (!image || !image->GetData())
+        return (nullptr);
+
+    CompressedImageUPtr compressed = CompressedImageUPtr(new CompressedImage());
+    int         channels = image->GetChannelCount();
+    BlockFormat format = BlockCompressor::ChooseFormat(image->GetData(), image->GetWidth(), image->GetHeight(),
+                                                        channels, normalMap);
+    compressed->m_format = format;
+
+    // 먼저 모든 Level 크기를 정해서 한 번에 잡는다.
+    std::vector<size_t> offsets;
+    size_t              total = 0;
+    for (int width = image->GetWidth(), height = image->GetHeight();; width = std::max(1, width / 2),
+                                                                        height = std::max(1, height / 2))
+    {
+        offsets.push_back(total);
+        compressed->m_levels.push_back({ width, height, nullptr,
+                                        BlockCompressor::GetCompressedSize(format, width, height) });
+        total += compressed->m_levels.back().size;
+        if (width == 1 && height == 1)
+            break;
+    }
+    compressed->m_storage.resize(total);
+
+    // Level 0은 원본, 그 아래는 CPU Mip Chain
+    auto    mips = image->CreateMipChain(normalMap ? MIP_FILTER_NORMAL_MAP : MIP_FILTER_SRGB, alphaCutoff);
+    if (mips.size() + 1 != compressed->m_levels.size())
+        return (nullptr);
+    for (size_t level = 0; level < compressed->m_levels.size(); ++level)
+    {
+        const Image*    source = level == 0 ? image : mips[level - 1].get();
+        auto&           record = compressed->m_levels[level];
+        record.data = compressed->m_storage.data() + offsets[level];
+        BlockCompressor::Compress(source->GetData(), record.width, record.height, channels, format,
+                                compressed->m_storage.data() + offsets[level]);
+        if (level == 0)
+            compressed->m_psnr = BlockCompressor::ComputePSNR(image->GetData(), record.width, record.height,
+                                                            channels, format, record.data);
+    }
+    return (compressed);
+};
+
+std::string CompressedImage::GetCachePath(const std::string& sourcePath, bool flipVertical, bool normalMap,
+                                        float alphaCutoff)
+{
+    std::stringstream   name;
+    name << "./cache/texture/" << std::hex << HashString(sourcePath)
+        << (flipVertical ? "_f" : "") << (normalMap ? "_n" : "");
+    if (alphaCutoff > 0.0f)
+        name << "_a" << static_cast<int>(alphaCutoff * 255.0f + 0.5f);
+    name << ".ktx2";
+    return (name.str());
+};
+
+std::string CompressedImage::GetMipDescription(bool normalMap, float alphaCutoff)
+{
+    std::string description = MipGenerator::GetName(normalMap ? MIP_FILTER_NORMAL_MAP : MIP_FILTER_SRGB);
+    if (alphaCutoff > 0.0f)
+        description += " coverage " + std::to_string(alphaCutoff);
+    return (description);
+};
+
+uint32_t    CompressedImage::GetVkFormat(BlockFormat format)
+{
+    switch (format)
+    {
+    case BLOCK_FORMAT_BC1: return (KtxImage::VK_FORMAT_BC1_RGB_UNORM_BLOCK);
+    case BLOCK_FORMAT_BC3: return (KtxImage::VK_FORMAT_BC3_UNORM_BLOCK);
+    default: return (KtxImage::VK_FORMAT_BC5_UNORM_BLOCK);
+    }
+};
+
+bool    CompressedImage::initFromCache(const std::string& sourcePath, bool flipVertical, bool normalMap,
+                                        float alphaCutoff)
+{
+    std::string stamp = KtxImage::MakeSourceStamp({ sourcePath });
+    if (stamp.empty())
+        return (false);
+    this->m_file = KtxImage::Load(GetCachePath(sourcePath, flipVertical, normalMap, alphaCutoff));
+    if (!this->m_file || this->m_file->GetValue("SourceStamp") != stamp
+        || this->m_file->GetValue("MipFilter") != GetMipDescription(normalMap, alphaCutoff)
+        || this->m_file->GetFaceCount() != 1 || !this->m_file->IsCompressed())
+        return (false);
+
+    for (auto format : { BLOCK_FORMAT_BC1, BLOCK_FORMAT_BC3, BLOCK_FORMAT_BC5 })
+    {
+        if (GetVkFormat(format) == this->m_file->GetVkFormat())
+            this->m_format = format;
+    }
+    this->m_psnr = static_cast<float>(atof(this->m_file->GetValue("BlockCompressorPSNR").c_str()));
+    for (int level = 0; level < this->m_file->GetLevelCount(); ++level)
+        this->m_levels.push_back(this->m_file->GetLevel(level));
+    return (true);
+};
+
+bool    CompressedImage::Write(const std::string& sourcePath, bool flipVertical, bool normalMap,
+                                float alphaCutoff) const
+{
+    std::string stamp = KtxImage::MakeSourceStamp({ sourcePath });
+    if (stamp.empty())
+        return (false);
+    // 뒤집어 저장했으면 첫 행이 아래쪽 (KTX2 기본값은 "rd")
+    return (KtxImage::Write(GetCachePath(sourcePath, flipVertical, normalMap, alphaCutoff),
+                            GetVkFormat(this->m_format), 1, this->m_levels, {
+                                { "KTXorientation", flipVertical ? "ru" : "rd" },
+                                { "SourceStamp", stamp },
+                                { "MipFilter", GetMipDescription(normalMap, alphaCutoff) },
+                                { "BlockCompressorPSNR", std::to_string(this->m_psnr) } }));
+};
+
+#endif
@@ -4,12 +4,21 @@
 #include "Common.hpp"
 #include "Shader.hpp"
 #include "Program.hpp"
+#include "ProgramBatch.hpp"
+#include "ProgramVariants.hpp"
 #include "Image.hpp"
 #include "Texture.hpp"
 #include "FrameBuffer.hpp"
 #include "ShadowMap.hpp"
+#include "CascadedShadowMap.hpp"
+#include "GpuTimer.hpp"
+#include "LocalLightSet.hpp"
 #include "CubeTexture.hpp"
 #include "Mesh.hpp"
+#include "Model.hpp"
+#include "UniformBuffer.hpp"
+#include "RenderQueue.hpp"
+#include "AssetLoader.hpp"
 #include <imgui.h>
 
 CLASS_PTR(Context);
@@ -33,7 +42,7 @@ private:
     GLfloat         m_gamma { 1.0f };
 
     // Cube Map
-    CubeTextureUPtr m_cubeTexture;
+    CubeTextureSPtr m_cubeTexture;
     ProgramUPtr     m_skyboxProgram;
     ProgramUPtr     m_envMapProgram;
 
@@ -46,6 +55,11 @@ private:
 
     MeshUPtr        m_box;
     MeshUPtr        m_plane;
+    // Assimp Model : 두 번째 실행부터는 Mesh Cache에서 바로 읽는다.
+    ModelUPtr       m_model;
+    // Scene Graph의 Ring Node만 돌린다. 도는 동안에는 Model을 Shadow Cache 밖(dynamicPass)으로 보낸다.
+    uint32_t        m_modelRingNode { SceneGraph::INVALID_NODE };
+    bool            m_spinModelRing { false };
 
     MaterialSPtr    m_planeMaterial;
     MaterialSPtr    m_box1Material;
@@ -65,14 +79,48 @@ private:
     // Frame Buffer
     FrameBufferUPtr m_framebuffer;
 
-    // Shadow Map
-    ShadowMapUPtr   m_shadowMap;
-    ProgramUPtr     m_lightingShadowProgram;
+    // Shadow Map : Spot Light는 한 장, Directional Light는 Cascade
+    ShadowMapUPtr           m_shadowMap;
+    CascadedShadowMapUPtr   m_cascadedShadowMap;
+    GpuTimerUPtr            m_shadowPassTimer;
+    // Hardware 비교(sampler2DShadow) + 회전 Poisson Kernel. 끄면 3x3 수동 비교
+    bool                    m_shadowCompare { true };
+    int                     m_shadowSampleCount { 4 };
+    float                   m_shadowFilterRadius { 1.5f };
+    // 정적 물체만 따로 그려 둔 Depth를 Light 변환 / 정적 물체가 바뀔 때까지 다시 쓴다.
+    bool                    m_shadowCache { true };
+    uint32_t                m_staticShadowVersion { 0 };
+    size_t                  m_shadowDrawsSkipped { 0 };
+    bool                    m_animateDynamicBox { true };
+
+    // Shadow Atlas를 나눠 쓰는 여러 개의 Spot / Point Light
+    LocalLightSetUPtr       m_localLights;
+    int                     m_localLightCount { 8 };
+    int                     m_shadowTileBudget { 8 };
+    // BLINN / DIRECTIONAL_LIGHT / SHADOW_COMPARE 조합별 Variant
+    ProgramVariantsUPtr m_lightingShadowVariants;
+    // 고른 Variant가 바뀔 때만 다시 찾는다. (Material과 같은 방식) [0] : Vertex, [1] : Packed Vertex
+    struct LightingUniforms {
+        const Program*  program { nullptr };
+        UniformId       shadowMap { -1 };
+        UniformId       cascadeShadowMap { -1 };
+        UniformId       shadowSampleCount { -1 };
+        UniformId       shadowFilterRadius { -1 };
+        UniformId       shadowAtlas { -1 };
+        UniformId       localLightCount { -1 };
+    };
+    LightingUniforms    m_lightingUniforms[2];
 
     // Normal Map
-    TextureUPtr     m_brickDiffuseTexture;
-    TextureUPtr     m_brickNormalTexture;
+    TextureSPtr     m_brickDiffuseTexture;
+    TextureSPtr     m_brickNormalTexture;
     ProgramUPtr     m_normalProgram;
+
+    // Uniform Id : Program 생성 후 한 번만 찾는다.
+    UniformId       m_simpleColorId { -1 };
+    UniformId       m_skyboxId { -1 };
+    UniformId       m_normalDiffuseId { -1 };
+    UniformId       m_normalMapId { -1 };
     
     // light parameter
     struct Light {
@@ -88,12 +136,55 @@ private:
     Light   m_light;
     bool    m_blinn { true };
 
+    // Uniform Buffer : Shader의 CameraBlock / LightBlock과 같은 std140 배치
+    struct alignas(16) CameraBlock {
+        glm::mat4   view;
+        glm::mat4   projection;
+        glm::vec3   viewPos;
+    };
+    struct alignas(16) LightBlock {
+        glm::mat4   transform;
+        glm::vec3   position;
+        int         directional;
+        glm::vec3   direction;
+        int         blinn;
+        glm::vec3   attenuation;
+        float       pad0;
+        glm::vec3   ambient;
+        float       pad1;
+        glm::vec3   diffuse;
+        float       pad2;
+        glm::vec3   specular;
+        float       pad3;
+        glm::vec2   cutoff;
+        glm::vec2   pad4;
+        glm::mat4   cascadeTransforms[CascadedShadowMap::MAX_CASCADE_COUNT];
+        glm::vec4   cascadeSplits;
+        glm::vec4   cascadeTexelSizes;
+        int         cascadeCount;
+    };
+    static_assert(sizeof(CameraBlock) == 144, "CameraBlock must follow std140 layout");
+    static_assert(sizeof(LightBlock) == 480, "LightBlock must follow std140 layout");
+    UniformBufferUPtr   m_cameraBuffer;
+    UniformBufferUPtr   m_lightBuffer;
+
     GLuint  m_width { WINDOW_WIDTH };
     GLuint  m_height { WINDOW_HEIGHT };
 
+    // Render Queue
+    RenderQueueUPtr     m_renderQueue;
+    float               m_lodPixelError { 1.0f };
+
+    // Background Image Decode + 프레임당 Upload 시간 제한
+    AssetLoaderUPtr     m_assetLoader;
+    float               m_uploadBudgetMs { 2.0f };
+
     Context(void) {};
     bool    init(void);
-    void    DrawScene(const glm::mat4 view, const glm::mat4& projection, const Program* program);
+    // 움직이는 물체만 dynamicPass로 제출한다. (Main Pass는 둘이 같다.)
+    // packedProgram : Packed Vertex Mesh용 Variant (nullptr면 program으로 그린다.)
+    void    SubmitScene(RenderPass pass, RenderPass dynamicPass, const Program* program,
+                        const Program* packedProgram = nullptr);
 };
 
 ContextUPtr  Context::Create(void)
@@ -106,6 +197,12 @@ ContextUPtr  Context::Create(void)
 
 void    Context::Render(void)
 {
+    // 지난 프레임의 Counter를 넘기고 Cache를 비운다. 이번 프레임의 GL 호출은 모두 이 뒤에 온다.
+    GLStateCache::Get().BeginFrame();
+
+    // Worker에서 Decode가 끝난 Image를 정해진 시간 안에서만 올린다.
+    m_assetLoader->Update(this->m_uploadBudgetMs);
+
     if (ImGui::Begin("ui window", 0, ImGuiWindowFlags_AlwaysAutoResize)) {
         if (ImGui::ColorEdit4("clear color", glm::value_ptr(m_clearColor)))
             glClearColor(m_clearColor.r, m_clearColor.g, m_clearColor.b, m_clearColor.a);
@@ -136,8 +233,87 @@ void    Context::Render(void)
             ImGui::Checkbox("blinn Mode", &this->m_blinn);
         }
         ImGui::Separator();
-        ImGui::Image((ImTextureID)m_shadowMap->GetShadowMap()->Get(),
-                    ImVec2(256, 256), ImVec2(0, 1), ImVec2(1, 0));
+        const auto& stats = m_renderQueue->GetStats();
+        ImGui::Text("draw calls: %d, binds avoided: %d",
+                    static_cast<int>(stats.drawCount), static_cast<int>(stats.bindsAvoided));
+        ImGui::Text("lod triangles saved: %d", static_cast<int>(stats.lodTrianglesSaved));
+        if (ImGui::DragFloat("lod pixel error", &this->m_lodPixelError, 0.1f, 0.0f, 16.0f))
+            m_renderQueue->SetLodPixelError(this->m_lodPixelError);
+        const auto& glStats = GLStateCache::Get().GetLastFrameStats();
+        ImGui::Text("gl state calls: %d issued, %d filtered",
+                    static_cast<int>(glStats.issued), static_cast<int>(glStats.filtered));
+        // Location Cache 전에는 SetUniform마다 glGetUniformLocation을 한 번씩 불렀다.
+        ImGui::Text("uniform sets: %d, name lookups: %d (uncached: %d glGetUniformLocation)",
+                    static_cast<int>(glStats.uniformSets), static_cast<int>(glStats.uniformLookups),
+                    static_cast<int>(glStats.uniformSets));
+        ImGui::Text("pending image uploads: %d", static_cast<int>(m_assetLoader->GetPendingCount()));
+        ImGui::DragFloat("upload budget (ms)", &this->m_uploadBudgetMs, 0.1f, 0.1f, 16.0f);
+        if (auto ring = m_assetLoader->GetUploadRing())
+            ImGui::Text("pbo uploaded: %.1f MB, stalls: %d",
+                        static_cast<float>(ring->GetStats().uploadedBytes) / (1024.0f * 1024.0f),
+                        static_cast<int>(ring->GetStats().stalls));
+        const auto& mipStats = m_assetLoader->GetMipmapStats();
+        ImGui::Text("cpu mipmaps: %d, %.2f ms/MP", static_cast<int>(mipStats.cpuCount),
+                    mipStats.cpuMegapixels > 0.0 ? static_cast<float>(mipStats.cpuMs / mipStats.cpuMegapixels) : 0.0f);
+        ImGui::Text("gl mipmaps: %d, %.2f ms/MP (gpu)", static_cast<int>(mipStats.glCount),
+                    mipStats.glMegapixels > 0.0 ? static_cast<float>(mipStats.glMs / mipStats.glMegapixels) : 0.0f);
+        if (ImGui::Button("mipmap benchmark"))
+            m_assetLoader->BenchmarkMipmap("./image/container2.png");
+        auto    textureStats = AssetCache<Texture>::Get().GetStats();
+        ImGui::Text("texture cache: %d hit, %d miss, %d live, %.1f MB",
+                    static_cast<int>(textureStats.hits), static_cast<int>(textureStats.misses),
+                    static_cast<int>(textureStats.liveCount),
+                    static_cast<float>(textureStats.memorySize) / (1024.0f * 1024.0f));
+        ImGui::Separator();
+        ImGui::Text("shadow pass: %.3f ms (gpu), %d draws skipped", static_cast<float>(m_shadowPassTimer->GetMs()),
+                    static_cast<int>(this->m_shadowDrawsSkipped));
+        ImGui::Checkbox("shadow static cache", &this->m_shadowCache);
+        ImGui::SameLine();
+        if (ImGui::Button("invalidate"))
+            ++this->m_staticShadowVersion;
+        ImGui::Checkbox("animate dynamic box", &this->m_animateDynamicBox);
+        if (this->m_modelRingNode != SceneGraph::INVALID_NODE
+            && ImGui::Checkbox("spin model ring", &this->m_spinModelRing))
+            ++this->m_staticShadowVersion;
+        if (ImGui::CollapsingHeader("Local Lights"))
+        {
+            if (ImGui::SliderInt("light count", &this->m_localLightCount, 0, m_localLights->GetLightCount()))
+                m_localLights->SetActiveCount(this->m_localLightCount);
+            if (ImGui::SliderInt("atlas tiles / frame", &this->m_shadowTileBudget, 1, 64))
+                m_localLights->SetTileBudget(this->m_shadowTileBudget);
+            const auto& atlasStats = m_localLights->GetStats();
+            const auto  atlas = m_localLights->GetAtlas();
+            ImGui::Text("shadowed lights: %d, atlas tiles: %d (%.0f%%)",
+                        static_cast<int>(atlasStats.lightsShadowed), static_cast<int>(atlas->GetTileCount()),
+                        atlas->GetOccupancy() * 100.0f);
+            ImGui::Text("tiles rendered: %d, deferred: %d",
+                        static_cast<int>(atlasStats.tilesRendered), static_cast<int>(atlasStats.tilesDirty));
+        }
+        if (ImGui::Checkbox("shadow hardware pcf", &this->m_shadowCompare))
+        {
+            m_shadowMap->SetCompareMode(this->m_shadowCompare);
+            m_cascadedShadowMap->SetCompareMode(this->m_shadowCompare);
+        }
+        if (this->m_shadowCompare)
+        {
+            ImGui::SliderInt("shadow samples", &this->m_shadowSampleCount, 1, 16);
+            ImGui::DragFloat("shadow filter radius (texel)", &this->m_shadowFilterRadius, 0.05f, 0.0f, 8.0f);
+        }
+        if (this->m_light.directional)
+        {
+            float   lambda = m_cascadedShadowMap->GetSplitLambda();
+            if (ImGui::DragFloat("cascade split lambda", &lambda, 0.01f, 0.0f, 1.0f))
+                m_cascadedShadowMap->SetSplitLambda(lambda);
+            float   distance = m_cascadedShadowMap->GetShadowDistance();
+            if (ImGui::DragFloat("shadow distance", &distance, 0.5f, 1.0f, 100.0f))
+                m_cascadedShadowMap->SetShadowDistance(distance);
+            for (int cascade = 0; cascade < m_cascadedShadowMap->GetCascadeCount(); ++cascade)
+                ImGui::Text("cascade %d: ~%.2f, %.3f m/texel", cascade, m_cascadedShadowMap->GetSplit(cascade),
+                            m_cascadedShadowMap->GetTexelSize(cascade));
+        }
+        else
+            ImGui::Image((ImTextureID)m_shadowMap->GetPreviewTexture(),
+                        ImVec2(256, 256), ImVec2(0, 1), ImVec2(1, 0));
     }
     ImGui::End();
 
@@ -145,111 +321,223 @@ void    Context::Render(void)
                     glm::rotate(glm::mat4(1.0f), glm::radians(this->m_cameraPitch), glm::vec3(1.0f, 0.0f, 0.0f)) *
                     glm::vec4(0.0f, 0.0f, -1.0f, 0.0f);
 
-    glm::mat4   projection = glm::perspective(glm::radians(45.0f),
-                                            static_cast<float>(this->m_width) / static_cast<float>(this->m_height),
-                                            0.1f, 100.0f);
+    const float fovy = glm::radians(45.0f);
+    const float aspect = static_cast<float>(this->m_width) / static_cast<float>(this->m_height);
+    const float nearPlane = 0.1f;
+    const float farPlane = 100.0f;
+    glm::mat4   projection = glm::perspective(fovy, aspect, nearPlane, farPlane);
     glm::mat4   view = glm::lookAt(m_cameraPos, m_cameraPos + m_cameraFront, m_cameraUp);
     
+    // Spot Light는 한 장의 Perspective Shadow Map, Directional Light는 카메라 Frustum을 나눈 Cascade
     auto lightView = glm::lookAt(m_light.position,
                                 m_light.position + m_light.direction,
                                 glm::vec3(0.0f, 1.0f, 0.0f));
-    auto lightProjection = m_light.directional ?
-                            glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, 1.0f, 30.0f) :
-                            glm::perspective(
-                                glm::radians((m_light.cutoff[0] + m_light.cutoff[1]) * 2.0f),
-                                1.0f, 1.0f, 20.0f);
-
-    m_shadowMap->Bind();
-    glClear(GL_DEPTH_BUFFER_BIT);
-    glViewport(0, 0, m_shadowMap->GetShadowMap()->GetWidth(),
-            m_shadowMap->GetShadowMap()->GetHeight());
+    auto lightProjection = glm::perspective(glm::radians((m_light.cutoff[0] + m_light.cutoff[1]) * 2.0f),
+                                            1.0f, 1.0f, 20.0f);
+    float   shadowMapHeight = static_cast<float>(m_shadowMap->GetShadowMap()->GetHeight());
+    if (this->m_light.directional)
+    {
+        m_cascadedShadowMap->Update(view, fovy, aspect, nearPlane, farPlane, this->m_light.direction);
+        // Queue의 정렬 / LOD 용. 실제 그릴 때는 Cascade마다 다시 지정한다.
+        int lastCascade = m_cascadedShadowMap->GetCascadeCount() - 1;
+        lightView = m_cascadedShadowMap->GetView(lastCascade);
+        lightProjection = m_cascadedShadowMap->GetProjection(lastCascade);
+        shadowMapHeight = static_cast<float>(m_cascadedShadowMap->GetResolution());
+    }
+
+    // 프레임마다 Block 단위로 한 번씩만 올린다.
+    CameraBlock cameraBlock;
+    cameraBlock.view = view;
+    cameraBlock.projection = projection;
+    cameraBlock.viewPos = this->m_cameraPos;
+    this->m_cameraBuffer->Update(cameraBlock);
+
+    LightBlock  lightBlock;
+    lightBlock.transform = lightProjection * lightView;
+    lightBlock.position = this->m_light.position;
+    lightBlock.directional = this->m_light.directional ? 1 : 0;
+    lightBlock.direction = this->m_light.direction;
+    lightBlock.blinn = this->m_blinn ? 1 : 0;
+    lightBlock.attenuation = GetAttenuationCoeff(this->m_light.distance);
+    lightBlock.ambient = this->m_light.ambient;
+    lightBlock.diffuse = this->m_light.diffuse;
+    lightBlock.specular = this->m_light.specular;
+    lightBlock.cutoff = glm::vec2(cosf(glm::radians(this->m_light.cutoff[0])),
+                                cosf(glm::radians(this->m_light.cutoff[0] + this->m_light.cutoff[1])));
+    lightBlock.cascadeCount = m_cascadedShadowMap->GetCascadeCount();
+    for (int cascade = 0; cascade < lightBlock.cascadeCount; ++cascade)
+    {
+        lightBlock.cascadeTransforms[cascade] = m_cascadedShadowMap->GetTransform(cascade);
+        lightBlock.cascadeSplits[cascade] = m_cascadedShadowMap->GetSplit(cascade);
+        lightBlock.cascadeTexelSizes[cascade] = m_cascadedShadowMap->GetTexelSize(cascade);
+    }
+    this->m_lightBuffer->Update(lightBlock);
+
+    // Blinn / Directional은 Runtime 분기 대신 Compile 시점의 Variant로 고른다.
+    std::vector<std::string>    lightingDefines;
+    if (this->m_blinn)
+        lightingDefines.push_back("BLINN");
+    if (this->m_light.directional)
+        lightingDefines.push_back("DIRECTIONAL_LIGHT");
+    if (this->m_shadowCompare)
+        lightingDefines.push_back("SHADOW_COMPARE");
+    const Program*  lightingShadowProgram = m_lightingShadowVariants->Get(lightingDefines);
+    // Packed Vertex Mesh는 vertex_input.glsl에서 Decode 하는 Variant로 그린다.
+    lightingDefines.push_back("PACKED_VERTEX");
+    const Program*  packedLightingShadowProgram = m_lightingShadowVariants->Get(lightingDefines);
+
+    // 바뀐 Node 아래만 Model::Submit의 SceneGraph::Update()에서 다시 계산된다.
+    if (this->m_spinModelRing)
+    {
+        const glm::vec3 ringCenter(0.0f, 1.32f, 0.0f);
+        m_model->GetSceneGraph()->SetLocalTransform(this->m_modelRingNode,
+            glm::translate(glm::mat4(1.0f), ringCenter) *
+            glm::rotate(glm::mat4(1.0f), static_cast<float>(glfwGetTime()), glm::vec3(0.0f, 1.0f, 0.0f)) *
+            glm::translate(glm::mat4(1.0f), -ringCenter));
+    }
+
+    // 그릴 물체들을 Queue에 모아 Pass / Program / Material / 깊이 순으로 정렬한다.
+    m_renderQueue->Clear();
+    m_renderQueue->SetPassCamera(SHADOW_PASS, lightView, lightProjection, shadowMapHeight);
+    m_renderQueue->SetPassCamera(MAIN_PASS, view, projection, static_cast<float>(m_height));
+    m_renderQueue->SetPassCamera(SHADOW_DYNAMIC_PASS, lightView, lightProjection, shadowMapHeight);
+    SubmitScene(SHADOW_PASS, SHADOW_DYNAMIC_PASS, m_simpleProgram.get());
+    SubmitScene(MAIN_PASS, MAIN_PASS, lightingShadowProgram, packedLightingShadowProgram);
+
+    m_renderQueue->Sort();
+
+    // Shadow Cache : 정적 물체(SHADOW_PASS)는 Cache가 유효하지 않을 때만 Static Target에 그리고,
+    // 매 프레임 복사한 뒤 움직이는 물체(SHADOW_DYNAMIC_PASS)만 위에 그린다.
+    size_t  staticDrawCount = m_renderQueue->GetItemCount(SHADOW_PASS);
+    this->m_shadowDrawsSkipped = 0;
+    m_shadowPassTimer->Begin();
     m_simpleProgram->Use();
-    m_simpleProgram->SetUniform("color", glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
-    DrawScene(lightView, lightProjection, m_simpleProgram.get());
+    m_simpleProgram->SetUniform(this->m_simpleColorId, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
+    if (this->m_light.directional)
+    {
+        for (int cascade = 0; cascade < m_cascadedShadowMap->GetCascadeCount(); ++cascade)
+        {
+            for (auto pass : { SHADOW_PASS, SHADOW_DYNAMIC_PASS })
+                m_renderQueue->SetPassCamera(pass, m_cascadedShadowMap->GetView(cascade),
+                                            m_cascadedShadowMap->GetProjection(cascade), shadowMapHeight);
+            if (!this->m_shadowCache)
+            {
+                m_cascadedShadowMap->BindCascade(cascade);
+                glClear(GL_DEPTH_BUFFER_BIT);
+                m_renderQueue->Execute(SHADOW_PASS);
+                m_renderQueue->Execute(SHADOW_DYNAMIC_PASS);
+                continue;
+            }
+            auto&   key = m_cascadedShadowMap->GetStaticKey(cascade);
+            glm::mat4   transform = m_cascadedShadowMap->GetTransform(cascade);
+            if (!key.Matches(transform, this->m_staticShadowVersion))
+            {
+                m_cascadedShadowMap->BindStaticCascade(cascade);
+                glClear(GL_DEPTH_BUFFER_BIT);
+                m_renderQueue->Execute(SHADOW_PASS);
+                key.Set(transform, this->m_staticShadowVersion);
+            }
+            else
+                this->m_shadowDrawsSkipped += staticDrawCount;
+            m_cascadedShadowMap->CopyStaticCascade(cascade);
+            m_cascadedShadowMap->BindCascade(cascade);
+            m_renderQueue->Execute(SHADOW_DYNAMIC_PASS);
+        }
+    }
+    else
+    {
+        glViewport(0, 0, m_shadowMap->GetShadowMap()->GetWidth(),
+                m_shadowMap->GetShadowMap()->GetHeight());
+        auto&       key = m_shadowMap->GetStaticKey();
+        glm::mat4   transform = lightProjection * lightView;
+        if (!this->m_shadowCache)
+        {
+            m_shadowMap->Bind();
+            glClear(GL_DEPTH_BUFFER_BIT);
+            m_renderQueue->Execute(SHADOW_PASS);
+        }
+        else if (!key.Matches(transform, this->m_staticShadowVersion))
+        {
+            m_shadowMap->BindStatic();
+            glClear(GL_DEPTH_BUFFER_BIT);
+            m_renderQueue->Execute(SHADOW_PASS);
+            key.Set(transform, this->m_staticShadowVersion);
+        }
+        else
+            this->m_shadowDrawsSkipped += staticDrawCount;
+        if (this->m_shadowCache)
+        {
+            m_shadowMap->CopyStatic();
+            m_shadowMap->Bind();
+        }
+        m_renderQueue->Execute(SHADOW_DYNAMIC_PASS);
+    }
+    // 여러 Light의 Shadow : 중요도로 Atlas Tile을 나누고 예산만큼만 다시 그린다.
+    m_localLights->Update(view, projection, static_cast<float>(m_height));
+    m_localLights->RenderShadows(m_renderQueue.get());
+    m_shadowPassTimer->End();
 
     FrameBuffer::BindToDefault();
     glViewport(0, 0, m_width, m_height);
 
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     
-    glEnable(GL_DEPTH_TEST);
+    GLStateCache::Get().Enable(GL_DEPTH_TEST);
 
     // Sky Box
     auto    skyboxModelTransform = glm::translate(glm::mat4(1.0f), m_cameraPos) *
                                     glm::scale(glm::mat4(1.0f), glm::vec3(50.0f));
     m_skyboxProgram->Use();
-    m_cubeTexture->Bind();
-    m_skyboxProgram->SetUniform("skybox", 0);
-    m_skyboxProgram->SetUniform("transform", projection * view * skyboxModelTransform);
+    m_cubeTexture->Bind(0);
+    m_skyboxProgram->SetUniform(this->m_skyboxId, 0);
+    m_skyboxProgram->SetUniform(m_skyboxProgram->GetTransformId(), projection * view * skyboxModelTransform);
     m_box->Draw(m_skyboxProgram.get());
 
-    // Lighting + Shadow 생성
-    m_lightingShadowProgram->Use();
-    m_lightingShadowProgram->SetUniform("viewPos", this->m_cameraPos);
-    m_lightingShadowProgram->SetUniform("light.directional", m_light.directional ? 1 : 0);
-    m_lightingShadowProgram->SetUniform("light.position", m_light.position);
-    m_lightingShadowProgram->SetUniform("light.direction", m_light.direction);
-    m_lightingShadowProgram->SetUniform("light.cutoff", glm::vec2(
-                                        cosf(glm::radians(this->m_light.cutoff[0])),
-                                        cosf(glm::radians(this->m_light.cutoff[0] + this->m_light.cutoff[1]))));
-    m_lightingShadowProgram->SetUniform("light.attenuation", GetAttenuationCoeff(m_light.distance));
-    m_lightingShadowProgram->SetUniform("light.ambient", this->m_light.ambient);
-    m_lightingShadowProgram->SetUniform("light.diffuse", this->m_light.diffuse);
-    m_lightingShadowProgram->SetUniform("light.specular", this->m_light.specular);
-    m_lightingShadowProgram->SetUniform("blinn", (this->m_blinn ? 1 : 0));
-    m_lightingShadowProgram->SetUniform("lightTransform", lightProjection * lightView);
-    glActiveTexture(GL_TEXTURE3);
-    m_shadowMap->GetShadowMap()->Bind();
-    m_lightingShadowProgram->SetUniform("shadowMap", 3);
-    glActiveTexture(GL_TEXTURE0);
-
-    DrawScene(view, projection, m_lightingShadowProgram.get());
-
-
-    // Plane 생성
-    auto    modelTransform = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -0.5f, 0.0f)) *
-                            glm::scale(glm::mat4(1.0f), glm::vec3(10.0f, 1.0f, 10.0f));
-    auto    transform = projection * view * modelTransform;
-    m_program->SetUniform("transform", transform);
-    m_program->SetUniform("modelTransform", modelTransform);
-    m_planeMaterial->SetToProgram(m_program.get());
-    m_box->Draw(m_program.get());
-
-    // Box1 생성
-    modelTransform = glm::translate(glm::mat4(1.0f), glm::vec3(-1.0f, 0.75f, -4.0f)) *
-                    glm::rotate(glm::mat4(1.0f), glm::radians(30.0f), glm::vec3(0.0f, 1.0f, 0.0f)) *
-                    glm::scale(glm::mat4(1.0f), glm::vec3(1.5f, 1.5f, 1.5f));
-    transform = projection * view * modelTransform;
-    m_program->SetUniform("transform", transform);
-    m_program->SetUniform("modelTransform", modelTransform);
-    m_box1Material->SetToProgram(m_program.get());
-    m_box->Draw(m_program.get());
-
-    // Box2 생성
-    modelTransform = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.75f, 2.0f)) *
-                    glm::rotate(glm::mat4(1.0f), glm::radians(20.0f), glm::vec3(0.0f, 1.0f, 0.0f)) *
-                    glm::scale(glm::mat4(1.0f), glm::vec3(1.5f, 1.5f, 1.5f));
-    transform = projection * view * modelTransform;
-    m_program->SetUniform("transform", transform);
-    m_program->SetUniform("modelTransform", modelTransform);
-    m_box2Material->SetToProgram(m_program.get());
-    m_box->Draw(m_program.get());
+    // Lighting + Shadow 생성 : Texture는 한 번 Bind하고 Sampler / 설정은 두 Variant에 모두 넣는다.
+    if (this->m_light.directional)
+        m_cascadedShadowMap->BindTexture(4);
+    else
+        m_shadowMap->GetShadowMap()->Bind(3);
+    m_localLights->BindAtlas(5);
+    const Program*  lightingPrograms[] = { lightingShadowProgram, packedLightingShadowProgram };
+    for (int index = 0; index < 2; ++index)
+    {
+        const Program*  program = lightingPrograms[index];
+        auto&           uniforms = this->m_lightingUniforms[index];
+        if (!program)
+            continue;
+        if (uniforms.program != program)
+        {
+            uniforms.program = program;
+            uniforms.shadowMap = program->GetUniformId("shadowMap");
+            uniforms.cascadeShadowMap = program->GetUniformId("cascadeShadowMap");
+            uniforms.shadowSampleCount = program->GetUniformId("shadowSampleCount");
+            uniforms.shadowFilterRadius = program->GetUniformId("shadowFilterRadius");
+            uniforms.shadowAtlas = program->GetUniformId("shadowAtlas");
+            uniforms.localLightCount = program->GetUniformId("localLightCount");
+        }
+        program->Use();
+        if (this->m_light.directional)
+            program->SetUniform(uniforms.cascadeShadowMap, 4);
+        else
+            program->SetUniform(uniforms.shadowMap, 3);
+        program->SetUniform(uniforms.shadowSampleCount, this->m_shadowSampleCount);
+        program->SetUniform(uniforms.shadowFilterRadius, this->m_shadowFilterRadius);
+        program->SetUniform(uniforms.shadowAtlas, 5);
+        program->SetUniform(uniforms.localLightCount, m_localLights->GetActiveCount());
+    }
+    m_renderQueue->Execute(MAIN_PASS);
 
     // Normal Map
-    modelTransform = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 3.0f, 0.0f)) *
-                    glm::rotate(glm::mat4(1.0f), glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+    auto    modelTransform = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 3.0f, 0.0f)) *
+                            glm::rotate(glm::mat4(1.0f), glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
     m_normalProgram->Use();
-    m_normalProgram->SetUniform("viewPos", m_cameraPos);
-    m_normalProgram->SetUniform("lightPos", m_light.position);
-    glActiveTexture(GL_TEXTURE0);
-    m_brickDiffuseTexture->Bind();
-    m_normalProgram->SetUniform("diffuse", 0);
-    glActiveTexture(GL_TEXTURE1);
-    m_brickNormalTexture->Bind();
-    m_normalProgram->SetUniform("normalMap", 1);
-    glActiveTexture(GL_TEXTURE0);
-    m_normalProgram->SetUniform("modelTransform", modelTransform);
-    m_normalProgram->SetUniform("transform", projection * view * modelTransform);
+    m_brickDiffuseTexture->Bind(0);
+    m_normalProgram->SetUniform(this->m_normalDiffuseId, 0);
+    m_brickNormalTexture->Bind(1);
+    m_normalProgram->SetUniform(this->m_normalMapId, 1);
+    m_normalProgram->SetUniform(m_normalProgram->GetModelTransformId(), modelTransform);
+    m_normalProgram->SetUniform(m_normalProgram->GetTransformId(), projection * view * modelTransform);
     m_plane->Draw(m_normalProgram.get());
 };
 
@@ -327,51 +615,57 @@ bool    Context::init(void)
 {
     // Multisample Anti-Aliasing
     glEnable(GL_MULTISAMPLE);
+    // Image / Mip Level의 행은 byte 단위로 붙어 있다. (RGB8의 작은 Level은 4의 배수가 아니다.)
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
     this->m_box = Mesh::CreateBox();
     this->m_plane = Mesh::CreatePlane();
-
-    // Shader, Program 생성
-	this->m_program = Program::Create("./shader/lighting.vs", "./shader/lighting.fs");
-    if (!this->m_program)
-        return (false);
-    this->m_simpleProgram = Program::Create("./shader/simple.vs", "./shader/simple.fs");
-    if (!this->m_simpleProgram)
-        return (false);
-    this->m_textureProgram = Program::Create("./shader/texture.vs", "./shader/texture.fs");
-    if (!m_textureProgram)
-        return (false);
-    this->m_postProgram = Program::Create("./shader/texture.vs", "./shader/invert.fs");
-    if (!m_postProgram)
-        return (false);
-    this->m_gammaProgram = Program::Create("./shader/texture.vs", "./shader/gamma.fs");
-    if (!m_gammaProgram)
+    this->m_renderQueue = RenderQueue::Create();
+    this->m_assetLoader = AssetLoader::Create();
+
+    // Shader, Program 생성 : 모두 한 번에 Compile을 넘기고 결과는 마지막에 확인한다.
+    auto    programBatch = ProgramBatch::Create();
+    programBatch->Add(&this->m_program, "./shader/lighting.vs", "./shader/lighting.fs");
+    programBatch->Add(&this->m_simpleProgram, "./shader/simple.vs", "./shader/simple.fs");
+    programBatch->Add(&this->m_textureProgram, "./shader/texture.vs", "./shader/texture.fs");
+    programBatch->Add(&this->m_postProgram, "./shader/texture.vs", "./shader/invert.fs");
+    programBatch->Add(&this->m_gammaProgram, "./shader/texture.vs", "./shader/gamma.fs");
+    programBatch->Add(&this->m_skyboxProgram, "./shader/skybox.vs", "./shader/skybox.fs");
+    programBatch->Add(&this->m_envMapProgram, "./shader/envmap.vs", "./shader/envmap.fs");
+    programBatch->Add(&this->m_grassProgram, "./shader/grass.vs", "./shader/grass.fs");
+    this->m_lightingShadowVariants = ProgramVariants::Create("./shader/lighting_shadow.vs",
+                                                            "./shader/lighting_shadow.fs");
+    for (auto& defines : std::vector<std::vector<std::string>> {
+            {}, { "BLINN" }, { "DIRECTIONAL_LIGHT" }, { "BLINN", "DIRECTIONAL_LIGHT" } })
+    {
+        for (auto compare : { false, true })
+        {
+            auto    variantDefines = defines;
+            if (compare)
+                variantDefines.push_back("SHADOW_COMPARE");
+            this->m_lightingShadowVariants->AddToBatch(programBatch.get(), variantDefines);
+            variantDefines.push_back("PACKED_VERTEX");
+            this->m_lightingShadowVariants->AddToBatch(programBatch.get(), variantDefines);
+        }
+    }
+    programBatch->Add(&this->m_normalProgram, "./shader/normal.vs", "./shader/normal.fs");
+    if (!programBatch->Submit())
         return (false);
 
-    // Sky Box
-    auto    CubeR = Image::Load("./image/skybox/right.jpg", false);
-    auto    CubeL = Image::Load("./image/skybox/left.jpg", false);
-    auto    CubeU = Image::Load("./image/skybox/top.jpg", false);
-    auto    CubeD = Image::Load("./image/skybox/bottom.jpg", false);
-    auto    CubeF = Image::Load("./image/skybox/front.jpg", false);
-    auto    CubeB = Image::Load("./image/skybox/back.jpg", false);
-    this->m_cubeTexture = CubeTexture::CreateFromImages({
-            CubeR.get(), 
-            CubeL.get(), 
-            CubeU.get(), 
-            CubeD.get(), 
-            CubeF.get(), 
-            CubeB.get()
-    });
-    this->m_skyboxProgram = Program::Create("./shader/skybox.vs", "./shader/skybox.fs");
-    if (!m_skyboxProgram)
-        return (false);
-    this->m_envMapProgram = Program::Create("./shader/envmap.vs", "./shader/envmap.fs");
-    if (!m_envMapProgram)
-        return (false);
+    // Sky Box : KTX2 한 파일(6면)을 mmap 해서 올린다. 처음 실행 때는 6면을 Decode 해서 만든다.
+    // 그 전까지는 단색 Placeholder
+    this->m_cubeTexture = m_assetLoader->LoadKtxCubeTexture("./cache/texture/skybox.ktx2", {
+            "./image/skybox/right.jpg",
+            "./image/skybox/left.jpg",
+            "./image/skybox/top.jpg",
+            "./image/skybox/bottom.jpg",
+            "./image/skybox/front.jpg",
+            "./image/skybox/back.jpg"
+    }, false, glm::vec4(0.1f, 0.2f, 0.3f, 1.0f));
 
     // Grass
-    this->m_grassTexture = Texture::CreateFromImage(Image::Load("./image/grass.png").get());
-    this->m_grassProgram = Program::Create("./shader/grass.vs", "./shader/grass.fs");
+    // grass.fs의 discard 기준(0.05)으로 Mip의 Alpha Coverage를 맞춘다.
+    this->m_grassTexture = m_assetLoader->LoadCompressedTexture("./image/grass.png", true, false,
+                                                                glm::vec4(0.0f), 0.05f);
     this->m_grassPos.resize(10000);
     for (size_t idx = 0; idx < m_grassPos.size(); ++idx)
     {
@@ -397,40 +691,83 @@ bool    Context::init(void)
     m_plane->GetIndexBuffer()->Bind();
 
     // Texture 설정
-    TextureSPtr darkGrayTexture = Texture::CreateFromImage(
-                                    Image::CreateSingleColorImage(4, 4,
-                                    glm::vec4(0.2f, 0.2f, 0.2f, 1.0f)).get());
-    TextureSPtr grayTexture = Texture::CreateFromImage(
-                                    Image::CreateSingleColorImage(4, 4,
-                                    glm::vec4(0.5f, 0.5f, 0.5f, 1.0f)).get());
+    TextureSPtr darkGrayTexture = Texture::CreateSingleColor(glm::vec4(0.2f, 0.2f, 0.2f, 1.0f));
+    TextureSPtr grayTexture = Texture::CreateSingleColor(glm::vec4(0.5f, 0.5f, 0.5f, 1.0f));
 
-    this->m_windowTexture = Texture::CreateFromImage(
-                                    Image::Load("./image/blending_transparent_window.png").get());
+    this->m_windowTexture = m_assetLoader->LoadCompressedTexture("./image/blending_transparent_window.png",
+                                                    true, false, glm::vec4(0.0f));
 
     m_planeMaterial = Material::Create();
-    m_planeMaterial->diffuse = Texture::CreateFromImage(Image::Load("./image/marble.jpg").get());
+    m_planeMaterial->diffuse = m_assetLoader->LoadCompressedTexture("./image/marble.jpg");
     m_planeMaterial->specular = grayTexture;
     m_planeMaterial->shininess = 4.0f;
 
     m_box1Material = Material::Create();
-    m_box1Material->diffuse = Texture::CreateFromImage(Image::Load("./image/container.jpg").get());
+    m_box1Material->diffuse = m_assetLoader->LoadCompressedTexture("./image/container.jpg");
     m_box1Material->specular = darkGrayTexture;
     m_box1Material->shininess = 16.0f;
 
     m_box2Material = Material::Create();
-    m_box2Material->diffuse = Texture::CreateFromImage(Image::Load("./image/container2.png").get());
-    m_box2Material->specular = Texture::CreateFromImage(Image::Load("./image/container2_specular.png").get());;
+    m_box2Material->diffuse = m_assetLoader->LoadCompressedTexture("./image/container2.png");
+    m_box2Material->specular = m_assetLoader->LoadCompressedTexture("./image/container2_specular.png",
+                                                        true, false, glm::vec4(0.2f, 0.2f, 0.2f, 1.0f));
     m_box2Material->shininess = 64.0f;
 
-    m_shadowMap = ShadowMap::Create(1024, 1024);
-    m_lightingShadowProgram = Program::Create("./shader/lighting_shadow.vs",
-                                            "./shader/lighting_shadow.fs");
+    // Mesh마다 LOD 4단계 : 멀어지면 RenderQueue가 거친 Level로 바꿔 그린다.
+    this->m_model = Model::Load("./model/ring_stand.obj", false, VERTEX_FORMAT_PACKED, 4);
+    if (!this->m_model)
+        return (false);
+    // OBJ의 Object("o Ring")마다 Node가 하나씩 생긴다.
+    this->m_modelRingNode = m_model->GetSceneGraph()->FindNode("Ring");
+
+    m_shadowMap = ShadowMap::Create(1024, 1024, this->m_shadowCompare);
+    // Spot Light의 1024x1024 한 장과 같은 Texel 수 (512x512 x 4)
+    m_cascadedShadowMap = CascadedShadowMap::Create(512, 4, this->m_shadowCompare);
+    if (!m_shadowMap || !m_cascadedShadowMap)
+        return (false);
+    m_shadowPassTimer = GpuTimer::Create();
+
+    // 4096x4096 Atlas, Tile은 64 ~ 1024. 바닥 둘레에 Spot / Point Light를 번갈아 놓는다.
+    m_localLights = LocalLightSet::Create(4096, 64, 1024);
+    if (!m_localLights)
+        return (false);
+    for (int index = 0; index < LocalLightSet::MAX_LIGHT_COUNT; ++index)
+    {
+        LocalLightSet::Light    light;
+        float   angle = glm::radians(360.0f * index / LocalLightSet::MAX_LIGHT_COUNT);
+        float   radius = (index % 2) ? 6.0f : 12.0f;
+        light.type = (index % 3 == 0) ? LOCAL_LIGHT_POINT : LOCAL_LIGHT_SPOT;
+        light.position = glm::vec3(std::cos(angle) * radius, 3.0f, std::sin(angle) * radius);
+        light.direction = glm::vec3(-std::cos(angle), -1.5f, -std::sin(angle));
+        light.color = glm::vec3(0.5f + 0.5f * std::cos(angle), 0.5f + 0.5f * std::cos(angle + 2.1f),
+                                0.5f + 0.5f * std::cos(angle + 4.2f)) * 4.0f;
+        light.range = 10.0f;
+        light.cutoff = glm::vec2(25.0f, 10.0f);
+        m_localLights->AddLight(light);
+    }
+    m_localLights->SetActiveCount(this->m_localLightCount);
+    m_localLights->SetTileBudget(this->m_shadowTileBudget);
+
+    m_brickDiffuseTexture = m_assetLoader->LoadCompressedTexture("./image/brickwall.jpg", false);
+    // 평평한 Normal (0, 0, 1). BC5로 RG만 저장하고 Z는 normal.fs에서 복원한다.
+    m_brickNormalTexture = m_assetLoader->LoadCompressedTexture("./image/brickwall_normal.jpg", false, true,
+                                                    glm::vec4(0.5f, 0.5f, 1.0f, 1.0f));
+
+    // Image를 읽는 동안 Driver가 Compile을 진행했으므로 여기서 결과만 확인한다.
+    if (!programBatch->Finish())
+        return (false);
+    this->m_simpleColorId = m_simpleProgram->GetUniformId("color");
+    this->m_skyboxId = m_skyboxProgram->GetUniformId("skybox");
+    this->m_normalDiffuseId = m_normalProgram->GetUniformId("diffuse");
+    this->m_normalMapId = m_normalProgram->GetUniformId("normalMap");
+
+    m_cameraBuffer = UniformBuffer::Create(CAMERA_BINDING, sizeof(CameraBlock));
+    m_lightBuffer = UniformBuffer::Create(LIGHT_BINDING, sizeof(LightBlock));
+    if (!m_cameraBuffer || !m_lightBuffer)
+        return (false);
 
-    m_brickDiffuseTexture = Texture::CreateFromImage(
-                                Image::Load("./image/brickwall.jpg", false).get());
-    m_brickNormalTexture = Texture::CreateFromImage(
-                                Image::Load("./image/brickwall_normal.jpg", false).get());
-    m_normalProgram = Program::Create("./shader/normal.vs", "./shader/normal.fs");
+    // Cold start(전부 miss)와 Warm start(전부 hit)의 Program 생성 시간을 비교할 수 있다.
+    ProgramBinaryCache::Get().PrintStats();
 
     // 배경 Clear 색상 지정
     glClearColor(0.1f, 0.2f, 0.3f, 0.0f);
@@ -438,47 +775,39 @@ bool    Context::init(void)
     return (true);
 };
 
-void    Context::DrawScene(const glm::mat4 view, const glm::mat4& projection, const Program* program)
+void    Context::SubmitScene(RenderPass pass, RenderPass dynamicPass, const Program* program,
+                            const Program* packedProgram)
 {
-    program->Use();
     auto modelTransform =
         glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -0.5f, 0.0f)) *
         glm::scale(glm::mat4(1.0f), glm::vec3(40.0f, 1.0f, 40.0f));
-    auto transform = projection * view * modelTransform;
-    program->SetUniform("transform", transform);
-    program->SetUniform("modelTransform", modelTransform);
-    m_planeMaterial->SetToProgram(program);
-    m_box->Draw(program);
+    m_renderQueue->Submit(pass, m_box.get(), m_planeMaterial.get(), program, modelTransform);
 
     modelTransform =
         glm::translate(glm::mat4(1.0f), glm::vec3(-1.0f, 0.75f, -4.0f)) *
         glm::rotate(glm::mat4(1.0f), glm::radians(30.0f), glm::vec3(0.0f, 1.0f, 0.0f)) *
         glm::scale(glm::mat4(1.0f), glm::vec3(1.5f, 1.5f, 1.5f));
-    transform = projection * view * modelTransform;
-    program->SetUniform("transform", transform);
-    program->SetUniform("modelTransform", modelTransform);
-    m_box1Material->SetToProgram(program);
-    m_box->Draw(program);
+    m_renderQueue->Submit(pass, m_box.get(), m_box1Material.get(), program, modelTransform);
 
     modelTransform =
         glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.75f, 2.0f)) *
         glm::rotate(glm::mat4(1.0f), glm::radians(20.0f), glm::vec3(0.0f, 1.0f, 0.0f)) *
         glm::scale(glm::mat4(1.0f), glm::vec3(1.5f, 1.5f, 1.5f));
-    transform = projection * view * modelTransform;
-    program->SetUniform("transform", transform);
-    program->SetUniform("modelTransform", modelTransform);
-    m_box2Material->SetToProgram(program);
-    m_box->Draw(program);
+    m_renderQueue->Submit(pass, m_box.get(), m_box2Material.get(), program, modelTransform);
+
+    modelTransform =
+        glm::translate(glm::mat4(1.0f), glm::vec3(-3.0f, 0.0f, 1.0f)) *
+        glm::rotate(glm::mat4(1.0f), glm::radians(30.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    m_model->Submit(m_renderQueue.get(), this->m_spinModelRing ? dynamicPass : pass,
+                    program, modelTransform, packedProgram);
 
+    // 움직이는 Box : Shadow Cache에 들어가지 않는다.
+    float   angle = 50.0f + (this->m_animateDynamicBox ? static_cast<float>(glfwGetTime()) * 30.0f : 0.0f);
     modelTransform =
         glm::translate(glm::mat4(1.0f), glm::vec3(3.0f, 1.75f, -2.0f)) *
-        glm::rotate(glm::mat4(1.0f), glm::radians(50.0f), glm::vec3(0.0f, 1.0f, 0.0f)) *
+        glm::rotate(glm::mat4(1.0f), glm::radians(angle), glm::vec3(0.0f, 1.0f, 0.0f)) *
         glm::scale(glm::mat4(1.0f), glm::vec3(1.5f, 1.5f, 1.5f));
-    transform = projection * view * modelTransform;
-    program->SetUniform("transform", transform);
-    program->SetUniform("modelTransform", modelTransform);
-    m_box2Material->SetToProgram(program);
-    m_box->Draw(program);
+    m_renderQueue->Submit(dynamicPass, m_box.get(), m_box2Material.get(), program, modelTransform);
 };
 
 #endif
\ No newline at end of file
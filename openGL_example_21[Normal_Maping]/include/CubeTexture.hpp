@@ -2,21 +2,38 @@
 #define CUBETEXTURE_HPP
 
 #include "Common.hpp"
+#include "GLStateCache.hpp"
+#include "PixelUploadRing.hpp"
+#include "KtxImage.hpp"
 
 CLASS_PTR(CubeTexture);
 class CubeTexture
 {
 public:
     static CubeTextureUPtr  CreateFromImages(const std::vector<Image*>& images);
+    // Face가 6개인 KTX2 한 파일 (모든 Mip Level을 그대로 올린다.)
+    static CubeTextureUPtr  CreateFromImages(const KtxImage* image);
     
     ~CubeTexture();
     const uint32_t  Get(void) const { return (this->m_texture); };
     void            Bind(void) const;
+    void            Bind(uint32_t unit) const;
+    // 6면(+X, -X, +Y, -Y, +Z, -Z)을 같은 Texture Object에 다시 올린다.
+    // ring이 있으면 Staging Buffer를 거쳐 비동기로 올린다.
+    bool            SetImages(const std::vector<Image*>& images, PixelUploadRing* ring = nullptr);
+    bool            SetImages(const KtxImage* image, PixelUploadRing* ring = nullptr);
 private:
     uint32_t    m_texture {0};
+    int         m_width {0}, m_height {0};
+    uint32_t    m_internalFormat { GL_RGBA8 };
+    int         m_levelCount { 0 };     // 0이면 아직 저장 공간이 없다.
 
     CubeTexture() {};
+    void    CreateTexture(void);
+    // 6면을 Immutable Storage로 한 번만 잡는다. 모양이 바뀌면 Object를 새로 만든다.
+    void    AllocateStorage(int width, int height, uint32_t internalFormat, int levelCount);
     bool    InitFromImages(const std::vector<Image*>& images);
+    void    SetLevelCount(int levelCount);
 };
 
 CubeTextureUPtr CubeTexture::CreateFromImages(const std::vector<Image*>& images)
@@ -27,16 +44,31 @@ CubeTextureUPtr CubeTexture::CreateFromImages(const std::vector<Image*>& images)
     return std::move(texture);
 };
 
+CubeTextureUPtr CubeTexture::CreateFromImages(const KtxImage* image)
+{
+    auto texture = CubeTextureUPtr(new CubeTexture());
+    texture->CreateTexture();
+    if (!texture->SetImages(image))
+        return nullptr;
+    return std::move(texture);
+};
+
 CubeTexture::~CubeTexture()
 {
     if (this->m_texture)
+    {
+        GLStateCache::Get().ForgetTexture(this->m_texture);
         glDeleteTextures(1, &this->m_texture);
+    }
 };
 
 void    CubeTexture::Bind(void) const
-{ glBindTexture(GL_TEXTURE_CUBE_MAP, m_texture); };
+{ GLStateCache::Get().BindTexture(GL_TEXTURE_CUBE_MAP, m_texture); };
 
-bool    CubeTexture::InitFromImages(const std::vector<Image*>& images)
+void    CubeTexture::Bind(uint32_t unit) const
+{ GLStateCache::Get().BindTexture(unit, GL_TEXTURE_CUBE_MAP, m_texture); };
+
+void    CubeTexture::CreateTexture(void)
 {
     glGenTextures(1, &this->m_texture);
     Bind();
@@ -46,22 +78,117 @@ bool    CubeTexture::InitFromImages(const std::vector<Image*>& images)
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+};
+
+bool    CubeTexture::InitFromImages(const std::vector<Image*>& images)
+{
+    CreateTexture();
+    return (SetImages(images));
+};
 
+void    CubeTexture::AllocateStorage(int width, int height, uint32_t internalFormat, int levelCount)
+{
+    if (this->m_levelCount == levelCount && this->m_internalFormat == internalFormat
+        && this->m_width == width && this->m_height == height)
+        return ;
+    if (this->m_levelCount > 0)
+    {
+        GLStateCache::Get().ForgetTexture(this->m_texture);
+        glDeleteTextures(1, &this->m_texture);
+        CreateTexture();
+    }
+    this->m_width = width;
+    this->m_height = height;
+    this->m_internalFormat = internalFormat;
+    this->m_levelCount = levelCount;
+    glTexStorage2D(GL_TEXTURE_CUBE_MAP, levelCount, internalFormat, width, height);
+};
+
+void    CubeTexture::SetLevelCount(int levelCount)
+{
+    // 올린 Level까지만 쓰게 해야 Texture가 불완전해지지 않는다.
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, levelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+};
+
+bool    CubeTexture::SetImages(const std::vector<Image*>& images, PixelUploadRing* ring)
+{
+    if (images.size() != 6)
+        return (false);
+    for (auto image : images)
+    {
+        // 6면은 크기와 Channel 수가 같아야 한 Storage에 들어간다.
+        if (!image || image->GetWidth() != images[0]->GetWidth() || image->GetHeight() != images[0]->GetHeight()
+            || image->GetChannelCount() != images[0]->GetChannelCount())
+            return (false);
+    }
+    GLenum      format = GL_RGBA;
+    uint32_t    internalFormat = GL_RGBA8;
+    switch (images[0]->GetChannelCount())
+    {
+    default: break;
+    case 1: format = GL_RED; internalFormat = GL_R8; break;
+    case 2: format = GL_RG; internalFormat = GL_RG8; break;
+    case 3: format = GL_RGB; internalFormat = GL_RGB8; break;
+    }
+    Bind();
+    AllocateStorage(images[0]->GetWidth(), images[0]->GetHeight(), internalFormat, 1);
     for (uint32_t i = 0; i < images.size(); ++i)
     {
-        auto    image = images[i];
-        GLenum  format = GL_RGBA;
-        switch (image->GetChannelCount())
+        auto                        image = images[i];
+        GLenum                      face = GL_TEXTURE_CUBE_MAP_POSITIVE_X + i;
+        size_t                      size = static_cast<size_t>(image->GetWidth()) * image->GetHeight()
+                                            * image->GetChannelCount();
+        const void*                 pixels = image->GetData();
+        PixelUploadRing::Allocation allocation;
+        bool                        staged = ring && ring->Allocate(size, allocation);
+        if (staged)
+        {
+            memcpy(allocation.data, image->GetData(), size);
+            ring->Bind();
+            pixels = reinterpret_cast<const void*>(allocation.offset);
+        }
+        glTexSubImage2D(face, 0, 0, 0, image->GetWidth(), image->GetHeight(), format, GL_UNSIGNED_BYTE, pixels);
+        if (staged)
+            ring->Unbind();
+    }
+    SetLevelCount(1);
+    return (true);
+};
+
+bool    CubeTexture::SetImages(const KtxImage* image, PixelUploadRing* ring)
+{
+    if (!image || image->GetFaceCount() != 6)
+        return (false);
+    Bind();
+    uint32_t    internalFormat = image->GetGLInternalFormat();
+    AllocateStorage(image->GetWidth(), image->GetHeight(), internalFormat, image->GetLevelCount());
+    for (int level = 0; level < image->GetLevelCount(); ++level)
+    {
+        for (uint32_t i = 0; i < 6; ++i)
         {
-        default: break;
-        case 1: format = GL_RED; break;
-        case 2: format = GL_RG; break;
-        case 3: format = GL_RGB; break;
+            auto&       data = image->GetLevel(level, i);
+            GLenum      face = GL_TEXTURE_CUBE_MAP_POSITIVE_X + i;
+            const void* pixels = data.data;
+            PixelUploadRing::Allocation allocation;
+            bool        staged = ring && ring->Allocate(data.size, allocation);
+            if (staged)
+            {
+                memcpy(allocation.data, data.data, data.size);
+                ring->Bind();
+                pixels = reinterpret_cast<const void*>(allocation.offset);
+            }
+            if (image->IsCompressed())
+                glCompressedTexSubImage2D(face, level, 0, 0, data.width, data.height, internalFormat,
+                                        static_cast<GLsizei>(data.size), pixels);
+            else
+                glTexSubImage2D(face, level, 0, 0, data.width, data.height,
+                                image->GetGLFormat(), image->GetGLType(), pixels);
+            if (staged)
+                ring->Unbind();
         }
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB,
-                    image->GetWidth(), image->GetHeight(), 0,
-                    format, GL_UNSIGNED_BYTE, image->GetData());
     }
+    SetLevelCount(image->GetLevelCount());
     return (true);
 };
 
@@ -32,24 +32,27 @@ FrameBufferUPtr FrameBuffer::Create(const TextureSPtr colorAttachment)
 };
 
 void    FrameBuffer::BindToDefault()
-{ glBindFramebuffer(GL_FRAMEBUFFER, 0); };
+{ GLStateCache::Get().BindFramebuffer(0); };
 
 void    FrameBuffer::Bind() const
-{ glBindFramebuffer(GL_FRAMEBUFFER, this->m_FrameBuffer); };
+{ GLStateCache::Get().BindFramebuffer(this->m_FrameBuffer); };
 
 FrameBuffer::~FrameBuffer()
 {
     if (m_DepthStencilBuffer)
         glDeleteRenderbuffers(1, &m_DepthStencilBuffer);
     if (m_FrameBuffer)
+    {
+        GLStateCache::Get().ForgetFramebuffer(m_FrameBuffer);
         glDeleteFramebuffers(1, &m_FrameBuffer);
+    }
 };
 
 bool    FrameBuffer::InitWithColorAttachment(const TextureSPtr colorAttachment)
 {
     m_colorAttachment = colorAttachment;
     glGenFramebuffers(1, &this->m_FrameBuffer);
-    glBindFramebuffer(GL_FRAMEBUFFER, this->m_FrameBuffer);
+    Bind();
 
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
                         colorAttachment->Get(), 0);
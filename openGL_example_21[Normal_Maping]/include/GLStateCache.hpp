@@ -0,0 +1,284 @@
+#ifndef GLSTATECACHE_HPP
+#define GLSTATECACHE_HPP
+
+#include "Common.hpp"
+
+// 현재 GL에 Bind된 상태를 따라가면서 이미 같은 값이면 GL 호출을 생략한다.
+// 모든 Wrapper(Program, Buffer, VertexLayout, Texture, FrameBuffer ...)는 이 Class를 거쳐서 Bind 한다.
+class GLStateCache
+{
+public:
+    static GLStateCache&    Get(void);
+
+    struct Stats {
+        size_t  issued { 0 };
+        size_t  filtered { 0 };
+        // Uniform : Location Cache가 없으면 uniformSets만큼 glGetUniformLocation을 불렀다.
+        size_t  uniformSets { 0 };
+        size_t  uniformLookups { 0 };
+    };
+
+    // GL 외부(ImGui 등)에서 상태가 바뀌었을 수 있으므로 프레임마다 호출한다.
+    void    BeginFrame(void);
+    void    Invalidate(void);
+
+    void    UseProgram(uint32_t program);
+    void    BindVertexArray(uint32_t vertexArray);
+    void    BindBuffer(uint32_t target, uint32_t buffer);
+    void    BindBufferBase(uint32_t target, uint32_t index, uint32_t buffer);
+    void    ActiveTexture(uint32_t unit);
+    void    BindTexture(uint32_t target, uint32_t texture);
+    void    BindTexture(uint32_t unit, uint32_t target, uint32_t texture);
+    void    BindFramebuffer(uint32_t framebuffer);
+    void    SetCapability(uint32_t cap, bool enable);
+    void    Enable(uint32_t cap)
+    { SetCapability(cap, true); };
+    void    Disable(uint32_t cap)
+    { SetCapability(cap, false); };
+
+    // 삭제된 Object 이름은 다시 쓰일 수 있으므로 Cache에서 지운다.
+    void    ForgetProgram(uint32_t program);
+    void    ForgetVertexArray(uint32_t vertexArray);
+    void    ForgetBuffer(uint32_t buffer);
+    void    ForgetTexture(uint32_t texture);
+    void    ForgetFramebuffer(uint32_t framebuffer);
+
+    void    CountUniformSet(void)
+    { ++this->m_stats.uniformSets; };
+    void    CountUniformLookup(void)
+    { ++this->m_stats.uniformLookups; };
+
+    uint32_t        GetActiveTexture(void) const
+    { return (this->m_activeTexture); };
+    const Stats&    GetStats(void) const
+    { return (this->m_stats); };
+    const Stats&    GetLastFrameStats(void) const
+    { return (this->m_lastFrameStats); };
+private:
+    static const uint32_t   UNKNOWN = 0xFFFFFFFF;
+    static const int        MAX_TEXTURE_UNITS = 32;
+    enum TextureSlot { SLOT_2D, SLOT_2D_ARRAY, SLOT_CUBE_MAP, SLOT_COUNT };
+    enum BufferSlot { SLOT_ARRAY, SLOT_ELEMENT_ARRAY, SLOT_UNIFORM, SLOT_PIXEL_UNPACK, SLOT_SHADER_STORAGE, BUFFER_SLOT_COUNT };
+    enum CapSlot { CAP_BLEND, CAP_DEPTH_TEST, CAP_CULL_FACE, CAP_COUNT };
+
+    uint32_t    m_program { UNKNOWN };
+    uint32_t    m_vertexArray { UNKNOWN };
+    uint32_t    m_buffers[BUFFER_SLOT_COUNT];
+    uint32_t    m_activeTexture { UNKNOWN };
+    uint32_t    m_textures[MAX_TEXTURE_UNITS][SLOT_COUNT];
+    uint32_t    m_framebuffer { UNKNOWN };
+    int         m_caps[CAP_COUNT];
+
+    Stats       m_stats;
+    Stats       m_lastFrameStats;
+
+    GLStateCache(void)
+    { Invalidate(); };
+    static int  GetTextureSlot(uint32_t target);
+    static int  GetBufferSlot(uint32_t target);
+    static int  GetCapSlot(uint32_t cap);
+    bool        Filter(uint32_t& cached, uint32_t value);
+};
+
+GLStateCache&   GLStateCache::Get(void)
+{
+    static GLStateCache instance;
+    return (instance);
+};
+
+void    GLStateCache::BeginFrame(void)
+{
+    this->m_lastFrameStats = this->m_stats;
+    this->m_stats = Stats();
+    Invalidate();
+};
+
+void    GLStateCache::Invalidate(void)
+{
+    this->m_program = UNKNOWN;
+    this->m_vertexArray = UNKNOWN;
+    this->m_activeTexture = UNKNOWN;
+    this->m_framebuffer = UNKNOWN;
+    for (auto& buffer : this->m_buffers)
+        buffer = UNKNOWN;
+    for (auto& unit : this->m_textures)
+        for (auto& texture : unit)
+            texture = UNKNOWN;
+    for (auto& cap : this->m_caps)
+        cap = -1;
+};
+
+bool    GLStateCache::Filter(uint32_t& cached, uint32_t value)
+{
+    if (cached == value)
+    {
+        ++this->m_stats.filtered;
+        return (true);
+    }
+    cached = value;
+    ++this->m_stats.issued;
+    return (false);
+};
+
+void    GLStateCache::UseProgram(uint32_t program)
+{
+    if (!Filter(this->m_program, program))
+        glUseProgram(program);
+};
+
+void    GLStateCache::BindVertexArray(uint32_t vertexArray)
+{
+    if (Filter(this->m_vertexArray, vertexArray))
+        return ;
+    glBindVertexArray(vertexArray);
+    // Element Array Buffer는 VAO 상태이므로 VAO가 바뀌면 알 수 없다.
+    this->m_buffers[SLOT_ELEMENT_ARRAY] = UNKNOWN;
+};
+
+void    GLStateCache::BindBuffer(uint32_t target, uint32_t buffer)
+{
+    int slot = GetBufferSlot(target);
+    if (slot >= 0 && Filter(this->m_buffers[slot], buffer))
+        return ;
+    if (slot < 0)
+        ++this->m_stats.issued;
+    glBindBuffer(target, buffer);
+};
+
+void    GLStateCache::BindBufferBase(uint32_t target, uint32_t index, uint32_t buffer)
+{
+    // glBindBufferBase는 일반 binding point도 같이 바꾼다.
+    int slot = GetBufferSlot(target);
+    if (slot >= 0)
+        this->m_buffers[slot] = buffer;
+    ++this->m_stats.issued;
+    glBindBufferBase(target, index, buffer);
+};
+
+void    GLStateCache::ActiveTexture(uint32_t unit)
+{
+    if (!Filter(this->m_activeTexture, unit))
+        glActiveTexture(GL_TEXTURE0 + unit);
+};
+
+void    GLStateCache::BindTexture(uint32_t target, uint32_t texture)
+{
+    if (this->m_activeTexture == UNKNOWN)
+        ActiveTexture(0);
+    int slot = GetTextureSlot(target);
+    if (slot >= 0 && this->m_activeTexture < MAX_TEXTURE_UNITS
+        && Filter(this->m_textures[this->m_activeTexture][slot], texture))
+        return ;
+    if (slot < 0)
+        ++this->m_stats.issued;
+    glBindTexture(target, texture);
+};
+
+void    GLStateCache::BindTexture(uint32_t unit, uint32_t target, uint32_t texture)
+{
+    // 이미 Bind 되어 있으면 glActiveTexture도 부르지 않는다.
+    int slot = GetTextureSlot(target);
+    if (slot >= 0 && unit < MAX_TEXTURE_UNITS && this->m_textures[unit][slot] == texture)
+    {
+        ++this->m_stats.filtered;
+        return ;
+    }
+    ActiveTexture(unit);
+    BindTexture(target, texture);
+};
+
+void    GLStateCache::BindFramebuffer(uint32_t framebuffer)
+{
+    if (!Filter(this->m_framebuffer, framebuffer))
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+};
+
+void    GLStateCache::SetCapability(uint32_t cap, bool enable)
+{
+    int slot = GetCapSlot(cap);
+    if (slot >= 0 && this->m_caps[slot] == (enable ? 1 : 0))
+    {
+        ++this->m_stats.filtered;
+        return ;
+    }
+    if (slot >= 0)
+        this->m_caps[slot] = (enable ? 1 : 0);
+    ++this->m_stats.issued;
+    if (enable)
+        glEnable(cap);
+    else
+        glDisable(cap);
+};
+
+void    GLStateCache::ForgetProgram(uint32_t program)
+{
+    if (this->m_program == program)
+        this->m_program = UNKNOWN;
+};
+
+void    GLStateCache::ForgetVertexArray(uint32_t vertexArray)
+{
+    if (this->m_vertexArray == vertexArray)
+    {
+        this->m_vertexArray = UNKNOWN;
+        this->m_buffers[SLOT_ELEMENT_ARRAY] = UNKNOWN;
+    }
+};
+
+void    GLStateCache::ForgetBuffer(uint32_t buffer)
+{
+    for (auto& cached : this->m_buffers)
+        if (cached == buffer)
+            cached = UNKNOWN;
+};
+
+void    GLStateCache::ForgetTexture(uint32_t texture)
+{
+    for (auto& unit : this->m_textures)
+        for (auto& cached : unit)
+            if (cached == texture)
+                cached = UNKNOWN;
+};
+
+void    GLStateCache::ForgetFramebuffer(uint32_t framebuffer)
+{
+    if (this->m_framebuffer == framebuffer)
+        this->m_framebuffer = UNKNOWN;
+};
+
+int     GLStateCache::GetTextureSlot(uint32_t target)
+{
+    switch (target)
+    {
+    case GL_TEXTURE_2D: return (SLOT_2D);
+    case GL_TEXTURE_2D_ARRAY: return (SLOT_2D_ARRAY);
+    case GL_TEXTURE_CUBE_MAP: return (SLOT_CUBE_MAP);
+    default: return (-1);
+    }
+};
+
+int     GLStateCache::GetBufferSlot(uint32_t target)
+{
+    switch (target)
+    {
+    case GL_ARRAY_BUFFER: return (SLOT_ARRAY);
+    case GL_ELEMENT_ARRAY_BUFFER: return (SLOT_ELEMENT_ARRAY);
+    case GL_UNIFORM_BUFFER: return (SLOT_UNIFORM);
+    case GL_PIXEL_UNPACK_BUFFER: return (SLOT_PIXEL_UNPACK);
+    case GL_SHADER_STORAGE_BUFFER: return (SLOT_SHADER_STORAGE);
+    default: return (-1);
+    }
+};
+
+int     GLStateCache::GetCapSlot(uint32_t cap)
+{
+    switch (cap)
+    {
+    case GL_BLEND: return (CAP_BLEND);
+    case GL_DEPTH_TEST: return (CAP_DEPTH_TEST);
+    case GL_CULL_FACE: return (CAP_CULL_FACE);
+    default: return (-1);
+    }
+};
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef GPUTIMER_HPP
+#define GPUTIMER_HPP
+
+#include "Common.hpp"
+
+// GL_TIME_ELAPSED Query를 몇 프레임 돌려 쓰면서 Begin / End 사이의 GPU 시간을 잰다.
+// 결과는 기다리지 않고, 준비된 가장 최근 값만 GetMs()로 돌려준다.
+CLASS_PTR(GpuTimer);
+class GpuTimer
+{
+public:
+    static GpuTimerUPtr Create(void);
+    ~GpuTimer();
+
+    void    Begin(void);
+    void    End(void);
+    // 가장 최근에 결과가 나온 구간 (ms)
+    double  GetMs(void) const
+    { return (this->m_ms); };
+private:
+    static const int    QUERY_COUNT = 4;
+
+    uint32_t    m_queries[QUERY_COUNT] { 0 };
+    bool        m_pending[QUERY_COUNT] { false };
+    int         m_current { 0 };
+    double      m_ms { 0.0 };
+
+    GpuTimer() {};
+    void    init(void);
+};
+
+GpuTimerUPtr    GpuTimer::Create(void)
+{
+    GpuTimerUPtr    timer = GpuTimerUPtr(new GpuTimer());
+    timer->init();
+    return (std::move(timer));
+};
+
+GpuTimer::~GpuTimer()
+{ glDeleteQueries(QUERY_COUNT, this->m_queries); };
+
+void    GpuTimer::init(void)
+{ glGenQueries(QUERY_COUNT, this->m_queries); };
+
+void    GpuTimer::Begin(void)
+{
+    // 이전에 끝난 Query부터 결과를 읽는다. (아직이면 그대로 둔다.)
+    for (int offset = 1; offset <= QUERY_COUNT; ++offset)
+    {
+        int index = (this->m_current + offset) % QUERY_COUNT;
+        if (!this->m_pending[index])
+            continue;
+        int available = 0;
+        glGetQueryObjectiv(this->m_queries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            continue;
+        GLuint64    elapsed = 0;
+        glGetQueryObjectui64v(this->m_queries[index], GL_QUERY_RESULT, &elapsed);
+        this->m_ms = elapsed / 1e6;
+        this->m_pending[index] = false;
+    }
+    this->m_current = (this->m_current + 1) % QUERY_COUNT;
+    // 한 바퀴 돌아도 결과가 안 나왔으면 그 결과는 버린다.
+    this->m_pending[this->m_current] = false;
+    glBeginQuery(GL_TIME_ELAPSED, this->m_queries[this->m_current]);
+};
+
+void    GpuTimer::End(void)
+{
+    glEndQuery(GL_TIME_ELAPSED);
+    this->m_pending[this->m_current] = true;
+};
+
+#endif
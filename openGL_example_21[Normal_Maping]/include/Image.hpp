@@ -5,6 +5,7 @@
 #include "stb/stb_image.h"
 
 #include "Common.hpp"
+#include "MipGenerator.hpp"
 
 CLASS_PTR(Image);
 class Image
@@ -26,6 +27,11 @@ public:
     { return (this->m_channelCount); };
 
     void    SetCheckImage(int gridX, int gridY);
+    // 가로 / 세로를 절반(최소 1)으로 줄인 다음 Mip Level. 2x2 평균 (MipGenerator의 SIMD Kernel)
+    ImageUPtr   CreateDownsampled(MipFilter filter = MIP_FILTER_BOX) const;
+    // Level 1부터 1x1까지. alphaCutoff > 0이면 (RGBA) 모든 Level의 Alpha Test 통과 비율을
+    // Level 0과 같게 맞춘다. Worker Thread에서 호출해도 된다.
+    std::vector<ImageUPtr>  CreateMipChain(MipFilter filter = MIP_FILTER_SRGB, float alphaCutoff = 0.0f) const;
 
 private:
     int         m_width{0}, m_height{0}, m_channelCount{0};
@@ -33,6 +39,7 @@ private:
 
     Image() {};
     bool    LoadWithStb(const std::string& filepath, bool flipVertical);
+    void    FlipVertical(void);
     bool    Allocate(int width, int height, int channelCount);
 };
 
@@ -72,6 +79,37 @@ Image::~Image()
         stbi_image_free(this->m_data);
 };
 
+ImageUPtr   Image::CreateDownsampled(MipFilter filter) const
+{
+    ImageUPtr   image = Create(std::max(1, this->m_width / 2), std::max(1, this->m_height / 2), this->m_channelCount);
+    if (!image)
+        return (nullptr);
+    MipGenerator::Downsample(this->m_data, this->m_width, this->m_height, this->m_channelCount, filter, image->m_data);
+    return (image);
+};
+
+std::vector<ImageUPtr>  Image::CreateMipChain(MipFilter filter, float alphaCutoff) const
+{
+    std::vector<ImageUPtr>  levels;
+    bool    alphaTest = alphaCutoff > 0.0f && this->m_channelCount == 4;
+    float   coverage = alphaTest ? MipGenerator::ComputeAlphaCoverage(this->m_data,
+                                    static_cast<size_t>(this->m_width) * this->m_height, alphaCutoff) : 0.0f;
+    // 각 Level은 바로 위 Level(Alpha 조정 후)에서 만든다.
+    const Image*    source = this;
+    while (source->m_width > 1 || source->m_height > 1)
+    {
+        ImageUPtr   level = source->CreateDownsampled(filter);
+        if (!level)
+            break;
+        if (alphaTest)
+            MipGenerator::ScaleAlphaToCoverage(level->m_data, static_cast<size_t>(level->m_width) * level->m_height,
+                                            alphaCutoff, coverage);
+        levels.push_back(std::move(level));
+        source = levels.back().get();
+    }
+    return (levels);
+};
+
 void    Image::SetCheckImage(int gridX, int gridY)
 {
     for (int j = 0; j < this->m_height; ++j)
@@ -91,7 +129,8 @@ void    Image::SetCheckImage(int gridX, int gridY)
 
 bool    Image::LoadWithStb(const std::string& filepath, bool flipVertical)
 {
-    stbi_set_flip_vertically_on_load(flipVertical);
+    // stbi_set_flip_vertically_on_load는 전역 상태라 Worker Thread에서 동시에 Load 하면 섞인다.
+    // Decode는 항상 뒤집지 않고 하고, 필요하면 여기서 직접 뒤집는다.
     this->m_data = stbi_load(filepath.c_str(),
                             &this->m_width, &this->m_height,
                             &this->m_channelCount, 0);
@@ -100,9 +139,23 @@ bool    Image::LoadWithStb(const std::string& filepath, bool flipVertical)
         putError("Failed to load image: " + filepath);
         return (false);
     }
+    if (flipVertical)
+        FlipVertical();
     return (true);
 };
 
+void    Image::FlipVertical(void)
+{
+    size_t                  rowSize = static_cast<size_t>(this->m_width) * this->m_channelCount;
+    std::vector<uint8_t>    row(rowSize);
+    for (int top = 0, bottom = this->m_height - 1; top < bottom; ++top, --bottom)
+    {
+        memcpy(row.data(), this->m_data + top * rowSize, rowSize);
+        memcpy(this->m_data + top * rowSize, this->m_data + bottom * rowSize, rowSize);
+        memcpy(this->m_data + bottom * rowSize, row.data(), rowSize);
+    }
+};
+
 bool    Image::Allocate(int width, int height, int channelCount)
 {
     this->m_width = width;
@@ -0,0 +1,469 @@
+#ifndef KTXIMAGE_HPP
+#define KTXIMAGE_HPP
+
+#include "Common.hpp"
+#include "Image.hpp"
+#include "MappedFile.hpp"
+
+#include <map>
+#include <numeric>
+
+// KTX2 Container (https://registry.khronos.org/KTX/specs/2.0/ktxspec.v2.html)
+// 파일을 mmap 하고 Level / Face마다 파일 안의 위치를 그대로 가리키므로 Upload 전까지 복사가 없다.
+// 지원 범위 : 2D / Cube Map, Array 아님, Supercompression 없음,
+//             R8 / RG8 / RGB8 / RGBA8 UNORM, BC1 RGB / BC3 / BC5 UNORM
+CLASS_PTR(KtxImage);
+class KtxImage
+{
+public:
+    struct Level {
+        int             width;
+        int             height;
+        const uint8_t*  data;
+        size_t          size;
+    };
+    // Key 순서대로 저장해야 하므로 map
+    using KeyValues = std::map<std::string, std::string>;
+
+    // VkFormat 값
+    static const uint32_t   VK_FORMAT_R8_UNORM = 9;
+    static const uint32_t   VK_FORMAT_R8G8_UNORM = 16;
+    static const uint32_t   VK_FORMAT_R8G8B8_UNORM = 23;
+    static const uint32_t   VK_FORMAT_R8G8B8A8_UNORM = 37;
+    static const uint32_t   VK_FORMAT_BC1_RGB_UNORM_BLOCK = 131;
+    static const uint32_t   VK_FORMAT_BC3_UNORM_BLOCK = 137;
+    static const uint32_t   VK_FORMAT_BC5_UNORM_BLOCK = 141;
+
+    static KtxImageUPtr Load(const std::string& filepath);
+    // faces(1 또는 6장, 같은 크기 / Channel 수)를 Level 0으로 저장한다.
+    // generateMipmap이면 Image::CreateDownsampled(mipFilter)로 1x1까지 만들어 같이 저장한다.
+    // (색 Image는 sRGB로 풀어서 평균해야 Mip이 어두워지지 않는다.)
+    static bool         Write(const std::string& filepath, const std::vector<const Image*>& faces,
+                            bool generateMipmap = true, const KeyValues& keyValues = KeyValues(),
+                            MipFilter mipFilter = MIP_FILTER_SRGB);
+    // levels는 Level 순서, 한 Level 안에서는 Face 순서 (levels.size() == Level 수 x faceCount)
+    static bool         Write(const std::string& filepath, uint32_t vkFormat, uint32_t faceCount,
+                            const std::vector<Level>& levels, const KeyValues& keyValues = KeyValues());
+
+    static uint32_t     GetVkFormat(int channelCount);
+    static bool         IsBlockFormat(uint32_t vkFormat);
+    // Texel Block 하나의 byte 수 (비압축은 Pixel 하나)
+    static size_t       GetBlockSize(uint32_t vkFormat);
+    static size_t       GetLevelSize(uint32_t vkFormat, int width, int height);
+    // 원본 파일들의 크기 / 수정 시간을 이은 문자열. 하나라도 없으면 빈 문자열
+    static std::string  MakeSourceStamp(const std::vector<std::string>& sourcePaths);
+
+    uint32_t        GetVkFormat(void) const
+    { return (this->m_vkFormat); };
+    bool            IsCompressed(void) const
+    { return (IsBlockFormat(this->m_vkFormat)); };
+    int             GetWidth(void) const
+    { return (this->m_levels[0].width); };
+    int             GetHeight(void) const
+    { return (this->m_levels[0].height); };
+    uint32_t        GetFaceCount(void) const
+    { return (this->m_faceCount); };
+    int             GetLevelCount(void) const
+    { return (static_cast<int>(this->m_levels.size() / this->m_faceCount)); };
+    const Level&    GetLevel(int level, uint32_t face = 0) const
+    { return (this->m_levels[level * this->m_faceCount + face]); };
+    // 파일에 levelCount = 0(Load 때 Mipmap 생성)으로 저장되어 있다.
+    bool            NeedsMipmapGeneration(void) const
+    { return (this->m_generateMipmap); };
+    // 없는 Key면 빈 문자열
+    std::string     GetValue(const std::string& key) const;
+
+    // glTexStorage2D / glCompressedTexImage2D에 쓸 Sized Internal Format
+    uint32_t        GetGLInternalFormat(void) const;
+    // glTexSubImage2D의 format / type (압축 형식에서는 쓰지 않는다.)
+    uint32_t        GetGLFormat(void) const;
+    uint32_t        GetGLType(void) const
+    { return (GL_UNSIGNED_BYTE); };
+private:
+    struct Header {
+        uint8_t     identifier[12];
+        uint32_t    vkFormat;
+        uint32_t    typeSize;
+        uint32_t    pixelWidth;
+        uint32_t    pixelHeight;
+        uint32_t    pixelDepth;
+        uint32_t    layerCount;
+        uint32_t    faceCount;
+        uint32_t    levelCount;
+        uint32_t    supercompressionScheme;
+        uint32_t    dfdByteOffset;
+        uint32_t    dfdByteLength;
+        uint32_t    kvdByteOffset;
+        uint32_t    kvdByteLength;
+        uint64_t    sgdByteOffset;
+        uint64_t    sgdByteLength;
+    };
+    struct LevelIndex {
+        uint64_t    byteOffset;
+        uint64_t    byteLength;
+        uint64_t    uncompressedByteLength;
+    };
+    static const uint8_t    IDENTIFIER[12];
+
+    MappedFileUPtr          m_file;
+    uint32_t                m_vkFormat { 0 };
+    uint32_t                m_faceCount { 1 };
+    bool                    m_generateMipmap { false };
+    std::vector<Level>      m_levels;
+    KeyValues               m_keyValues;
+
+    KtxImage() {};
+    bool    init(const std::string& filepath);
+    static std::vector<uint32_t>    BuildDataFormatDescriptor(uint32_t vkFormat);
+};
+
+const uint8_t   KtxImage::IDENTIFIER[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+KtxImageUPtr    KtxImage::Load(const std::string& filepath)
+{
+    KtxImageUPtr    image = KtxImageUPtr(new KtxImage());
+    if (!image->init(filepath))
+        return (nullptr);
+    return (std::move(image));
+};
+
+uint32_t    KtxImage::GetVkFormat(int channelCount)
+{
+    switch (channelCount)
+    {
+    case 1: return (VK_FORMAT_R8_UNORM);
+    case 2: return (VK_FORMAT_R8G8_UNORM);
+    case 3: return (VK_FORMAT_R8G8B8_UNORM);
+    default: return (VK_FORMAT_R8G8B8A8_UNORM);
+    }
+};
+
+bool    KtxImage::IsBlockFormat(uint32_t vkFormat)
+{
+    return (vkFormat == VK_FORMAT_BC1_RGB_UNORM_BLOCK || vkFormat == VK_FORMAT_BC3_UNORM_BLOCK
+            || vkFormat == VK_FORMAT_BC5_UNORM_BLOCK);
+};
+
+size_t  KtxImage::GetBlockSize(uint32_t vkFormat)
+{
+    switch (vkFormat)
+    {
+    case VK_FORMAT_R8_UNORM: return (1);
+    case VK_FORMAT_R8G8_UNORM: return (2);
+    case VK_FORMAT_R8G8B8_UNORM: return (3);
+    case VK_FORMAT_R8G8B8A8_UNORM: return (4);
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK: return (8);
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC5_UNORM_BLOCK: return (16);
+    default: return (0);
+    }
+};
+
+size_t  KtxImage::GetLevelSize(uint32_t vkFormat, int width, int height)
+{
+    if (IsBlockFormat(vkFormat))
+        return (static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * GetBlockSize(vkFormat));
+    return (static_cast<size_t>(width) * height * GetBlockSize(vkFormat));
+};
+
+std::string KtxImage::MakeSourceStamp(const std::vector<std::string>& sourcePaths)
+{
+    std::stringstream   stamp;
+    for (auto& path : sourcePaths)
+    {
+        uint64_t    size = 0;
+        int64_t     time = 0;
+        if (!GetFileStamp(path, size, time))
+            return (std::string());
+        stamp << size << ":" << time << ";";
+    }
+    return (stamp.str());
+};
+
+std::string KtxImage::GetValue(const std::string& key) const
+{
+    auto    iter = this->m_keyValues.find(key);
+    return (iter == this->m_keyValues.end() ? std::string() : iter->second);
+};
+
+uint32_t    KtxImage::GetGLInternalFormat(void) const
+{
+    switch (this->m_vkFormat)
+    {
+    case VK_FORMAT_R8_UNORM: return (GL_R8);
+    case VK_FORMAT_R8G8_UNORM: return (GL_RG8);
+    case VK_FORMAT_R8G8B8_UNORM: return (GL_RGB8);
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK: return (GL_COMPRESSED_RGB_S3TC_DXT1_EXT);
+    case VK_FORMAT_BC3_UNORM_BLOCK: return (GL_COMPRESSED_RGBA_S3TC_DXT5_EXT);
+    case VK_FORMAT_BC5_UNORM_BLOCK: return (GL_COMPRESSED_RG_RGTC2);
+    default: return (GL_RGBA8);
+    }
+};
+
+uint32_t    KtxImage::GetGLFormat(void) const
+{
+    switch (this->m_vkFormat)
+    {
+    case VK_FORMAT_R8_UNORM: return (GL_RED);
+    case VK_FORMAT_R8G8_UNORM:
+    case VK_FORMAT_BC5_UNORM_BLOCK: return (GL_RG);
+    case VK_FORMAT_R8G8B8_UNORM:
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK: return (GL_RGB);
+    default: return (GL_RGBA);
+    }
+};
+
+bool    KtxImage::init(const std::string& filepath)
+{
+    this->m_file = MappedFile::Open(filepath);
+    if (!this->m_file || this->m_file->GetSize() < sizeof(Header))
+        return (false);
+
+    const uint8_t*  base = this->m_file->GetData();
+    size_t          fileSize = this->m_file->GetSize();
+    auto            header = reinterpret_cast<const Header*>(base);
+    uint32_t        levelCount = std::max(header->levelCount, 1u);
+    if (memcmp(header->identifier, IDENTIFIER, sizeof(IDENTIFIER)) != 0
+        || GetBlockSize(header->vkFormat) == 0 || header->supercompressionScheme != 0
+        || header->pixelWidth == 0 || header->pixelHeight == 0 || header->pixelDepth != 0
+        || header->layerCount > 1 || (header->faceCount != 1 && header->faceCount != 6)
+        || sizeof(Header) + uint64_t(levelCount) * sizeof(LevelIndex) > fileSize
+        || uint64_t(header->kvdByteOffset) + header->kvdByteLength > fileSize)
+    {
+        putError("Unsupported or invalid KTX2 file: " + filepath);
+        return (false);
+    }
+    this->m_vkFormat = header->vkFormat;
+    this->m_faceCount = header->faceCount;
+    this->m_generateMipmap = header->levelCount == 0;
+
+    // Level Index 0이 가장 큰 Level. Face는 Level 안에 Padding 없이 이어져 있다.
+    auto    levels = reinterpret_cast<const LevelIndex*>(base + sizeof(Header));
+    for (uint32_t level = 0; level < levelCount; ++level)
+    {
+        int     width = std::max(1u, header->pixelWidth >> level);
+        int     height = std::max(1u, header->pixelHeight >> level);
+        size_t  faceSize = GetLevelSize(this->m_vkFormat, width, height);
+        if (levels[level].byteOffset + levels[level].byteLength > fileSize
+            || levels[level].byteLength != faceSize * this->m_faceCount)
+        {
+            putError("Truncated KTX2 level data: " + filepath);
+            return (false);
+        }
+        for (uint32_t face = 0; face < this->m_faceCount; ++face)
+            this->m_levels.push_back({ width, height, base + levels[level].byteOffset + face * faceSize, faceSize });
+    }
+
+    // Key / Value : [uint32 길이][Key\0][Value][4 byte 정렬 Padding] 반복
+    const uint8_t*  kvd = base + header->kvdByteOffset;
+    const uint8_t*  kvdEnd = kvd + header->kvdByteLength;
+    while (kvd + sizeof(uint32_t) <= kvdEnd)
+    {
+        uint32_t    length = 0;
+        memcpy(&length, kvd, sizeof(length));
+        kvd += sizeof(length);
+        if (length > static_cast<size_t>(kvdEnd - kvd))
+            break;
+        auto    entry = reinterpret_cast<const char*>(kvd);
+        size_t  keyLength = strnlen(entry, length);
+        if (keyLength < length)
+        {
+            // 문자열 Value는 끝의 NUL까지 저장되어 있다.
+            std::string value(entry + keyLength + 1, length - keyLength - 1);
+            if (!value.empty() && value.back() == '\0')
+                value.pop_back();
+            this->m_keyValues[std::string(entry, keyLength)] = value;
+        }
+        kvd += (length + 3) & ~3u;
+    }
+    return (true);
+};
+
+std::vector<uint32_t>   KtxImage::BuildDataFormatDescriptor(uint32_t vkFormat)
+{
+    // Khronos Basic Data Format Descriptor Block
+    struct Sample {
+        uint32_t    bitOffset;
+        uint32_t    bitLength;
+        uint32_t    channel;
+        uint32_t    upper;
+    };
+    std::vector<Sample> samples;
+    uint32_t            colorModel = 1;     // KHR_DF_MODEL_RGBSDA
+    uint32_t            blockDimension = 0; // (가로 - 1) | (세로 - 1) << 8
+    uint32_t            bytesPlane = static_cast<uint32_t>(GetBlockSize(vkFormat));
+    switch (vkFormat)
+    {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        colorModel = 128;   // KHR_DF_MODEL_BC1A
+        blockDimension = 3 | (3 << 8);
+        samples.push_back({ 0, 64, 0, 0xFFFFFFFF });
+        break;
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+        colorModel = 130;   // KHR_DF_MODEL_BC3
+        blockDimension = 3 | (3 << 8);
+        samples.push_back({ 0, 64, 15, 0xFFFFFFFF });   // Alpha
+        samples.push_back({ 64, 64, 0, 0xFFFFFFFF });   // Color
+        break;
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+        colorModel = 132;   // KHR_DF_MODEL_BC5
+        blockDimension = 3 | (3 << 8);
+        samples.push_back({ 0, 64, 0, 0xFFFFFFFF });    // Red
+        samples.push_back({ 64, 64, 1, 0xFFFFFFFF });   // Green
+        break;
+    default:
+    {
+        static const uint32_t   channels[4] = { 0, 1, 2, 15 };  // R, G, B, A
+        for (uint32_t i = 0; i < bytesPlane; ++i)
+            samples.push_back({ i * 8, 8, channels[i], 255 });
+        break;
+    }
+    }
+
+    uint32_t                blockSize = 24 + 16 * static_cast<uint32_t>(samples.size());
+    std::vector<uint32_t>   dfd;
+    dfd.push_back(4 + blockSize);           // dfdTotalSize
+    dfd.push_back(0);                       // vendorId = Khronos, descriptorType = Basic
+    dfd.push_back(2 | (blockSize << 16));   // versionNumber = 1.3
+    // colorModel | primaries(BT709) << 8 | transfer(Linear) << 16 | flags << 24
+    dfd.push_back(colorModel | (1 << 8) | (1 << 16));
+    dfd.push_back(blockDimension);
+    dfd.push_back(bytesPlane);              // bytesPlane0 ~ 3
+    dfd.push_back(0);                       // bytesPlane4 ~ 7
+    for (auto& sample : samples)
+    {
+        dfd.push_back(sample.bitOffset | ((sample.bitLength - 1) << 16) | (sample.channel << 24));
+        dfd.push_back(0);                   // samplePosition
+        dfd.push_back(0);                   // sampleLower
+        dfd.push_back(sample.upper);
+    }
+    return (dfd);
+};
+
+bool    KtxImage::Write(const std::string& filepath, const std::vector<const Image*>& faces,
+                        bool generateMipmap, const KeyValues& keyValues, MipFilter mipFilter)
+{
+    if (faces.empty() || !faces[0])
+        return (false);
+    int channelCount = faces[0]->GetChannelCount();
+    for (auto face : faces)
+    {
+        if (!face || face->GetWidth() != faces[0]->GetWidth() || face->GetHeight() != faces[0]->GetHeight()
+            || face->GetChannelCount() != channelCount)
+        {
+            putError("KTX2 faces must share size and channel count: " + filepath);
+            return (false);
+        }
+    }
+
+    // Level 순서, Level 안에서는 Face 순서로 펼친다. 줄인 Image는 Write가 끝날 때까지 들고 있는다.
+    std::vector<ImageUPtr>      mips;
+    std::vector<const Image*>   current = faces;
+    std::vector<Level>          levels;
+    while (true)
+    {
+        for (auto face : current)
+        {
+            levels.push_back({ face->GetWidth(), face->GetHeight(), face->GetData(),
+                            static_cast<size_t>(face->GetWidth()) * face->GetHeight() * channelCount });
+        }
+        if (!generateMipmap || (current[0]->GetWidth() == 1 && current[0]->GetHeight() == 1))
+            break;
+        for (auto& face : current)
+        {
+            mips.push_back(face->CreateDownsampled(mipFilter));
+            if (!mips.back())
+                return (false);
+            face = mips.back().get();
+        }
+    }
+    return (Write(filepath, GetVkFormat(channelCount), static_cast<uint32_t>(faces.size()), levels, keyValues));
+};
+
+bool    KtxImage::Write(const std::string& filepath, uint32_t vkFormat, uint32_t faceCount,
+                        const std::vector<Level>& levels, const KeyValues& keyValues)
+{
+    if (GetBlockSize(vkFormat) == 0 || levels.empty() || levels.size() % faceCount != 0)
+        return (false);
+    uint32_t    levelCount = static_cast<uint32_t>(levels.size() / faceCount);
+
+    Header  header {};
+    memcpy(header.identifier, IDENTIFIER, sizeof(IDENTIFIER));
+    header.vkFormat = vkFormat;
+    header.typeSize = 1;
+    header.pixelWidth = static_cast<uint32_t>(levels[0].width);
+    header.pixelHeight = static_cast<uint32_t>(levels[0].height);
+    header.faceCount = faceCount;
+    header.levelCount = levelCount;
+
+    auto    dfd = BuildDataFormatDescriptor(vkFormat);
+    header.dfdByteOffset = static_cast<uint32_t>(sizeof(Header) + levelCount * sizeof(LevelIndex));
+    header.dfdByteLength = static_cast<uint32_t>(dfd.size() * sizeof(uint32_t));
+
+    KeyValues   entries = keyValues;
+    entries.emplace("KTXwriter", "openGL_example KtxImage");
+    std::string kvd;
+    for (auto& entry : entries)
+    {
+        uint32_t    length = static_cast<uint32_t>(entry.first.size() + 1 + entry.second.size() + 1);
+        kvd.append(reinterpret_cast<const char*>(&length), sizeof(length));
+        kvd.append(entry.first.c_str(), entry.first.size() + 1);
+        kvd.append(entry.second.c_str(), entry.second.size() + 1);
+        kvd.resize((kvd.size() + 3) & ~size_t(3), '\0');
+    }
+    if (!kvd.empty())
+    {
+        header.kvdByteOffset = header.dfdByteOffset + header.dfdByteLength;
+        header.kvdByteLength = static_cast<uint32_t>(kvd.size());
+    }
+
+    // Level Data는 작은 Level부터 저장하고, 각 Level은 lcm(Texel Block 크기, 4)에 맞춘다.
+    uint64_t                alignment = std::lcm(static_cast<uint64_t>(GetBlockSize(vkFormat)), uint64_t(4));
+    std::vector<LevelIndex> index(levelCount);
+    uint64_t                offset = header.dfdByteOffset + header.dfdByteLength + kvd.size();
+    for (uint32_t level = levelCount; level-- > 0;)
+    {
+        offset = (offset + alignment - 1) / alignment * alignment;
+        size_t  faceSize = GetLevelSize(vkFormat, levels[level * faceCount].width, levels[level * faceCount].height);
+        index[level].byteOffset = offset;
+        index[level].byteLength = faceSize * faceCount;
+        index[level].uncompressedByteLength = index[level].byteLength;
+        for (uint32_t face = 0; face < faceCount; ++face)
+        {
+            if (levels[level * faceCount + face].size != faceSize)
+            {
+                putError("KTX2 level size does not match its format: " + filepath);
+                return (false);
+            }
+        }
+        offset += index[level].byteLength;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(filepath).parent_path(), ec);
+    std::ofstream   fout(filepath, std::ios::binary | std::ios::trunc);
+    if (!fout.is_open())
+    {
+        putError("Failed to write KTX2 file: " + filepath);
+        return (false);
+    }
+    fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    fout.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(LevelIndex));
+    fout.write(reinterpret_cast<const char*>(dfd.data()), dfd.size() * sizeof(uint32_t));
+    fout.write(kvd.data(), kvd.size());
+    for (uint32_t level = levelCount; level-- > 0;)
+    {
+        static const char   zeros[16] = {};
+        uint64_t    current = static_cast<uint64_t>(fout.tellp());
+        if (index[level].byteOffset > current)
+            fout.write(zeros, static_cast<std::streamsize>(index[level].byteOffset - current));
+        for (uint32_t face = 0; face < faceCount; ++face)
+        {
+            auto&   image = levels[level * faceCount + face];
+            fout.write(reinterpret_cast<const char*>(image.data), image.size);
+        }
+    }
+    return (static_cast<bool>(fout));
+};
+
+#endif
@@ -0,0 +1,391 @@
+#ifndef LOCALLIGHTSET_HPP
+#define LOCALLIGHTSET_HPP
+
+#include "Common.hpp"
+#include "Buffer.hpp"
+#include "RenderQueue.hpp"
+#include "ShadowAtlas.hpp"
+
+// Shader의 layout (std430, binding = N) 값과 맞춰야 한다.
+const uint32_t  LOCAL_LIGHT_BINDING = 2;
+
+enum LocalLightType : int
+{
+    LOCAL_LIGHT_SPOT = 0,
+    LOCAL_LIGHT_POINT = 1,
+};
+
+// Shadow를 드리우는 여러 개의 Spot / Point Light.
+// 화면에서 차지하는 크기로 Light마다 ShadowAtlas의 Tile 크기를 정하고 (Point Light는 6면),
+// 바뀐 Light부터, 남는 예산은 돌아가면서 프레임당 정해진 Tile 수만큼만 다시 그린다.
+// Light / Tile 정보는 SSBO(LOCAL_LIGHT_BINDING)로 Shader에 넘긴다.
+CLASS_PTR(LocalLightSet);
+class LocalLightSet
+{
+public:
+    static const int    MAX_LIGHT_COUNT = 32;
+
+    struct Light {
+        LocalLightType  type { LOCAL_LIGHT_SPOT };
+        glm::vec3       position { glm::vec3(0.0f) };
+        glm::vec3       direction { glm::vec3(0.0f, -1.0f, 0.0f) };
+        glm::vec3       color { glm::vec3(1.0f) };
+        float           range { 10.0f };
+        glm::vec2       cutoff { glm::vec2(30.0f, 10.0f) };  // Spot : 안쪽 각도, 바깥쪽까지 더할 각도 (degree)
+    };
+    struct Stats {
+        size_t  tilesRendered { 0 };
+        size_t  tilesDirty { 0 };       // 예산이 모자라 다음 프레임으로 밀린 바뀐 Tile
+        size_t  lightsShadowed { 0 };
+    };
+
+    static LocalLightSetUPtr    Create(int atlasSize, int minTileSize, int maxTileSize);
+
+    // 추가한 순서가 Index. 최대 MAX_LIGHT_COUNT
+    int     AddLight(const Light& light);
+    Light&  GetLight(int index)
+    { return (this->m_lights[index].light); };
+    int     GetLightCount(void) const
+    { return (static_cast<int>(this->m_lights.size())); };
+    // 앞에서부터 count개만 켠다.
+    void    SetActiveCount(int count)
+    { this->m_activeCount = glm::clamp(count, 0, GetLightCount()); };
+    int     GetActiveCount(void) const
+    { return (this->m_activeCount); };
+    // 프레임당 다시 그릴 수 있는 Tile(면) 수
+    void    SetTileBudget(int budget)
+    { this->m_tileBudget = std::max(budget, 1); };
+    int     GetTileBudget(void) const
+    { return (this->m_tileBudget); };
+
+    // 카메라 기준 중요도로 Tile을 다시 나누고, 다시 그려야 할 면을 표시한다.
+    void    Update(const glm::mat4& view, const glm::mat4& projection, float viewportHeight);
+    // SHADOW_PASS / SHADOW_DYNAMIC_PASS로 제출된 물체를 예산만큼의 Tile에 그리고 SSBO를 갱신한다.
+    void    RenderShadows(RenderQueue* renderQueue);
+    void    BindAtlas(uint32_t unit) const
+    { this->m_atlas->BindTexture(unit); };
+
+    const ShadowAtlas*  GetAtlas(void) const
+    { return (this->m_atlas.get()); };
+    const Stats&        GetStats(void) const
+    { return (this->m_stats); };
+private:
+    // Shader의 LocalLight와 같은 std430 배치
+    struct alignas(16) LightData {
+        glm::vec4   positionRange;
+        glm::vec4   directionType;
+        glm::vec4   color;
+        glm::vec4   cutoff;         // x : 안쪽 cos, y : 바깥쪽 cos, z : Shadow 면 수, w : tan(반 화각)
+        glm::vec4   rects[6];
+        glm::mat4   transforms[6];
+    };
+    static_assert(sizeof(LightData) == 544, "LightData must follow std430 layout");
+
+    struct Entry {
+        Light               light;
+        float               importance { 0.0f };
+        int                 desiredSize { 0 };
+        int                 requestedSize { 0 };    // Tile을 받을 때 원했던 크기 (Atlas가 차면 tileSize가 더 작다.)
+        int                 tileSize { 0 };
+        ShadowAtlas::Tile   tiles[6];
+        glm::mat4           views[6];
+        glm::mat4           projections[6];
+        bool                dirty[6] { false };
+        // Tile을 받은 뒤 한 번이라도 그렸는지, 그때의 Light 변환 (Shader는 Tile 내용과 맞는 이 값을 쓴다.)
+        bool                rendered[6] { false };
+        glm::mat4           renderedTransform[6];
+    };
+
+    ShadowAtlasUPtr     m_atlas;
+    BufferUPtr          m_buffer;
+    std::vector<Entry>  m_lights;
+    int                 m_activeCount { 0 };
+    int                 m_maxTileSize { 0 };
+    int                 m_tileBudget { 8 };
+    size_t              m_roundRobin { 0 };
+    Stats               m_stats;
+
+    LocalLightSet() {};
+    bool    init(int atlasSize, int minTileSize, int maxTileSize);
+    static int  GetFaceCount(const Light& light)
+    { return (light.type == LOCAL_LIGHT_POINT ? 6 : 1); };
+    static float    GetTanHalfFov(const Light& light);
+    void    ComputeTransforms(Entry& entry) const;
+    void    FreeTiles(Entry& entry);
+    bool    AllocateTiles(Entry& entry, int tileSize);
+    void    UpdateBuffer(void);
+};
+
+LocalLightSetUPtr   LocalLightSet::Create(int atlasSize, int minTileSize, int maxTileSize)
+{
+    auto    lightSet = LocalLightSetUPtr(new LocalLightSet());
+    if (!lightSet->init(atlasSize, minTileSize, maxTileSize))
+        return (nullptr);
+    return (std::move(lightSet));
+};
+
+bool    LocalLightSet::init(int atlasSize, int minTileSize, int maxTileSize)
+{
+    this->m_maxTileSize = maxTileSize;
+    this->m_atlas = ShadowAtlas::Create(atlasSize, minTileSize);
+    if (!this->m_atlas)
+        return (false);
+    this->m_buffer = Buffer::CreateWithData(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_DRAW,
+                                            nullptr, sizeof(LightData), MAX_LIGHT_COUNT);
+    if (!this->m_buffer)
+        return (false);
+    GLStateCache::Get().BindBufferBase(GL_SHADER_STORAGE_BUFFER, LOCAL_LIGHT_BINDING, this->m_buffer->Get());
+    return (true);
+};
+
+int     LocalLightSet::AddLight(const Light& light)
+{
+    if (GetLightCount() >= MAX_LIGHT_COUNT)
+    {
+        putError("too many local lights (max " + std::to_string(MAX_LIGHT_COUNT) + ")");
+        return (-1);
+    }
+    Entry   entry;
+    entry.light = light;
+    this->m_lights.push_back(entry);
+    return (GetLightCount() - 1);
+};
+
+float   LocalLightSet::GetTanHalfFov(const Light& light)
+{
+    if (light.type == LOCAL_LIGHT_POINT)
+        return (1.0f);
+    // 바깥쪽 가장자리의 PCF가 잘리지 않도록 조금 넓게 잡는다.
+    float   outer = glm::min(light.cutoff[0] + light.cutoff[1] + 5.0f, 85.0f);
+    return (std::tan(glm::radians(outer)));
+};
+
+void    LocalLightSet::ComputeTransforms(Entry& entry) const
+{
+    const Light&    light = entry.light;
+    float           nearPlane = std::max(light.range * 0.01f, 0.05f);
+    glm::mat4       projection = glm::perspective(2.0f * std::atan(GetTanHalfFov(light)), 1.0f,
+                                                nearPlane, light.range);
+    if (light.type == LOCAL_LIGHT_POINT)
+    {
+        // Shader의 면 선택 순서 : +X, -X, +Y, -Y, +Z, -Z
+        static const glm::vec3  directions[6] = {
+            glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f),
+            glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+            glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f) };
+        static const glm::vec3  ups[6] = {
+            glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+            glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+            glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f) };
+        for (int face = 0; face < 6; ++face)
+        {
+            entry.views[face] = glm::lookAt(light.position, light.position + directions[face], ups[face]);
+            entry.projections[face] = projection;
+        }
+        return ;
+    }
+    glm::vec3   direction = glm::normalize(light.direction);
+    glm::vec3   up = std::abs(direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    entry.views[0] = glm::lookAt(light.position, light.position + direction, up);
+    entry.projections[0] = projection;
+};
+
+void    LocalLightSet::FreeTiles(Entry& entry)
+{
+    for (auto& tile : entry.tiles)
+        this->m_atlas->Free(tile);
+    entry.tileSize = 0;
+};
+
+bool    LocalLightSet::AllocateTiles(Entry& entry, int tileSize)
+{
+    // 모든 면을 같은 크기로 받거나, 하나라도 실패하면 모두 돌려준다.
+    int faceCount = GetFaceCount(entry.light);
+    for (int face = 0; face < faceCount; ++face)
+    {
+        entry.tiles[face] = this->m_atlas->Allocate(tileSize);
+        if (!entry.tiles[face].IsValid())
+        {
+            FreeTiles(entry);
+            return (false);
+        }
+        entry.dirty[face] = true;
+        entry.rendered[face] = false;
+    }
+    entry.tileSize = tileSize;
+    return (true);
+};
+
+void    LocalLightSet::Update(const glm::mat4& view, const glm::mat4& projection, float viewportHeight)
+{
+    this->m_stats.lightsShadowed = 0;
+
+    // 중요도 : 영향 범위(구)가 화면에서 차지하는 반지름 (pixel). 카메라 뒤에 있으면 0
+    float   projectionScale = projection[1][1] * viewportHeight * 0.5f;
+    for (int index = 0; index < GetLightCount(); ++index)
+    {
+        Entry&  entry = this->m_lights[index];
+        entry.importance = 0.0f;
+        if (index >= this->m_activeCount)
+            continue;
+        glm::vec3   viewPos = glm::vec3(view * glm::vec4(entry.light.position, 1.0f));
+        float       distance = glm::length(viewPos);
+        if (distance <= entry.light.range)
+            entry.importance = viewportHeight;
+        else if (viewPos.z < entry.light.range)
+            entry.importance = entry.light.range / std::sqrt(distance * distance - entry.light.range * entry.light.range)
+                            * projectionScale;
+    }
+
+    // 원하는 크기 : 화면 반지름을 덮는 2의 거듭제곱. 합이 Atlas의 3/4를 넘으면 모두 한 단계씩 줄인다.
+    int     minTileSize = this->m_atlas->GetMinTileSize();
+    double  atlasArea = double(this->m_atlas->GetSize()) * this->m_atlas->GetSize();
+    for (auto& entry : this->m_lights)
+    {
+        entry.desiredSize = 0;
+        if (entry.importance <= 0.0f)
+            continue;
+        entry.desiredSize = minTileSize;
+        while (entry.desiredSize < this->m_maxTileSize && entry.desiredSize < entry.importance)
+            entry.desiredSize *= 2;
+    }
+    for (bool shrunk = true; shrunk;)
+    {
+        double  total = 0.0;
+        for (auto& entry : this->m_lights)
+            total += double(entry.desiredSize) * entry.desiredSize * GetFaceCount(entry.light);
+        shrunk = false;
+        if (total <= atlasArea * 0.75)
+            break;
+        for (auto& entry : this->m_lights)
+        {
+            if (entry.desiredSize > minTileSize)
+            {
+                entry.desiredSize /= 2;
+                shrunk = true;
+            }
+        }
+    }
+
+    // 중요한 Light부터 Tile을 받는다. 원하는 크기가 2배 이상 커지거나 4배 이상 작아질 때만 다시 받는다.
+    std::vector<int>    order;
+    for (int index = 0; index < GetLightCount(); ++index)
+        order.push_back(index);
+    std::sort(order.begin(), order.end(), [this](int a, int b)
+        { return (this->m_lights[a].importance > this->m_lights[b].importance); });
+    for (int index : order)
+    {
+        Entry&  entry = this->m_lights[index];
+        int     desired = entry.desiredSize;
+        if (desired == 0)
+        {
+            FreeTiles(entry);
+            continue;
+        }
+        bool    keep = entry.tileSize > 0 && desired <= entry.requestedSize && desired * 4 > entry.requestedSize;
+        if (!keep)
+        {
+            FreeTiles(entry);
+            entry.requestedSize = desired;
+            // Atlas가 꽉 찼으면 더 작은 크기로 물러선다.
+            for (int size = desired; size >= minTileSize; size /= 2)
+            {
+                if (AllocateTiles(entry, size))
+                    break;
+            }
+        }
+        if (entry.tileSize == 0)
+            continue;
+
+        ++this->m_stats.lightsShadowed;
+        ComputeTransforms(entry);
+        for (int face = 0; face < GetFaceCount(entry.light); ++face)
+        {
+            if (entry.renderedTransform[face] != entry.projections[face] * entry.views[face])
+                entry.dirty[face] = true;
+        }
+    }
+};
+
+void    LocalLightSet::RenderShadows(RenderQueue* renderQueue)
+{
+    this->m_stats.tilesRendered = 0;
+    // 그릴 면 목록 : 바뀐 면(중요도 순) 먼저, 남는 예산은 바뀌지 않은 면을 돌아가면서 (움직이는 물체 반영)
+    struct Face {
+        int light;
+        int face;
+    };
+    std::vector<Face>   dirtyFaces;
+    std::vector<Face>   cleanFaces;
+    for (int index = 0; index < GetLightCount(); ++index)
+    {
+        Entry&  entry = this->m_lights[index];
+        if (entry.tileSize == 0)
+            continue;
+        for (int face = 0; face < GetFaceCount(entry.light); ++face)
+            (entry.dirty[face] ? dirtyFaces : cleanFaces).push_back({ index, face });
+    }
+    std::stable_sort(dirtyFaces.begin(), dirtyFaces.end(), [this](const Face& a, const Face& b)
+        { return (this->m_lights[a.light].importance > this->m_lights[b.light].importance); });
+
+    std::vector<Face>   faces;
+    for (auto& face : dirtyFaces)
+    {
+        if (static_cast<int>(faces.size()) >= this->m_tileBudget)
+            break;
+        faces.push_back(face);
+    }
+    this->m_stats.tilesDirty = dirtyFaces.size() - faces.size();
+    for (size_t count = 0; count < cleanFaces.size() && static_cast<int>(faces.size()) < this->m_tileBudget; ++count)
+        faces.push_back(cleanFaces[this->m_roundRobin++ % cleanFaces.size()]);
+    for (auto& face : faces)
+    {
+        Entry&  entry = this->m_lights[face.light];
+        this->m_atlas->BindTile(entry.tiles[face.face]);
+        glClear(GL_DEPTH_BUFFER_BIT);
+        float   tileSize = static_cast<float>(entry.tiles[face.face].size);
+        for (auto pass : { SHADOW_PASS, SHADOW_DYNAMIC_PASS })
+        {
+            renderQueue->SetPassCamera(pass, entry.views[face.face], entry.projections[face.face], tileSize);
+            renderQueue->Execute(pass);
+        }
+        entry.dirty[face.face] = false;
+        entry.rendered[face.face] = true;
+        entry.renderedTransform[face.face] = entry.projections[face.face] * entry.views[face.face];
+        ++this->m_stats.tilesRendered;
+    }
+    this->m_atlas->EndTiles();
+    UpdateBuffer();
+};
+
+void    LocalLightSet::UpdateBuffer(void)
+{
+    std::vector<LightData>  data(this->m_activeCount);
+    for (int index = 0; index < this->m_activeCount; ++index)
+    {
+        const Entry&    entry = this->m_lights[index];
+        const Light&    light = entry.light;
+        LightData&      record = data[index];
+        record.positionRange = glm::vec4(light.position, light.range);
+        record.directionType = glm::vec4(glm::normalize(light.direction), static_cast<float>(light.type));
+        record.color = glm::vec4(light.color, 1.0f);
+        // Tile이 없거나 아직 다 그리지 않았으면 Shadow 없이 비춘다.
+        int     faceCount = GetFaceCount(light);
+        bool    shadowed = entry.tileSize > 0;
+        for (int face = 0; face < faceCount; ++face)
+            shadowed = shadowed && entry.rendered[face];
+        record.cutoff = glm::vec4(std::cos(glm::radians(light.cutoff[0])),
+                                std::cos(glm::radians(light.cutoff[0] + light.cutoff[1])),
+                                shadowed ? static_cast<float>(faceCount) : 0.0f,
+                                GetTanHalfFov(light));
+        for (int face = 0; shadowed && face < faceCount; ++face)
+        {
+            record.rects[face] = this->m_atlas->GetRect(entry.tiles[face]);
+            record.transforms[face] = entry.renderedTransform[face];
+        }
+    }
+    if (!data.empty())
+        this->m_buffer->SetData(data.data(), data.size() * sizeof(LightData));
+};
+
+#endif
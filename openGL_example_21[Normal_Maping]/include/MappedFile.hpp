@@ -0,0 +1,117 @@
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#include "Common.hpp"
+
+#ifdef _WIN32
+# ifndef WIN32_LEAN_AND_MEAN
+#  define WIN32_LEAN_AND_MEAN
+# endif
+# ifndef NOMINMAX
+#  define NOMINMAX
+# endif
+# include <windows.h>
+#else
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+// 읽기 전용 Memory-Mapped File.
+// 파일 내용을 복사하지 않고 OS Page Cache를 그대로 가리키는 포인터를 돌려준다.
+CLASS_PTR(MappedFile);
+class MappedFile
+{
+public:
+    static MappedFileUPtr   Open(const std::string& filename);
+
+    ~MappedFile();
+    const uint8_t*  GetData(void) const
+    { return (this->m_data); };
+    size_t          GetSize(void) const
+    { return (this->m_size); };
+private:
+    const uint8_t*  m_data { nullptr };
+    size_t          m_size { 0 };
+#ifdef _WIN32
+    HANDLE          m_file { INVALID_HANDLE_VALUE };
+    HANDLE          m_mapping { nullptr };
+#else
+    int             m_file { -1 };
+#endif
+
+    MappedFile() {};
+    bool    init(const std::string& filename);
+};
+
+MappedFileUPtr  MappedFile::Open(const std::string& filename)
+{
+    MappedFileUPtr  file = MappedFileUPtr(new MappedFile());
+    if (!file->init(filename))
+        return (nullptr);
+    return (std::move(file));
+};
+
+#ifdef _WIN32
+
+MappedFile::~MappedFile()
+{
+    if (this->m_data)
+        UnmapViewOfFile(this->m_data);
+    if (this->m_mapping)
+        CloseHandle(this->m_mapping);
+    if (this->m_file != INVALID_HANDLE_VALUE)
+        CloseHandle(this->m_file);
+};
+
+bool    MappedFile::init(const std::string& filename)
+{
+    this->m_file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (this->m_file == INVALID_HANDLE_VALUE)
+        return (false);
+
+    LARGE_INTEGER   size;
+    if (!GetFileSizeEx(this->m_file, &size) || size.QuadPart == 0)
+        return (false);
+    this->m_size = static_cast<size_t>(size.QuadPart);
+
+    this->m_mapping = CreateFileMappingA(this->m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!this->m_mapping)
+        return (false);
+    this->m_data = static_cast<const uint8_t*>(MapViewOfFile(this->m_mapping, FILE_MAP_READ, 0, 0, 0));
+    return (this->m_data != nullptr);
+};
+
+#else
+
+MappedFile::~MappedFile()
+{
+    if (this->m_data)
+        munmap(const_cast<uint8_t*>(this->m_data), this->m_size);
+    if (this->m_file >= 0)
+        close(this->m_file);
+};
+
+bool    MappedFile::init(const std::string& filename)
+{
+    this->m_file = open(filename.c_str(), O_RDONLY);
+    if (this->m_file < 0)
+        return (false);
+
+    struct stat st;
+    if (fstat(this->m_file, &st) != 0 || st.st_size == 0)
+        return (false);
+    this->m_size = static_cast<size_t>(st.st_size);
+
+    void*   data = mmap(nullptr, this->m_size, PROT_READ, MAP_PRIVATE, this->m_file, 0);
+    if (data == MAP_FAILED)
+        return (false);
+    this->m_data = static_cast<const uint8_t*>(data);
+    return (true);
+};
+
+#endif
+
+#endif
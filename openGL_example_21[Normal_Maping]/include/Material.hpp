@@ -16,6 +16,10 @@ public:
 
     void    SetToProgram(const Program* program) const;
 private:
+    // 마지막으로 사용한 Program의 Uniform location (Program이 바뀔 때만 다시 찾는다.)
+    mutable uint32_t    m_cachedProgram { 0 };
+    mutable UniformId   m_diffuseId { -1 }, m_specularId { -1 }, m_shininessId { -1 };
+
     Material() {};
 };
 
@@ -24,23 +28,28 @@ MaterialUPtr    Material::Create(void)
 
 void    Material::SetToProgram(const Program* program) const
 {
+    if (this->m_cachedProgram != program->Get())
+    {
+        this->m_cachedProgram = program->Get();
+        this->m_diffuseId = program->GetUniformId("material.diffuse");
+        this->m_specularId = program->GetUniformId("material.specular");
+        this->m_shininessId = program->GetUniformId("material.shininess");
+    }
+
     int textureCount = 0;
     if (diffuse)
     {
-        glActiveTexture(GL_TEXTURE0 + textureCount);
-        program->SetUniform("material.diffuse", textureCount);
-        diffuse->Bind();
+        program->SetUniform(this->m_diffuseId, textureCount);
+        diffuse->Bind(textureCount);
         ++textureCount;
     }
     if (specular)
     {
-        glActiveTexture(GL_TEXTURE0 + textureCount);
-        program->SetUniform("material.specular", textureCount);
-        specular->Bind();
+        program->SetUniform(this->m_specularId, textureCount);
+        specular->Bind(textureCount);
         ++textureCount;
     }
-    glActiveTexture(GL_TEXTURE0);
-    program->SetUniform("material.shininess", shininess);
+    program->SetUniform(this->m_shininessId, shininess);
 };
 
 #endif
\ No newline at end of file
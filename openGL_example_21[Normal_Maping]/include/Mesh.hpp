@@ -5,29 +5,81 @@
 # include "Buffer.hpp"
 # include "VertexLayout.hpp"
 # include "Material.hpp"
+# include "MeshOptimizer.hpp"
+# include "ThreadPool.hpp"
 
 struct Vertex
 {
     glm::vec3   position;
     glm::vec3   normal;
     glm::vec2   texCoord;
-    glm::vec3   tangent;
+    glm::vec4   tangent;    // w : Bitangent 부호 (B = cross(N, T) * w)
+};
+
+// Model Asset용 24 byte Vertex (Vertex의 절반 정도 대역폭)
+// normal   : Octahedral 인코딩 -> snorm16 x 2
+// tangent  : Octahedral 인코딩 -> GL_INT_2_10_10_10_REV의 x, y / w(2bit)에 Bitangent 부호
+// texCoord : half float x 2
+// Shader에서는 PACKED_VERTEX Define으로 Decode 한다. (shader/common/vertex_input.glsl)
+struct PackedVertex
+{
+    glm::vec3   position;
+    uint32_t    normal;
+    uint32_t    tangent;
+    uint32_t    texCoord;
+};
+
+enum VertexFormat : uint32_t {
+    VERTEX_FORMAT_FLOAT,
+    VERTEX_FORMAT_PACKED,
 };
 
 CLASS_PTR(Mesh);
 class Mesh
 {
 public:
+    // optimize : Vertex Cache / Overdraw / Vertex Fetch 순서로 Index, Vertex를 재배치한다.
     static MeshUPtr Create(const std::vector<Vertex>& vertices,
                             const std::vector<uint32_t>& indices,
-                            uint32_t primitiveType);
+                            uint32_t primitiveType, bool optimize = false,
+                            VertexFormat format = VERTEX_FORMAT_FLOAT);
+    // Tangent까지 계산이 끝난 Data(ex. mmap 된 Mesh Cache)를 복사 없이 그대로 GPU에 올린다.
+    static MeshUPtr CreateFromData(const Vertex* vertices, size_t vertexCount,
+                                    const uint32_t* indices, size_t indexCount,
+                                    uint32_t primitiveType,
+                                    VertexFormat format = VERTEX_FORMAT_FLOAT);
+    // vertices가 이미 format으로, indices가 이미 indexType(GL_UNSIGNED_SHORT / GL_UNSIGNED_INT)으로
+    // 저장되어 있을 때
+    static MeshUPtr CreateFromData(const void* vertices, size_t vertexCount, VertexFormat format,
+                                    const void* indices, size_t indexCount,
+                                    uint32_t indexType, uint32_t primitiveType);
+    // Vertex 수가 65536개 이하면 16bit Index로 충분하다.
+    static uint32_t GetIndexTypeFor(size_t vertexCount)
+    { return (vertexCount <= 0x10000 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT); };
+    static size_t   GetIndexSize(uint32_t indexType)
+    { return (indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t)); };
+    static size_t   GetVertexStride(VertexFormat format)
+    { return (format == VERTEX_FORMAT_PACKED ? sizeof(PackedVertex) : sizeof(Vertex)); };
+    static std::vector<PackedVertex>    PackVertices(const Vertex* vertices, size_t vertexCount);
+    // 다른 Mesh의 Vertex Buffer를 같이 쓰고 Index만 다른 Mesh (ex. LOD)
+    static MeshUPtr CreateWithVertexBuffer(BufferSPtr vertexBuffer, VertexFormat format,
+                                    const std::vector<uint32_t>& indices, uint32_t primitiveType);
+    static MeshUPtr CreateWithVertexBuffer(BufferSPtr vertexBuffer, VertexFormat format,
+                                    const void* indices, size_t indexCount,
+                                    uint32_t indexType, uint32_t primitiveType);
     static MeshUPtr CreateBox(void);
     static MeshUPtr CreatePlane(void);
     static void     ComputeTangents(std::vector<Vertex>& vertices,
                                     const std::vector<uint32_t>& indices);
+    // 이전 구현 (단일 Thread, v2 / v3는 누적하지 않고 덮어쓴다.) : 비교용
+    static void     ComputeTangentsLegacy(std::vector<Vertex>& vertices,
+                                    const std::vector<uint32_t>& indices);
+    static inline bool  useLegacyTangents { false };
 
     void    SetMaterial(MaterialSPtr material)
     { this->m_material = material; };
+    void    SetBounds(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+    { this->m_boundsMin = boundsMin; this->m_boundsMax = boundsMax; };
 
     const VertexLayout* GetVertexLayout(void) const
     { return (this->m_vertexLayout.get()); }
@@ -35,9 +87,24 @@ public:
     { return (this->m_vertexBuffer); }
     BufferSPtr          GetIndexBuffer(void) const
     { return (this->m_indexBuffer); }
+    uint32_t            GetIndexType(void) const
+    { return (this->m_indexType); };
+    size_t              GetIndexCount(void) const
+    { return (this->m_indexBuffer->GetCount()); };
+    VertexFormat        GetVertexFormat(void) const
+    { return (this->m_vertexFormat); };
     MaterialSPtr        GetMaterial(void) const
     { return (this->m_material); };
-
+    const glm::vec3&    GetBoundsMin(void) const
+    { return (this->m_boundsMin); };
+    const glm::vec3&    GetBoundsMax(void) const
+    { return (this->m_boundsMax); };
+
+    void      Bind(void) const
+    { this->m_vertexLayout->Bind(); };
+    // VAO와 Material이 이미 설정되어 있을 때 Draw Call만 보낸다.
+    void      DrawElements(void) const
+    { glDrawElements(this->m_primitiveType, m_indexBuffer->GetCount(), this->m_indexType, 0); };
     void      Draw(const Program* program) const;
 private:
     VertexLayoutUPtr    m_vertexLayout; // VAO
@@ -46,22 +113,78 @@ private:
     BufferSPtr          m_vertexBuffer; // VBO
     BufferSPtr          m_indexBuffer;  // EBO
     uint32_t            m_primitiveType { GL_TRIANGLES };
+    uint32_t            m_indexType { GL_UNSIGNED_INT };
+    VertexFormat        m_vertexFormat { VERTEX_FORMAT_FLOAT };
 
     MaterialSPtr        m_material;
+    glm::vec3           m_boundsMin { 0.0f };
+    glm::vec3           m_boundsMax { 0.0f };
 
     Mesh() {};
     void    init(const std::vector<Vertex>& vertices,
                 const std::vector<uint32_t>& indices,
-                uint32_t primitiveType);
+                uint32_t primitiveType, bool optimize, VertexFormat format);
+    void    initBuffers(const Vertex* vertices, size_t vertexCount,
+                        const uint32_t* indices, size_t indexCount,
+                        uint32_t primitiveType, VertexFormat format);
+    void    initBuffers(const void* vertices, size_t vertexCount, VertexFormat format,
+                        const void* indices, size_t indexCount,
+                        uint32_t indexType, uint32_t primitiveType);
+    void    initWithVertexBuffer(BufferSPtr vertexBuffer, VertexFormat format,
+                        const void* indices, size_t indexCount,
+                        uint32_t indexType, uint32_t primitiveType);
 
 };
 
 MeshUPtr    Mesh::Create(const std::vector<Vertex>& vertices,
                         const std::vector<uint32_t>& indices,
-                        uint32_t primitiveType)
+                        uint32_t primitiveType, bool optimize, VertexFormat format)
+{
+    MeshUPtr    mesh = MeshUPtr(new Mesh());
+    mesh->init(vertices, indices, primitiveType, optimize, format);
+    return (std::move(mesh));
+};
+
+MeshUPtr    Mesh::CreateFromData(const Vertex* vertices, size_t vertexCount,
+                                const uint32_t* indices, size_t indexCount,
+                                uint32_t primitiveType, VertexFormat format)
+{
+    MeshUPtr    mesh = MeshUPtr(new Mesh());
+    mesh->initBuffers(vertices, vertexCount, indices, indexCount, primitiveType, format);
+    return (std::move(mesh));
+};
+
+MeshUPtr    Mesh::CreateFromData(const void* vertices, size_t vertexCount, VertexFormat format,
+                                const void* indices, size_t indexCount,
+                                uint32_t indexType, uint32_t primitiveType)
+{
+    MeshUPtr    mesh = MeshUPtr(new Mesh());
+    mesh->initBuffers(vertices, vertexCount, format, indices, indexCount, indexType, primitiveType);
+    return (std::move(mesh));
+};
+
+MeshUPtr    Mesh::CreateWithVertexBuffer(BufferSPtr vertexBuffer, VertexFormat format,
+                                const std::vector<uint32_t>& indices, uint32_t primitiveType)
 {
     MeshUPtr    mesh = MeshUPtr(new Mesh());
-    mesh->init(vertices, indices, primitiveType);
+    if (GetIndexTypeFor(vertexBuffer->GetCount()) == GL_UNSIGNED_INT)
+        mesh->initWithVertexBuffer(vertexBuffer, format, indices.data(), indices.size(),
+                                    GL_UNSIGNED_INT, primitiveType);
+    else
+    {
+        std::vector<uint16_t>   shortIndices(indices.begin(), indices.end());
+        mesh->initWithVertexBuffer(vertexBuffer, format, shortIndices.data(), shortIndices.size(),
+                                    GL_UNSIGNED_SHORT, primitiveType);
+    }
+    return (std::move(mesh));
+};
+
+MeshUPtr    Mesh::CreateWithVertexBuffer(BufferSPtr vertexBuffer, VertexFormat format,
+                                const void* indices, size_t indexCount,
+                                uint32_t indexType, uint32_t primitiveType)
+{
+    MeshUPtr    mesh = MeshUPtr(new Mesh());
+    mesh->initWithVertexBuffer(vertexBuffer, format, indices, indexCount, indexType, primitiveType);
     return (std::move(mesh));
 };
 
@@ -128,6 +251,100 @@ MeshUPtr    Mesh::CreatePlane(void)
 };
 
 void    Mesh::ComputeTangents(std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+{
+    if (useLegacyTangents)
+    {
+        ComputeTangentsLegacy(vertices, indices);
+        return ;
+    }
+
+    const size_t    vertexCount = vertices.size();
+    const size_t    triangleCount = indices.size() / 3;
+    ThreadPool&     pool = ThreadPool::Get();
+    const size_t    MIN_TRIANGLES_PER_CHUNK = 16384;
+    uint32_t        chunkCount = pool.GetChunkCount(triangleCount, MIN_TRIANGLES_PER_CHUNK);
+
+    // Thread별 누적 Buffer (SoA) : 같은 Vertex를 여러 Thread가 동시에 쓰지 않도록 나눠 두고 마지막에 합친다.
+    struct Partial {
+        std::vector<float>  tx, ty, tz;
+        std::vector<float>  bx, by, bz;
+    };
+    std::vector<Partial>    partials(chunkCount);
+
+    pool.ParallelFor(triangleCount, MIN_TRIANGLES_PER_CHUNK, [&](uint32_t chunk, size_t begin, size_t end)
+    {
+        Partial&    partial = partials[chunk];
+        for (auto* buffer : { &partial.tx, &partial.ty, &partial.tz, &partial.bx, &partial.by, &partial.bz })
+            buffer->assign(vertexCount, 0.0f);
+
+        for (size_t t = begin; t < end; ++t)
+        {
+            uint32_t    v[3] = { indices[3 * t], indices[3 * t + 1], indices[3 * t + 2] };
+            glm::vec3   edge1 = vertices[v[1]].position - vertices[v[0]].position;
+            glm::vec3   edge2 = vertices[v[2]].position - vertices[v[0]].position;
+            glm::vec2   deltaUV1 = vertices[v[1]].texCoord - vertices[v[0]].texCoord;
+            glm::vec2   deltaUV2 = vertices[v[2]].texCoord - vertices[v[0]].texCoord;
+            float       det = deltaUV1.x * deltaUV2.y - deltaUV1.y * deltaUV2.x;
+            if (det == 0.0f)
+                continue ;
+
+            // 삼각형 하나의 T, B는 세 Vertex에 같은 값 -> 모두 누적한다. (삼각형 순서와 무관)
+            float       invDet = 1.0f / det;
+            glm::vec3   tangent = invDet * (deltaUV2.y * edge1 - deltaUV1.y * edge2);
+            glm::vec3   bitangent = invDet * (deltaUV1.x * edge2 - deltaUV2.x * edge1);
+            for (int k = 0; k < 3; ++k)
+            {
+                partial.tx[v[k]] += tangent.x;
+                partial.ty[v[k]] += tangent.y;
+                partial.tz[v[k]] += tangent.z;
+                partial.bx[v[k]] += bitangent.x;
+                partial.by[v[k]] += bitangent.y;
+                partial.bz[v[k]] += bitangent.z;
+            }
+        }
+    });
+
+    // 합치기 + Gram-Schmidt 직교화 + Handedness
+    const size_t    MIN_VERTICES_PER_CHUNK = 32768;
+    pool.ParallelFor(vertexCount, MIN_VERTICES_PER_CHUNK, [&](uint32_t, size_t begin, size_t end)
+    {
+        Partial&    sum = partials[0];
+        for (uint32_t c = 1; c < chunkCount; ++c)
+        {
+            const Partial&  partial = partials[c];
+            for (size_t i = begin; i < end; ++i)
+            {
+                sum.tx[i] += partial.tx[i];
+                sum.ty[i] += partial.ty[i];
+                sum.tz[i] += partial.tz[i];
+                sum.bx[i] += partial.bx[i];
+                sum.by[i] += partial.by[i];
+                sum.bz[i] += partial.bz[i];
+            }
+        }
+
+        for (size_t i = begin; i < end; ++i)
+        {
+            const glm::vec3&    normal = vertices[i].normal;
+            glm::vec3   tangent(sum.tx[i], sum.ty[i], sum.tz[i]);
+            glm::vec3   bitangent(sum.bx[i], sum.by[i], sum.bz[i]);
+            tangent = tangent - normal * glm::dot(normal, tangent);
+            float       length = glm::length(tangent);
+            if (length < 1e-12f)
+            {
+                // UV가 퇴화된 Vertex : Normal에 수직인 아무 축이나 쓴다.
+                glm::vec3   axis = glm::abs(normal.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+                tangent = glm::normalize(glm::cross(axis, normal));
+            }
+            else
+                tangent = tangent / length;
+            float   handedness = glm::dot(glm::cross(normal, tangent), bitangent) < 0.0f ? -1.0f : 1.0f;
+            vertices[i].tangent = glm::vec4(tangent, handedness);
+        }
+    });
+};
+
+void    Mesh::ComputeTangentsLegacy(std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
 {
     auto     compute = [](const glm::vec3& pos1, const glm::vec3& pos2, const glm::vec3& pos3,
                         const glm::vec2& uv1, const glm::vec2& uv2, const glm::vec2& uv3)
@@ -172,34 +389,147 @@ void    Mesh::ComputeTangents(std::vector<Vertex>& vertices, const std::vector<u
 
     // normalize
     for (size_t i = 0; i < vertices.size(); i++)
-        vertices[i].tangent = glm::normalize(tangents[i]);
+        vertices[i].tangent = glm::vec4(glm::normalize(tangents[i]), 1.0f);
+};
+
+std::vector<PackedVertex>   Mesh::PackVertices(const Vertex* vertices, size_t vertexCount)
+{
+    // 단위 벡터를 정팔면체에 투영한 뒤 아래 반구를 접어서 [-1, 1]^2 로 만든다.
+    auto    EncodeOctahedral = [](glm::vec3 n) -> glm::vec2
+    {
+        float   sum = glm::abs(n.x) + glm::abs(n.y) + glm::abs(n.z);
+        if (sum == 0.0f)
+            return (glm::vec2(0.0f, 0.0f));
+        n /= sum;
+        if (n.z >= 0.0f)
+            return (glm::vec2(n.x, n.y));
+        return (glm::vec2((1.0f - glm::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+                        (1.0f - glm::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f)));
+    };
+    // x, y : 10bit snorm / z : 0 / w : 2bit snorm (+1 / -1)
+    auto    Pack2_10_10_10 = [](const glm::vec2& e, float sign) -> uint32_t
+    {
+        int32_t x = static_cast<int32_t>(glm::round(glm::clamp(e.x, -1.0f, 1.0f) * 511.0f));
+        int32_t y = static_cast<int32_t>(glm::round(glm::clamp(e.y, -1.0f, 1.0f) * 511.0f));
+        int32_t w = sign < 0.0f ? -1 : 1;
+        return ((static_cast<uint32_t>(x) & 0x3FF) | ((static_cast<uint32_t>(y) & 0x3FF) << 10)
+                | ((static_cast<uint32_t>(w) & 0x3) << 30));
+    };
+
+    std::vector<PackedVertex>   packed(vertexCount);
+    for (size_t i = 0; i < vertexCount; ++i)
+    {
+        auto&   src = vertices[i];
+        auto&   dst = packed[i];
+        dst.position = src.position;
+        dst.normal = glm::packSnorm2x16(EncodeOctahedral(src.normal));
+        dst.tangent = Pack2_10_10_10(EncodeOctahedral(glm::vec3(src.tangent)), src.tangent.w);
+        dst.texCoord = glm::packHalf2x16(src.texCoord);
+    }
+    return (packed);
 };
 
 void        Mesh::Draw(const Program* program) const
 {
-    this->m_vertexLayout->Bind();
+    Bind();
     if (this->m_material)
         this->m_material->SetToProgram(program);
-    glDrawElements(this->m_primitiveType, m_indexBuffer->GetCount(), GL_UNSIGNED_INT, 0);
+    DrawElements();
 };
 
 void        Mesh::init(const std::vector<Vertex>& vertices,
                         const std::vector<uint32_t>& indices,
-                        uint32_t primitiveType)
+                        uint32_t primitiveType, bool optimize, VertexFormat format)
 {
     if (primitiveType == GL_TRIANGLES)
         ComputeTangents(const_cast<std::vector<Vertex>&>(vertices), indices);
 
+    // 원본을 건드리지 않도록 최적화는 복사본에 적용한다.
+    std::vector<Vertex>     optimizedVertices;
+    std::vector<uint32_t>   optimizedIndices;
+    const std::vector<Vertex>*      uploadVertices = &vertices;
+    const std::vector<uint32_t>*    uploadIndices = &indices;
+    if (optimize && primitiveType == GL_TRIANGLES)
+    {
+        optimizedVertices = vertices;
+        optimizedIndices = indices;
+        auto    stats = MeshOptimizer::Optimize(optimizedVertices, optimizedIndices, offsetof(Vertex, position));
+        MeshOptimizer::PrintStats(stats, optimizedIndices.size() / 3);
+        uploadVertices = &optimizedVertices;
+        uploadIndices = &optimizedIndices;
+    }
+
+    if (!uploadVertices->empty())
+    {
+        this->m_boundsMin = this->m_boundsMax = uploadVertices->front().position;
+        for (auto& vertex : *uploadVertices)
+        {
+            this->m_boundsMin = glm::min(this->m_boundsMin, vertex.position);
+            this->m_boundsMax = glm::max(this->m_boundsMax, vertex.position);
+        }
+    }
+    initBuffers(uploadVertices->data(), uploadVertices->size(),
+                uploadIndices->data(), uploadIndices->size(), primitiveType, format);
+};
+
+void        Mesh::initBuffers(const Vertex* vertices, size_t vertexCount,
+                            const uint32_t* indices, size_t indexCount,
+                            uint32_t primitiveType, VertexFormat format)
+{
+    std::vector<PackedVertex>   packedVertices;
+    const void*                 uploadVertices = vertices;
+    if (format == VERTEX_FORMAT_PACKED)
+    {
+        packedVertices = PackVertices(vertices, vertexCount);
+        uploadVertices = packedVertices.data();
+    }
+
+    if (GetIndexTypeFor(vertexCount) == GL_UNSIGNED_INT)
+    {
+        initBuffers(uploadVertices, vertexCount, format, indices, indexCount, GL_UNSIGNED_INT, primitiveType);
+        return ;
+    }
+
+    // Index Memory / Bandwidth를 절반으로 줄인다.
+    std::vector<uint16_t>   shortIndices(indices, indices + indexCount);
+    initBuffers(uploadVertices, vertexCount, format, shortIndices.data(), indexCount,
+                GL_UNSIGNED_SHORT, primitiveType);
+};
+
+void        Mesh::initBuffers(const void* vertices, size_t vertexCount, VertexFormat format,
+                            const void* indices, size_t indexCount,
+                            uint32_t indexType, uint32_t primitiveType)
+{
+    BufferSPtr  vertexBuffer = Buffer::CreateWithData(GL_ARRAY_BUFFER, GL_STATIC_DRAW,
+                                                    vertices, GetVertexStride(format), vertexCount);
+    initWithVertexBuffer(vertexBuffer, format, indices, indexCount, indexType, primitiveType);
+};
+
+void        Mesh::initWithVertexBuffer(BufferSPtr vertexBuffer, VertexFormat format,
+                                    const void* indices, size_t indexCount,
+                                    uint32_t indexType, uint32_t primitiveType)
+{
+    this->m_primitiveType = primitiveType;
+    this->m_indexType = indexType;
+    this->m_vertexFormat = format;
     this->m_vertexLayout = VertexLayout::Create();
-    this->m_vertexBuffer = Buffer::CreateWithData(GL_ARRAY_BUFFER, GL_STATIC_DRAW,
-                                                    vertices.data(), sizeof(Vertex), vertices.size());
+    this->m_vertexBuffer = vertexBuffer;
+    this->m_vertexBuffer->Bind();
     this->m_indexBuffer = Buffer::CreateWithData(GL_ELEMENT_ARRAY_BUFFER, GL_STATIC_DRAW,
-                                                    indices.data(), sizeof(uint32_t), indices.size());
+                                                    indices, GetIndexSize(indexType), indexCount);
     
+    if (format == VERTEX_FORMAT_PACKED)
+    {
+        this->m_vertexLayout->SetAttrib(0, 3, GL_FLOAT, false, sizeof(PackedVertex), offsetof(PackedVertex, position));
+        this->m_vertexLayout->SetAttrib(1, 2, GL_SHORT, true, sizeof(PackedVertex), offsetof(PackedVertex, normal));
+        this->m_vertexLayout->SetAttrib(2, 2, GL_HALF_FLOAT, false, sizeof(PackedVertex), offsetof(PackedVertex, texCoord));
+        this->m_vertexLayout->SetAttrib(3, 4, GL_INT_2_10_10_10_REV, true, sizeof(PackedVertex), offsetof(PackedVertex, tangent));
+        return ;
+    }
     this->m_vertexLayout->SetAttrib(0, 3, GL_FLOAT, false, sizeof(Vertex), offsetof(Vertex, position));
     this->m_vertexLayout->SetAttrib(1, 3, GL_FLOAT, false, sizeof(Vertex), offsetof(Vertex, normal));
     this->m_vertexLayout->SetAttrib(2, 2, GL_FLOAT, false, sizeof(Vertex), offsetof(Vertex, texCoord));
-    this->m_vertexLayout->SetAttrib(3, 3, GL_FLOAT, false, sizeof(Vertex), offsetof(Vertex, tangent));
+    this->m_vertexLayout->SetAttrib(3, 4, GL_FLOAT, false, sizeof(Vertex), offsetof(Vertex, tangent));
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,397 @@
+#ifndef MESHCACHE_HPP
+#define MESHCACHE_HPP
+
+#include "Common.hpp"
+#include "Mesh.hpp"
+#include "MappedFile.hpp"
+
+// Assimp Import 결과(Tangent까지 계산된 Vertex / Index, Material 경로, Bounds, Node 계층)를
+// Binary(.meshcache)로 저장한다. 다음 실행에서는 파일을 mmap 해서
+// Vertex / Index Blob을 복사 없이 그대로 Buffer::CreateWithData에 넘긴다.
+//
+// [Header][MeshRecord x meshCount][MaterialRecord x materialCount]
+// [NodeRecord x nodeCount][Node Mesh Index x nodeMeshCount][String Table][Blob ...]
+// Mesh마다 Blob은 [Vertex][Index][LodRecord x lodCount][LOD Index ...] 순서.
+struct MeshCacheData
+{
+    struct MeshData {
+        std::vector<Vertex>     vertices;
+        std::vector<uint32_t>   indices;
+        int32_t                 materialIndex { -1 };
+        glm::vec3               boundsMin { 0.0f };
+        glm::vec3               boundsMax { 0.0f };
+        // Level 1 ~ 의 LOD Index와 원본 대비 Object Space 오차 (MeshLOD::BuildLevels)
+        std::vector<std::vector<uint32_t>>  lodIndices;
+        std::vector<float>                  lodErrors;
+    };
+    struct MaterialData {
+        std::string diffuse;
+        std::string specular;
+    };
+    // 위상 순서(부모가 먼저)로 펼친 aiNode
+    struct NodeData {
+        uint32_t                parent { 0xFFFFFFFF };
+        glm::mat4               transform { glm::mat4(1.0f) };
+        std::string             name;
+        std::vector<uint32_t>   meshes;
+    };
+
+    std::vector<MeshData>       meshes;
+    std::vector<MaterialData>   materials;
+    std::vector<NodeData>       nodes;
+};
+
+// Cache를 만들 때 적용한 처리. 다르면 Cache를 다시 만든다.
+const uint32_t  MESH_CACHE_OPTIMIZED = 1 << 0;
+const uint32_t  MESH_CACHE_PACKED_VERTEX = 1 << 1;  // Vertex Blob이 PackedVertex
+// flags의 8bit 이상은 요청한 최대 LOD Level 수
+const uint32_t  MESH_CACHE_LOD_SHIFT = 8;
+
+CLASS_PTR(MeshCache);
+class MeshCache
+{
+public:
+    struct MeshRecord {
+        uint64_t    vertexOffset;
+        uint64_t    indexOffset;
+        uint32_t    vertexCount;
+        uint32_t    indexCount;
+        int32_t     materialIndex;
+        float       boundsMin[3];
+        float       boundsMax[3];
+        uint32_t    indexType;  // GL_UNSIGNED_SHORT / GL_UNSIGNED_INT
+        uint64_t    lodOffset;
+        uint32_t    lodCount;
+        uint32_t    padding;
+    };
+    struct NodeRecord {
+        uint32_t    parent;
+        uint32_t    meshOffset;     // Node Mesh Index 배열에서의 시작 위치
+        uint32_t    meshCount;
+        uint32_t    nameOffset;
+        uint32_t    nameLength;
+        float       transform[16];  // Column-Major
+    };
+    // LOD Index는 Level 0과 같은 indexType / 같은 Vertex Blob을 쓴다.
+    struct LodRecord {
+        uint64_t    indexOffset;
+        uint32_t    indexCount;
+        float       error;
+    };
+
+    // 원본 파일의 크기 / 수정 시간이 Header와 다르면 nullptr (다시 Import 해야 한다.)
+    static MeshCacheUPtr    Open(const std::string& sourcePath, uint32_t flags = 0);
+    static bool             Write(const std::string& sourcePath, const MeshCacheData& data,
+                                uint32_t flags = 0);
+    // 같은 원본이라도 flags(최적화 / Vertex Format / LOD 수)가 다르면 다른 파일을 쓴다.
+    static std::string      GetCachePath(const std::string& sourcePath, uint32_t flags = 0);
+
+    uint32_t            GetMeshCount(void) const
+    { return (this->m_header->meshCount); };
+    uint32_t            GetMaterialCount(void) const
+    { return (this->m_header->materialCount); };
+    uint32_t            GetNodeCount(void) const
+    { return (this->m_header->nodeCount); };
+    const NodeRecord&   GetNode(uint32_t index) const
+    { return (this->m_nodes[index]); };
+    uint32_t            GetNodeMesh(uint32_t index, uint32_t mesh) const
+    { return (this->m_nodeMeshes[this->m_nodes[index].meshOffset + mesh]); };
+    std::string         GetNodeName(uint32_t index) const
+    { return (GetString(this->m_nodes[index].nameOffset, this->m_nodes[index].nameLength)); };
+    const MeshRecord&   GetMesh(uint32_t index) const
+    { return (this->m_meshes[index]); };
+    VertexFormat        GetVertexFormat(void) const
+    { return ((this->m_header->flags & MESH_CACHE_PACKED_VERTEX) ? VERTEX_FORMAT_PACKED : VERTEX_FORMAT_FLOAT); };
+    const void*         GetVertices(uint32_t index) const
+    { return (this->m_file->GetData() + this->m_meshes[index].vertexOffset); };
+    const void*         GetIndices(uint32_t index) const
+    { return (this->m_file->GetData() + this->m_meshes[index].indexOffset); };
+    uint32_t            GetLodCount(uint32_t index) const
+    { return (this->m_meshes[index].lodCount); };
+    const LodRecord&    GetLod(uint32_t index, uint32_t level) const
+    { return (reinterpret_cast<const LodRecord*>(this->m_file->GetData() + this->m_meshes[index].lodOffset)[level]); };
+    const void*         GetLodIndices(uint32_t index, uint32_t level) const
+    { return (this->m_file->GetData() + GetLod(index, level).indexOffset); };
+    std::string         GetDiffusePath(uint32_t index) const
+    { return (GetString(this->m_materials[index].diffuseOffset, this->m_materials[index].diffuseLength)); };
+    std::string         GetSpecularPath(uint32_t index) const
+    { return (GetString(this->m_materials[index].specularOffset, this->m_materials[index].specularLength)); };
+private:
+    struct Header {
+        uint32_t    magic;
+        uint32_t    version;
+        uint64_t    sourceSize;
+        int64_t     sourceTime;
+        uint32_t    vertexStride;
+        uint32_t    meshCount;
+        uint32_t    materialCount;
+        uint32_t    nodeCount;
+        uint32_t    nodeMeshCount;
+        uint32_t    flags;
+        uint64_t    stringOffset;
+        uint64_t    stringSize;
+    };
+    struct MaterialRecord {
+        uint32_t    diffuseOffset;
+        uint32_t    diffuseLength;
+        uint32_t    specularOffset;
+        uint32_t    specularLength;
+    };
+    static const uint32_t   MAGIC = 0x4348534D; // "MSHC"
+    static const uint32_t   VERSION = 8;
+    static const uint64_t   BLOB_ALIGNMENT = 16;
+
+    MappedFileUPtr          m_file;
+    const Header*           m_header { nullptr };
+    const MeshRecord*       m_meshes { nullptr };
+    const MaterialRecord*   m_materials { nullptr };
+    const NodeRecord*       m_nodes { nullptr };
+    const uint32_t*         m_nodeMeshes { nullptr };
+
+    MeshCache() {};
+    bool        init(const std::string& sourcePath, uint32_t flags);
+    std::string GetString(uint32_t offset, uint32_t length) const;
+};
+
+MeshCacheUPtr   MeshCache::Open(const std::string& sourcePath, uint32_t flags)
+{
+    MeshCacheUPtr   cache = MeshCacheUPtr(new MeshCache());
+    if (!cache->init(sourcePath, flags))
+        return (nullptr);
+    return (std::move(cache));
+};
+
+std::string MeshCache::GetCachePath(const std::string& sourcePath, uint32_t flags)
+{
+    std::stringstream   name;
+    name << "./cache/mesh/" << std::hex << HashString(sourcePath) << "_" << flags << ".meshcache";
+    return (name.str());
+};
+
+bool    MeshCache::init(const std::string& sourcePath, uint32_t flags)
+{
+    uint64_t    sourceSize = 0;
+    int64_t     sourceTime = 0;
+    if (!GetFileStamp(sourcePath, sourceSize, sourceTime))
+        return (false);
+
+    this->m_file = MappedFile::Open(GetCachePath(sourcePath, flags));
+    if (!this->m_file || this->m_file->GetSize() < sizeof(Header))
+        return (false);
+
+    const uint8_t*  base = this->m_file->GetData();
+    size_t          fileSize = this->m_file->GetSize();
+    this->m_header = reinterpret_cast<const Header*>(base);
+    if (this->m_header->magic != MAGIC || this->m_header->version != VERSION
+        || this->m_header->flags != flags
+        || this->m_header->sourceSize != sourceSize || this->m_header->sourceTime != sourceTime
+        || this->m_header->vertexStride != Mesh::GetVertexStride(GetVertexFormat()))
+        return (false);
+
+    size_t  tableEnd = sizeof(Header) + this->m_header->meshCount * sizeof(MeshRecord)
+                        + this->m_header->materialCount * sizeof(MaterialRecord)
+                        + this->m_header->nodeCount * sizeof(NodeRecord)
+                        + this->m_header->nodeMeshCount * sizeof(uint32_t);
+    if (tableEnd > fileSize || this->m_header->stringOffset + this->m_header->stringSize > fileSize)
+        return (false);
+    this->m_meshes = reinterpret_cast<const MeshRecord*>(base + sizeof(Header));
+    this->m_materials = reinterpret_cast<const MaterialRecord*>(this->m_meshes + this->m_header->meshCount);
+    this->m_nodes = reinterpret_cast<const NodeRecord*>(this->m_materials + this->m_header->materialCount);
+    this->m_nodeMeshes = reinterpret_cast<const uint32_t*>(this->m_nodes + this->m_header->nodeCount);
+
+    // 부모가 자식보다 앞에 있어야 SceneGraph에 그대로 넣을 수 있다.
+    for (uint32_t i = 0; i < this->m_header->nodeCount; ++i)
+    {
+        auto&   node = this->m_nodes[i];
+        if ((node.parent != 0xFFFFFFFF && node.parent >= i)
+            || uint64_t(node.meshOffset) + node.meshCount > this->m_header->nodeMeshCount)
+            return (false);
+        for (uint32_t mesh = 0; mesh < node.meshCount; ++mesh)
+        {
+            if (GetNodeMesh(i, mesh) >= this->m_header->meshCount)
+                return (false);
+        }
+    }
+
+    // 잘린 파일을 GPU에 올리지 않도록 Blob 범위를 미리 확인한다.
+    for (uint32_t i = 0; i < this->m_header->meshCount; ++i)
+    {
+        auto&   mesh = this->m_meshes[i];
+        if ((mesh.indexType != GL_UNSIGNED_SHORT && mesh.indexType != GL_UNSIGNED_INT)
+            || mesh.vertexOffset + uint64_t(mesh.vertexCount) * this->m_header->vertexStride > fileSize
+            || mesh.indexOffset + uint64_t(mesh.indexCount) * Mesh::GetIndexSize(mesh.indexType) > fileSize
+            || mesh.materialIndex >= static_cast<int32_t>(this->m_header->materialCount)
+            || mesh.lodOffset + uint64_t(mesh.lodCount) * sizeof(LodRecord) > fileSize)
+            return (false);
+        for (uint32_t level = 0; level < mesh.lodCount; ++level)
+        {
+            auto&   lod = GetLod(i, level);
+            if (lod.indexOffset + uint64_t(lod.indexCount) * Mesh::GetIndexSize(mesh.indexType) > fileSize)
+                return (false);
+        }
+    }
+    return (true);
+};
+
+std::string MeshCache::GetString(uint32_t offset, uint32_t length) const
+{
+    // uint32 끼리 더하면 넘칠 수 있으므로 64bit로 비교한다.
+    if (uint64_t(offset) + length > this->m_header->stringSize)
+        return (std::string());
+    auto    str = reinterpret_cast<const char*>(this->m_file->GetData() + this->m_header->stringOffset + offset);
+    return (std::string(str, length));
+};
+
+bool    MeshCache::Write(const std::string& sourcePath, const MeshCacheData& data,
+                        uint32_t flags)
+{
+    Header  header {};
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.flags = flags;
+    if (!GetFileStamp(sourcePath, header.sourceSize, header.sourceTime))
+        return (false);
+    VertexFormat    format = (flags & MESH_CACHE_PACKED_VERTEX) ? VERTEX_FORMAT_PACKED : VERTEX_FORMAT_FLOAT;
+    header.vertexStride = static_cast<uint32_t>(Mesh::GetVertexStride(format));
+    header.meshCount = static_cast<uint32_t>(data.meshes.size());
+    header.materialCount = static_cast<uint32_t>(data.materials.size());
+    header.nodeCount = static_cast<uint32_t>(data.nodes.size());
+
+    std::string                 strings;
+    std::vector<MaterialRecord> materials;
+    for (auto& material : data.materials)
+    {
+        MaterialRecord  record {};
+        record.diffuseOffset = static_cast<uint32_t>(strings.size());
+        record.diffuseLength = static_cast<uint32_t>(material.diffuse.size());
+        strings += material.diffuse;
+        record.specularOffset = static_cast<uint32_t>(strings.size());
+        record.specularLength = static_cast<uint32_t>(material.specular.size());
+        strings += material.specular;
+        materials.push_back(record);
+    }
+
+    std::vector<NodeRecord> nodes;
+    std::vector<uint32_t>   nodeMeshes;
+    for (auto& node : data.nodes)
+    {
+        NodeRecord  record {};
+        record.parent = node.parent;
+        record.meshOffset = static_cast<uint32_t>(nodeMeshes.size());
+        record.meshCount = static_cast<uint32_t>(node.meshes.size());
+        record.nameOffset = static_cast<uint32_t>(strings.size());
+        record.nameLength = static_cast<uint32_t>(node.name.size());
+        for (int column = 0; column < 4; ++column)
+        {
+            for (int row = 0; row < 4; ++row)
+                record.transform[column * 4 + row] = node.transform[column][row];
+        }
+        strings += node.name;
+        nodeMeshes.insert(nodeMeshes.end(), node.meshes.begin(), node.meshes.end());
+        nodes.push_back(record);
+    }
+    header.nodeMeshCount = static_cast<uint32_t>(nodeMeshes.size());
+
+    auto    align = [](uint64_t offset) -> uint64_t
+    { return ((offset + BLOB_ALIGNMENT - 1) & ~(BLOB_ALIGNMENT - 1)); };
+
+    header.stringOffset = sizeof(Header) + data.meshes.size() * sizeof(MeshRecord)
+                            + materials.size() * sizeof(MaterialRecord)
+                            + nodes.size() * sizeof(NodeRecord) + nodeMeshes.size() * sizeof(uint32_t);
+    header.stringSize = strings.size();
+
+    // Blob은 16 byte 정렬 -> mmap 된 포인터를 그대로 Vertex / Index 배열로 쓴다.
+    std::vector<MeshRecord> meshes;
+    std::vector<LodRecord>  lods;
+    uint64_t    offset = align(header.stringOffset + header.stringSize);
+    for (auto& mesh : data.meshes)
+    {
+        MeshRecord  record {};
+        record.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+        record.indexCount = static_cast<uint32_t>(mesh.indices.size());
+        record.indexType = Mesh::GetIndexTypeFor(mesh.vertices.size());
+        record.materialIndex = mesh.materialIndex;
+        memcpy(record.boundsMin, &mesh.boundsMin[0], sizeof(record.boundsMin));
+        memcpy(record.boundsMax, &mesh.boundsMax[0], sizeof(record.boundsMax));
+        record.vertexOffset = offset;
+        offset = align(offset + mesh.vertices.size() * header.vertexStride);
+        record.indexOffset = offset;
+        offset = align(offset + mesh.indices.size() * Mesh::GetIndexSize(record.indexType));
+        record.lodCount = static_cast<uint32_t>(mesh.lodIndices.size());
+        record.lodOffset = offset;
+        offset = align(offset + mesh.lodIndices.size() * sizeof(LodRecord));
+        for (size_t level = 0; level < mesh.lodIndices.size(); ++level)
+        {
+            LodRecord   lod {};
+            lod.indexOffset = offset;
+            lod.indexCount = static_cast<uint32_t>(mesh.lodIndices[level].size());
+            lod.error = level < mesh.lodErrors.size() ? mesh.lodErrors[level] : 0.0f;
+            lods.push_back(lod);
+            offset = align(offset + mesh.lodIndices[level].size() * Mesh::GetIndexSize(record.indexType));
+        }
+        meshes.push_back(record);
+    }
+
+    std::string     path = GetCachePath(sourcePath, flags);
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+    std::ofstream   fout(path, std::ios::binary | std::ios::trunc);
+    if (!fout.is_open())
+    {
+        putError("Failed to write mesh cache: " + path);
+        return (false);
+    }
+
+    auto    pad = [&fout](uint64_t target)
+    {
+        static const char   zeros[BLOB_ALIGNMENT] = {};
+        uint64_t    current = static_cast<uint64_t>(fout.tellp());
+        if (target > current)
+            fout.write(zeros, static_cast<std::streamsize>(target - current));
+    };
+
+    auto    writeIndices = [&fout](const std::vector<uint32_t>& indices, uint32_t indexType)
+    {
+        if (indexType == GL_UNSIGNED_SHORT)
+        {
+            // Load 때 변환 없이 바로 올릴 수 있도록 16bit로 저장한다.
+            std::vector<uint16_t>   shortIndices(indices.begin(), indices.end());
+            fout.write(reinterpret_cast<const char*>(shortIndices.data()),
+                        shortIndices.size() * sizeof(uint16_t));
+        }
+        else
+            fout.write(reinterpret_cast<const char*>(indices.data()), indices.size() * sizeof(uint32_t));
+    };
+
+    fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    fout.write(reinterpret_cast<const char*>(meshes.data()), meshes.size() * sizeof(MeshRecord));
+    fout.write(reinterpret_cast<const char*>(materials.data()), materials.size() * sizeof(MaterialRecord));
+    fout.write(reinterpret_cast<const char*>(nodes.data()), nodes.size() * sizeof(NodeRecord));
+    fout.write(reinterpret_cast<const char*>(nodeMeshes.data()), nodeMeshes.size() * sizeof(uint32_t));
+    fout.write(strings.data(), strings.size());
+    size_t  lodIndex = 0;
+    for (size_t i = 0; i < data.meshes.size(); ++i)
+    {
+        pad(meshes[i].vertexOffset);
+        if (format == VERTEX_FORMAT_PACKED)
+        {
+            auto    packed = Mesh::PackVertices(data.meshes[i].vertices.data(), data.meshes[i].vertices.size());
+            fout.write(reinterpret_cast<const char*>(packed.data()), packed.size() * sizeof(PackedVertex));
+        }
+        else
+            fout.write(reinterpret_cast<const char*>(data.meshes[i].vertices.data()),
+                        data.meshes[i].vertices.size() * sizeof(Vertex));
+        pad(meshes[i].indexOffset);
+        writeIndices(data.meshes[i].indices, meshes[i].indexType);
+        pad(meshes[i].lodOffset);
+        fout.write(reinterpret_cast<const char*>(lods.data() + lodIndex), meshes[i].lodCount * sizeof(LodRecord));
+        for (uint32_t level = 0; level < meshes[i].lodCount; ++level, ++lodIndex)
+        {
+            pad(lods[lodIndex].indexOffset);
+            writeIndices(data.meshes[i].lodIndices[level], meshes[i].indexType);
+        }
+    }
+    return (static_cast<bool>(fout));
+};
+
+#endif
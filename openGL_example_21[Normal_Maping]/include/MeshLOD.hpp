@@ -0,0 +1,486 @@
+#ifndef MESHLOD_HPP
+#define MESHLOD_HPP
+
+#include "Common.hpp"
+#include "Mesh.hpp"
+
+// Quadric Error Metric (Garland & Heckbert 1997) Edge Collapse
+// Vertex Buffer는 그대로 두고 기존 Vertex만 참조하는 새 Index를 만든다. -> LOD끼리 Vertex Buffer 공유
+// - 위치가 같고 속성(UV / Normal)이 다른 Vertex(Seam)와 열린 경계의 Vertex는 움직이지 않는다.
+// - 주변 삼각형을 뒤집는 Collapse, Normal이 크게 다른 Vertex로의 Collapse는 피한다.
+class MeshSimplifier
+{
+public:
+    // targetError : Mesh 크기(Bounding Box의 가장 긴 변) 대비 허용 오차(Quadric). 넘으면 목표 전에 멈춘다.
+    // resultError : 입력 Vertex가 결과 표면에서 떨어진 최대 거리 (같은 단위)
+    // collapseMap : Vertex마다 합쳐진 뒤 남은 Vertex (움직이지 않았으면 자기 자신)
+    static std::vector<uint32_t>    Simplify(const std::vector<Vertex>& vertices,
+                                            const std::vector<uint32_t>& indices,
+                                            size_t targetIndexCount, float targetError,
+                                            float* resultError = nullptr,
+                                            std::vector<uint32_t>* collapseMap = nullptr);
+    // 합쳐진 Vertex의 원래 위치에서, 남은 Vertex를 쓰는 삼각형까지 가장 가까운 거리의 최댓값 (Object Space)
+    static float    MeasureDeviation(const std::vector<Vertex>& vertices,
+                                    const std::vector<uint32_t>& indices,
+                                    const std::vector<uint32_t>& collapseMap);
+    static float    GetExtent(const std::vector<Vertex>& vertices);
+private:
+    static float    PointTriangleDistance(const glm::vec3& p, const glm::vec3& a,
+                                        const glm::vec3& b, const glm::vec3& c);
+    struct Quadric {
+        double  a00 { 0.0 }, a01 { 0.0 }, a02 { 0.0 }, a11 { 0.0 }, a12 { 0.0 }, a22 { 0.0 };
+        double  b0 { 0.0 }, b1 { 0.0 }, b2 { 0.0 };
+        double  c { 0.0 };
+
+        void    AddPlane(const glm::vec3& n, float d, float weight);
+        void    Add(const Quadric& q);
+        double  Evaluate(const glm::vec3& p) const;
+    };
+};
+
+void    MeshSimplifier::Quadric::AddPlane(const glm::vec3& n, float d, float weight)
+{
+    a00 += weight * n.x * n.x;  a01 += weight * n.x * n.y;  a02 += weight * n.x * n.z;
+    a11 += weight * n.y * n.y;  a12 += weight * n.y * n.z;  a22 += weight * n.z * n.z;
+    b0 += weight * n.x * d;     b1 += weight * n.y * d;     b2 += weight * n.z * d;
+    c += weight * d * d;
+};
+
+void    MeshSimplifier::Quadric::Add(const Quadric& q)
+{
+    a00 += q.a00;   a01 += q.a01;   a02 += q.a02;
+    a11 += q.a11;   a12 += q.a12;   a22 += q.a22;
+    b0 += q.b0;     b1 += q.b1;     b2 += q.b2;
+    c += q.c;
+};
+
+double  MeshSimplifier::Quadric::Evaluate(const glm::vec3& p) const
+{
+    // p^T A p + 2 b.p + c  : 누적된 평면들까지 거리 제곱의 (면적 가중) 합
+    double  x = p.x, y = p.y, z = p.z;
+    double  result = a00 * x * x + a11 * y * y + a22 * z * z
+                    + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+                    + 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+    return (std::max(result, 0.0));
+};
+
+float   MeshSimplifier::GetExtent(const std::vector<Vertex>& vertices)
+{
+    if (vertices.empty())
+        return (0.0f);
+    glm::vec3   boundsMin = vertices[0].position, boundsMax = vertices[0].position;
+    for (auto& vertex : vertices)
+    {
+        boundsMin = glm::min(boundsMin, vertex.position);
+        boundsMax = glm::max(boundsMax, vertex.position);
+    }
+    glm::vec3   size = boundsMax - boundsMin;
+    return (std::max(size.x, std::max(size.y, size.z)));
+};
+
+float   MeshSimplifier::PointTriangleDistance(const glm::vec3& p, const glm::vec3& a,
+                                            const glm::vec3& b, const glm::vec3& c)
+{
+    // 삼각형 위의 가장 가까운 점 (Ericson, Real-Time Collision Detection 5.1.5)
+    glm::vec3   ab = b - a, ac = c - a, ap = p - a;
+    float       d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+    if (d1 <= 0.0f && d2 <= 0.0f)
+        return (glm::length(ap));
+    glm::vec3   bp = p - b;
+    float       d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+    if (d3 >= 0.0f && d4 <= d3)
+        return (glm::length(bp));
+    float       vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+        return (glm::length(p - (a + ab * (d1 / (d1 - d3)))));
+    glm::vec3   cp = p - c;
+    float       d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+    if (d6 >= 0.0f && d5 <= d6)
+        return (glm::length(cp));
+    float       vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+        return (glm::length(p - (a + ac * (d2 / (d2 - d6)))));
+    float       va = d3 * d6 - d5 * d4;
+    if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+        return (glm::length(p - (b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6))))));
+    float       denom = 1.0f / (va + vb + vc);
+    return (glm::length(p - (a + ab * (vb * denom) + ac * (vc * denom))));
+};
+
+float   MeshSimplifier::MeasureDeviation(const std::vector<Vertex>& vertices,
+                                        const std::vector<uint32_t>& indices,
+                                        const std::vector<uint32_t>& collapseMap)
+{
+    // 남은 Vertex -> 그 Vertex를 쓰는 삼각형
+    const size_t            vertexCount = vertices.size();
+    std::vector<uint32_t>   triangleOffsets(vertexCount + 1, 0);
+    for (uint32_t v : indices)
+        ++triangleOffsets[v + 1];
+    for (size_t v = 0; v < vertexCount; ++v)
+        triangleOffsets[v + 1] += triangleOffsets[v];
+    std::vector<uint32_t>   triangleFill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+    std::vector<uint32_t>   adjacency(indices.size());
+    for (size_t i = 0; i < indices.size(); ++i)
+        adjacency[triangleFill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+
+    // 남은 Vertex는 결과 표면 위에 있으므로 합쳐진 Vertex만 본다.
+    // Seam 건너편(다른 Index)의 삼각형은 보지 않으므로 실제보다 크게 나올 수는 있어도 작게 나오지는 않는다.
+    float   maxDistance = 0.0f;
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        uint32_t    target = collapseMap[v];
+        if (target == v || triangleOffsets[target] == triangleOffsets[target + 1])
+            continue ;
+        const glm::vec3&    p = vertices[v].position;
+        float   distance = std::numeric_limits<float>::max();
+        for (uint32_t a = triangleOffsets[target]; a < triangleOffsets[target + 1]; ++a)
+        {
+            size_t  t = 3 * adjacency[a];
+            distance = std::min(distance, PointTriangleDistance(p, vertices[indices[t]].position,
+                                                                vertices[indices[t + 1]].position,
+                                                                vertices[indices[t + 2]].position));
+        }
+        maxDistance = std::max(maxDistance, distance);
+    }
+    return (maxDistance);
+};
+
+std::vector<uint32_t>   MeshSimplifier::Simplify(const std::vector<Vertex>& vertices,
+                                                const std::vector<uint32_t>& indices,
+                                                size_t targetIndexCount, float targetError,
+                                                float* resultError, std::vector<uint32_t>* collapseMap)
+{
+    std::vector<uint32_t>   result = indices;
+    const size_t    vertexCount = vertices.size();
+    std::vector<uint32_t>   finalVertex(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v)
+        finalVertex[v] = static_cast<uint32_t>(v);
+    if (resultError)
+        *resultError = 0.0f;
+    if (collapseMap)
+        *collapseMap = finalVertex;
+    if (result.size() <= targetIndexCount || vertexCount == 0)
+        return (result);
+
+    // 1. Mesh 크기로 정규화한 위치 (오차를 크기와 무관하게 비교하기 위해)
+    float       extent = GetExtent(vertices);
+    float       invExtent = extent > 0.0f ? 1.0f / extent : 1.0f;
+    glm::vec3   origin = vertices[0].position;
+    std::vector<glm::vec3>  positions(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v)
+        positions[v] = (vertices[v].position - origin) * invExtent;
+
+    // 2. 위치가 같은 Vertex는 하나로 묶는다. (remap[v] = 대표 Vertex)
+    std::vector<uint32_t>   order(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v)
+        order[v] = static_cast<uint32_t>(v);
+    auto    Less = [&vertices](uint32_t a, uint32_t b)
+    {
+        const glm::vec3&    pa = vertices[a].position;
+        const glm::vec3&    pb = vertices[b].position;
+        if (pa.x != pb.x) return (pa.x < pb.x);
+        if (pa.y != pb.y) return (pa.y < pb.y);
+        if (pa.z != pb.z) return (pa.z < pb.z);
+        return (a < b);
+    };
+    std::sort(order.begin(), order.end(), Less);
+    std::vector<uint32_t>   remap(vertexCount);
+    std::vector<uint32_t>   wedgeCount(vertexCount, 0);
+    for (size_t i = 0; i < vertexCount; ++i)
+    {
+        uint32_t    v = order[i];
+        bool        same = i > 0 && vertices[order[i - 1]].position == vertices[v].position;
+        remap[v] = same ? remap[order[i - 1]] : v;
+        ++wedgeCount[remap[v]];
+    }
+
+    // 3. 움직이면 안 되는 Vertex : Seam (속성이 여러 개) + 열린 경계 (반대 방향 Edge가 없음)
+    std::vector<uint8_t>    locked(vertexCount, 0);
+    for (size_t v = 0; v < vertexCount; ++v)
+        if (wedgeCount[remap[v]] > 1)
+            locked[remap[v]] = 1;
+    {
+        auto    EdgeKey = [](uint32_t a, uint32_t b) -> uint64_t
+        { return ((static_cast<uint64_t>(a) << 32) | b); };
+        std::unordered_map<uint64_t, uint32_t>  edges;
+        edges.reserve(result.size());
+        for (size_t i = 0; i < result.size(); i += 3)
+            for (int k = 0; k < 3; ++k)
+                ++edges[EdgeKey(remap[result[i + k]], remap[result[i + (k + 1) % 3]])];
+        for (auto& edge : edges)
+        {
+            uint32_t    a = static_cast<uint32_t>(edge.first >> 32);
+            uint32_t    b = static_cast<uint32_t>(edge.first & 0xFFFFFFFF);
+            if (edges.find(EdgeKey(b, a)) == edges.end())
+                locked[a] = locked[b] = 1;
+        }
+    }
+
+    // 4. 대표 Vertex마다 주변 삼각형 평면의 Quadric을 누적한다.
+    std::vector<Quadric>    quadrics(vertexCount);
+    for (size_t i = 0; i < result.size(); i += 3)
+    {
+        uint32_t    r0 = remap[result[i]], r1 = remap[result[i + 1]], r2 = remap[result[i + 2]];
+        glm::vec3   normal = glm::cross(positions[r1] - positions[r0], positions[r2] - positions[r0]);
+        float       length = glm::length(normal);
+        if (length == 0.0f)
+            continue ;
+        normal = normal / length;
+        float       d = -glm::dot(normal, positions[r0]);
+        quadrics[r0].AddPlane(normal, d, length * 0.5f);
+        quadrics[r1].AddPlane(normal, d, length * 0.5f);
+        quadrics[r2].AddPlane(normal, d, length * 0.5f);
+    }
+
+    struct Collapse {
+        uint32_t    from;
+        uint32_t    to;
+        double      cost;
+    };
+    std::vector<Collapse>   collapses;
+    std::vector<uint32_t>   collapseTarget(vertexCount);
+    std::vector<uint8_t>    busy(vertexCount);
+    std::vector<uint32_t>   triangleOffsets(vertexCount + 1);
+    std::vector<uint32_t>   triangleFill(vertexCount);
+    std::vector<uint32_t>   adjacency;
+    const double    errorLimit = static_cast<double>(targetError) * targetError;
+
+    // 5. Pass마다 비용이 낮은 Collapse부터, 서로 겹치지 않는 것들을 한 번에 적용한다.
+    while (result.size() > targetIndexCount)
+    {
+        // Vertex -> 삼각형 (움직일 수 있는 Vertex는 속성이 하나뿐이라 Index 그대로 찾는다.)
+        std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+        for (uint32_t v : result)
+            ++triangleOffsets[v + 1];
+        for (size_t v = 0; v < vertexCount; ++v)
+            triangleOffsets[v + 1] += triangleOffsets[v];
+        std::copy(triangleOffsets.begin(), triangleOffsets.end() - 1, triangleFill.begin());
+        adjacency.resize(result.size());
+        for (size_t i = 0; i < result.size(); ++i)
+            adjacency[triangleFill[result[i]]++] = static_cast<uint32_t>(i / 3);
+
+        collapses.clear();
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            for (int k = 0; k < 3; ++k)
+            {
+                uint32_t    a = result[i + k];
+                uint32_t    b = result[i + (k + 1) % 3];
+                for (int dir = 0; dir < 2; ++dir, std::swap(a, b))
+                {
+                    uint32_t    ra = remap[a], rb = remap[b];
+                    if (locked[ra] || ra == rb)
+                        continue ;
+                    Quadric q = quadrics[ra];
+                    q.Add(quadrics[rb]);
+                    // Normal이 다른 쪽으로 합칠수록 비용을 더한다. (Crease 보존)
+                    glm::vec3   edge = positions[rb] - positions[ra];
+                    double      normalPenalty = (1.0 - glm::dot(vertices[a].normal, vertices[b].normal))
+                                                * glm::dot(edge, edge);
+                    collapses.push_back({ a, b, q.Evaluate(positions[rb]) + normalPenalty });
+                }
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(),
+                [](const Collapse& x, const Collapse& y) { return (x.cost < y.cost); });
+
+        for (size_t v = 0; v < vertexCount; ++v)
+            collapseTarget[v] = static_cast<uint32_t>(v);
+        std::fill(busy.begin(), busy.end(), 0);
+        size_t  trianglesToRemove = (result.size() - targetIndexCount) / 3;
+        size_t  removed = 0;
+        bool    progress = false;
+
+        for (auto& collapse : collapses)
+        {
+            if (collapse.cost > errorLimit || removed >= trianglesToRemove)
+                break ;
+            uint32_t    ra = remap[collapse.from], rb = remap[collapse.to];
+            if (busy[ra] || busy[rb])
+                continue ;
+
+            // 주변 삼각형이 뒤집히거나 크게 꺾이면 건너뛴다.
+            bool        flips = false;
+            size_t      collapsing = 0;
+            const glm::vec3&    target = positions[rb];
+            for (uint32_t a = triangleOffsets[collapse.from]; a < triangleOffsets[collapse.from + 1]; ++a)
+            {
+                size_t      t = 3 * adjacency[a];
+                uint32_t    r[3] = { remap[result[t]], remap[result[t + 1]], remap[result[t + 2]] };
+                if (r[0] == rb || r[1] == rb || r[2] == rb)
+                {
+                    ++collapsing;
+                    continue ;
+                }
+                glm::vec3   p[3] = { positions[r[0]], positions[r[1]], positions[r[2]] };
+                glm::vec3   before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                for (int k = 0; k < 3; ++k)
+                    if (r[k] == ra)
+                        p[k] = target;
+                glm::vec3   after = glm::cross(p[1] - p[0], p[2] - p[0]);
+                float       lengths = glm::length(before) * glm::length(after);
+                if (lengths == 0.0f || glm::dot(before, after) < 0.25f * lengths)
+                {
+                    flips = true;
+                    break ;
+                }
+            }
+            if (flips)
+                continue ;
+
+            collapseTarget[collapse.from] = collapse.to;
+            quadrics[rb].Add(quadrics[ra]);
+            removed += collapsing;
+            progress = true;
+
+            // 같은 Pass에서 주변이 또 바뀌면 위의 검사가 무효가 되므로 1-ring 전체를 잠근다.
+            for (uint32_t a = triangleOffsets[collapse.from]; a < triangleOffsets[collapse.from + 1]; ++a)
+            {
+                size_t  t = 3 * adjacency[a];
+                busy[remap[result[t]]] = busy[remap[result[t + 1]]] = busy[remap[result[t + 2]]] = 1;
+            }
+        }
+        if (!progress)
+            break ;
+        for (size_t v = 0; v < vertexCount; ++v)
+            finalVertex[v] = collapseTarget[finalVertex[v]];
+
+        // Index를 갱신하고 퇴화된 삼각형을 버린다.
+        size_t  write = 0;
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            uint32_t    v0 = collapseTarget[result[i]];
+            uint32_t    v1 = collapseTarget[result[i + 1]];
+            uint32_t    v2 = collapseTarget[result[i + 2]];
+            if (remap[v0] == remap[v1] || remap[v1] == remap[v2] || remap[v0] == remap[v2])
+                continue ;
+            result[write++] = v0;
+            result[write++] = v1;
+            result[write++] = v2;
+        }
+        result.resize(write);
+    }
+
+    // Quadric 비용(면적 가중 거리 제곱 + Normal 항)은 정렬에만 쓰고, 오차는 실제 거리로 잰다.
+    if (resultError)
+        *resultError = MeasureDeviation(vertices, result, finalVertex) * invExtent;
+    if (collapseMap)
+        *collapseMap = std::move(finalVertex);
+    return (result);
+};
+
+// 한 Mesh의 LOD 사슬. Level 0이 원본이고 모든 Level이 같은 Vertex Buffer를 쓴다.
+CLASS_PTR(MeshLOD);
+class MeshLOD
+{
+public:
+    struct Level {
+        MeshSPtr    mesh;
+        float       error;  // 원본 Vertex가 이 Level 표면에서 떨어진 최대 거리 (Object Space)
+    };
+
+    static MeshLODUPtr  Create(std::vector<Level> levels);
+    static MeshLODUPtr  Create(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+                                uint32_t maxLevelCount = 4, VertexFormat format = VERTEX_FORMAT_FLOAT);
+    // Level 1 ~ 의 Index와 오차만 만든다. (Mesh Cache에 저장할 때 사용)
+    static std::vector<std::vector<uint32_t>>   BuildLevels(const std::vector<Vertex>& vertices,
+                                                            const std::vector<uint32_t>& indices,
+                                                            uint32_t maxLevelCount,
+                                                            std::vector<float>& errors);
+
+    size_t          GetLevelCount(void) const
+    { return (this->m_levels.size()); };
+    const Level&    GetLevel(size_t index) const
+    { return (this->m_levels[index]); };
+    const Mesh*     GetMesh(size_t index) const
+    { return (this->m_levels[index].mesh.get()); };
+    // 화면에 투영한 오차가 pixelThreshold 이하인 가장 거친 Level
+    // distance : Object Space 기준 카메라까지 거리 / projectionScale : 거리 1에서 1 unit의 pixel 수
+    uint32_t        SelectLevel(float distance, float projectionScale, float pixelThreshold = 1.0f) const;
+private:
+    std::vector<Level>  m_levels;
+
+    MeshLOD() {};
+};
+
+MeshLODUPtr MeshLOD::Create(std::vector<Level> levels)
+{
+    if (levels.empty() || !levels[0].mesh)
+        return (nullptr);
+    MeshLODUPtr lod = MeshLODUPtr(new MeshLOD());
+    lod->m_levels = std::move(levels);
+    return (std::move(lod));
+};
+
+MeshLODUPtr MeshLOD::Create(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+                            uint32_t maxLevelCount, VertexFormat format)
+{
+    std::vector<float>  errors;
+    auto    lodIndices = BuildLevels(vertices, indices, maxLevelCount, errors);
+
+    std::vector<Level>  levels;
+    MeshSPtr    base = Mesh::CreateFromData(vertices.data(), vertices.size(),
+                                            indices.data(), indices.size(), GL_TRIANGLES, format);
+    levels.push_back({ base, 0.0f });
+    for (size_t i = 0; i < lodIndices.size(); ++i)
+    {
+        MeshSPtr    mesh = Mesh::CreateWithVertexBuffer(base->GetVertexBuffer(), format,
+                                                        lodIndices[i], GL_TRIANGLES);
+        levels.push_back({ mesh, errors[i] });
+    }
+    return (Create(std::move(levels)));
+};
+
+std::vector<std::vector<uint32_t>>  MeshLOD::BuildLevels(const std::vector<Vertex>& vertices,
+                                                        const std::vector<uint32_t>& indices,
+                                                        uint32_t maxLevelCount,
+                                                        std::vector<float>& errors)
+{
+    // Level마다 삼각형을 절반으로 줄인다. 더 이상 10% 이상 줄지 않으면 멈춘다.
+    const float     REDUCTION = 0.5f;
+    const float     MAX_ERROR = 0.05f;
+    const size_t    MIN_INDEX_COUNT = 3 * 32;
+
+    std::vector<std::vector<uint32_t>>  levels;
+    errors.clear();
+    const std::vector<uint32_t>*    previous = &indices;
+    // 원본 Vertex -> 현재 Level에서 남은 Vertex
+    std::vector<uint32_t>   collapseMap(vertices.size());
+    for (size_t v = 0; v < vertices.size(); ++v)
+        collapseMap[v] = static_cast<uint32_t>(v);
+    std::vector<uint32_t>   levelMap;
+    for (uint32_t level = 1; level < maxLevelCount; ++level)
+    {
+        size_t  target = static_cast<size_t>(previous->size() / 3 * REDUCTION) * 3;
+        if (target < MIN_INDEX_COUNT)
+            break ;
+        auto    simplified = MeshSimplifier::Simplify(vertices, *previous, target, MAX_ERROR,
+                                                        nullptr, &levelMap);
+        if (simplified.size() > previous->size() * 9 / 10)
+            break ;
+
+        MeshOptimizer::OptimizeVertexCache(simplified, vertices.size());
+        // 이전 Level이 아니라 원본 Vertex에서 이 Level 표면까지의 거리로 잰다.
+        for (auto& target : collapseMap)
+            target = levelMap[target];
+        errors.push_back(MeshSimplifier::MeasureDeviation(vertices, simplified, collapseMap));
+        levels.push_back(std::move(simplified));
+        previous = &levels.back();
+    }
+    return (levels);
+};
+
+uint32_t    MeshLOD::SelectLevel(float distance, float projectionScale, float pixelThreshold) const
+{
+    distance = std::max(distance, 1e-4f);
+    uint32_t    selected = 0;
+    for (uint32_t i = 1; i < this->m_levels.size(); ++i)
+    {
+        if (this->m_levels[i].error * projectionScale / distance > pixelThreshold)
+            break ;
+        selected = i;
+    }
+    return (selected);
+};
+
+#endif
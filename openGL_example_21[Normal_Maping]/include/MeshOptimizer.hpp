@@ -0,0 +1,336 @@
+#ifndef MESHOPTIMIZER_HPP
+#define MESHOPTIMIZER_HPP
+
+#include "Common.hpp"
+
+// Index Buffer 최적화 (GL_TRIANGLES 전용)
+// 1. Vertex Cache : Tipsify (Sander et al. 2007) 로 Post-Transform Cache Hit를 높인다.
+// 2. Overdraw     : Cache가 끊기는 지점으로 Cluster를 나누고 바깥을 향하는 Cluster부터 그린다.
+// 3. Vertex Fetch : Index에 처음 등장하는 순서대로 Vertex Buffer를 다시 채운다.
+//
+// ACMR (Average Cache Miss Ratio)  = Cache Miss 수 / 삼각형 수   (최적 0.5, 최악 3.0)
+// ATVR (Average Transformed Vertex Ratio) = Cache Miss 수 / Vertex 수 (최적 1.0)
+class MeshOptimizer
+{
+public:
+    static const uint32_t   CACHE_SIZE = 16;
+
+    struct Stats {
+        float   acmrBefore { 0.0f };
+        float   acmrAfter { 0.0f };
+        float   atvrBefore { 0.0f };
+        float   atvrAfter { 0.0f };
+    };
+
+    static float    ComputeACMR(const std::vector<uint32_t>& indices, size_t vertexCount,
+                                uint32_t cacheSize = CACHE_SIZE);
+    static float    ComputeATVR(const std::vector<uint32_t>& indices, size_t vertexCount,
+                                uint32_t cacheSize = CACHE_SIZE);
+
+    static void     OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount,
+                                        uint32_t cacheSize = CACHE_SIZE);
+    // threshold : Cluster ACMR를 이 비율까지 나빠지는 것을 허용하고 더 잘게 나눈다.
+    static void     OptimizeOverdraw(std::vector<uint32_t>& indices, const uint8_t* positions,
+                                    size_t positionStride, size_t vertexCount,
+                                    float threshold = 1.05f, uint32_t cacheSize = CACHE_SIZE);
+    template <typename T>
+    static void     OptimizeVertexFetch(std::vector<T>& vertices, std::vector<uint32_t>& indices);
+
+    // 세 단계를 순서대로 적용하고 전/후 ACMR, ATVR을 돌려준다.
+    template <typename T>
+    static Stats    Optimize(std::vector<T>& vertices, std::vector<uint32_t>& indices,
+                            size_t positionOffset);
+    static void     PrintStats(const Stats& stats, size_t triangleCount);
+private:
+    static size_t   CountCacheMisses(const std::vector<uint32_t>& indices, size_t begin, size_t end,
+                                    std::vector<uint32_t>& cacheTime, uint32_t& timestamp,
+                                    uint32_t cacheSize);
+};
+
+size_t  MeshOptimizer::CountCacheMisses(const std::vector<uint32_t>& indices, size_t begin, size_t end,
+                                        std::vector<uint32_t>& cacheTime, uint32_t& timestamp,
+                                        uint32_t cacheSize)
+{
+    // FIFO Cache : Vertex가 마지막으로 들어온 시각이 cacheSize 이내면 Hit.
+    size_t  misses = 0;
+    for (size_t i = begin; i < end; ++i)
+    {
+        uint32_t    v = indices[i];
+        if (timestamp - cacheTime[v] > cacheSize)
+        {
+            cacheTime[v] = timestamp++;
+            ++misses;
+        }
+    }
+    return (misses);
+};
+
+float   MeshOptimizer::ComputeACMR(const std::vector<uint32_t>& indices, size_t vertexCount,
+                                    uint32_t cacheSize)
+{
+    if (indices.size() < 3)
+        return (0.0f);
+    std::vector<uint32_t>   cacheTime(vertexCount, 0);
+    uint32_t    timestamp = cacheSize + 1;
+    size_t      misses = CountCacheMisses(indices, 0, indices.size(), cacheTime, timestamp, cacheSize);
+    return (static_cast<float>(misses) / static_cast<float>(indices.size() / 3));
+};
+
+float   MeshOptimizer::ComputeATVR(const std::vector<uint32_t>& indices, size_t vertexCount,
+                                    uint32_t cacheSize)
+{
+    if (indices.empty() || vertexCount == 0)
+        return (0.0f);
+    std::vector<uint32_t>   cacheTime(vertexCount, 0);
+    uint32_t    timestamp = cacheSize + 1;
+    size_t      misses = CountCacheMisses(indices, 0, indices.size(), cacheTime, timestamp, cacheSize);
+
+    // Index에서 실제로 참조되는 Vertex만 센다.
+    std::vector<bool>   used(vertexCount, false);
+    size_t  usedCount = 0;
+    for (uint32_t v : indices)
+    {
+        if (!used[v])
+        {
+            used[v] = true;
+            ++usedCount;
+        }
+    }
+    return (static_cast<float>(misses) / static_cast<float>(usedCount));
+};
+
+void    MeshOptimizer::OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount,
+                                            uint32_t cacheSize)
+{
+    size_t  triangleCount = indices.size() / 3;
+    if (triangleCount == 0 || vertexCount == 0)
+        return ;
+
+    // Vertex -> 인접 삼각형 목록 (CSR)
+    std::vector<uint32_t>   live(vertexCount, 0);
+    for (uint32_t v : indices)
+        ++live[v];
+    std::vector<uint32_t>   offsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v)
+        offsets[v + 1] = offsets[v] + live[v];
+    std::vector<uint32_t>   adjacency(indices.size());
+    std::vector<uint32_t>   fill(offsets.begin(), offsets.end() - 1);
+    for (size_t t = 0; t < triangleCount; ++t)
+        for (int k = 0; k < 3; ++k)
+            adjacency[fill[indices[3 * t + k]]++] = static_cast<uint32_t>(t);
+
+    std::vector<uint32_t>   cacheTime(vertexCount, 0);
+    std::vector<bool>       emitted(triangleCount, false);
+    std::vector<uint32_t>   deadEnd;
+    std::vector<uint32_t>   candidates;
+    std::vector<uint32_t>   result;
+    result.reserve(indices.size());
+
+    uint32_t    timestamp = cacheSize + 1;
+    uint32_t    cursor = 1;
+    int64_t     fanning = 0;
+
+    auto    SkipDeadEnd = [&]() -> int64_t
+    {
+        // 최근에 쓴 Vertex 중 아직 삼각형이 남은 것 -> 없으면 입력 순서대로 찾는다.
+        while (!deadEnd.empty())
+        {
+            uint32_t    v = deadEnd.back();
+            deadEnd.pop_back();
+            if (live[v] > 0)
+                return (v);
+        }
+        while (cursor < vertexCount)
+        {
+            if (live[cursor] > 0)
+                return (cursor++);
+            ++cursor;
+        }
+        return (-1);
+    };
+
+    while (fanning >= 0)
+    {
+        candidates.clear();
+        uint32_t    f = static_cast<uint32_t>(fanning);
+        for (uint32_t a = offsets[f]; a < offsets[f + 1]; ++a)
+        {
+            uint32_t    t = adjacency[a];
+            if (emitted[t])
+                continue ;
+            for (int k = 0; k < 3; ++k)
+            {
+                uint32_t    v = indices[3 * t + k];
+                result.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                --live[v];
+                if (timestamp - cacheTime[v] > cacheSize)
+                    cacheTime[v] = timestamp++;
+            }
+            emitted[t] = true;
+        }
+
+        // 남은 삼각형을 그려도 Cache에서 밀려나지 않을 Vertex 중 가장 오래된 것을 고른다.
+        int64_t     best = -1;
+        int64_t     bestPriority = -1;
+        for (uint32_t v : candidates)
+        {
+            if (live[v] == 0)
+                continue ;
+            int64_t priority = 0;
+            if (timestamp - cacheTime[v] + 2 * live[v] <= cacheSize)
+                priority = timestamp - cacheTime[v];
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                best = v;
+            }
+        }
+        fanning = (best >= 0) ? best : SkipDeadEnd();
+    }
+    indices.swap(result);
+};
+
+void    MeshOptimizer::OptimizeOverdraw(std::vector<uint32_t>& indices, const uint8_t* positions,
+                                        size_t positionStride, size_t vertexCount,
+                                        float threshold, uint32_t cacheSize)
+{
+    size_t  triangleCount = indices.size() / 3;
+    if (triangleCount < 2)
+        return ;
+
+    auto    Position = [&](uint32_t v) -> glm::vec3
+    {
+        const float*    p = reinterpret_cast<const float*>(positions + v * positionStride);
+        return (glm::vec3(p[0], p[1], p[2]));
+    };
+
+    // Hard Boundary : 세 Vertex가 모두 Cache Miss -> Tipsify가 다른 곳으로 건너뛴 지점
+    std::vector<size_t>     hard;
+    std::vector<uint32_t>   cacheTime(vertexCount, 0);
+    uint32_t    timestamp = cacheSize + 1;
+    for (size_t t = 0; t < triangleCount; ++t)
+        if (t == 0 || CountCacheMisses(indices, 3 * t, 3 * t + 3, cacheTime, timestamp, cacheSize) == 3)
+            hard.push_back(t);
+    hard.push_back(triangleCount);
+
+    // Soft Boundary : Cluster 안에서 누적 ACMR이 threshold 이내로 유지되는 곳마다 더 나눈다.
+    std::vector<size_t>     clusters;
+    for (size_t c = 0; c + 1 < hard.size(); ++c)
+    {
+        size_t  begin = hard[c], end = hard[c + 1];
+        std::fill(cacheTime.begin(), cacheTime.end(), 0);
+        timestamp = cacheSize + 1;
+        float   clusterACMR = static_cast<float>(CountCacheMisses(indices, 3 * begin, 3 * end,
+                                                cacheTime, timestamp, cacheSize)) / (end - begin);
+
+        clusters.push_back(begin);
+        std::fill(cacheTime.begin(), cacheTime.end(), 0);
+        timestamp = cacheSize + 1;
+        size_t  misses = 0, faces = 0;
+        for (size_t t = begin; t < end; ++t)
+        {
+            misses += CountCacheMisses(indices, 3 * t, 3 * t + 3, cacheTime, timestamp, cacheSize);
+            ++faces;
+            if (t + 1 < end && static_cast<float>(misses) / faces <= clusterACMR * threshold)
+            {
+                clusters.push_back(t + 1);
+                std::fill(cacheTime.begin(), cacheTime.end(), 0);
+                timestamp = cacheSize + 1;
+                misses = faces = 0;
+            }
+        }
+    }
+    clusters.push_back(triangleCount);
+
+    // Mesh 중심 기준으로 바깥을 향하는 Cluster일수록 먼저 그린다. (View 독립적인 근사)
+    glm::vec3   meshCenter(0.0f);
+    float       meshArea = 0.0f;
+    std::vector<glm::vec3>  clusterCenter(clusters.size() - 1, glm::vec3(0.0f));
+    std::vector<glm::vec3>  clusterNormal(clusters.size() - 1, glm::vec3(0.0f));
+    std::vector<float>      clusterArea(clusters.size() - 1, 0.0f);
+    for (size_t c = 0; c + 1 < clusters.size(); ++c)
+    {
+        for (size_t t = clusters[c]; t < clusters[c + 1]; ++t)
+        {
+            glm::vec3   p0 = Position(indices[3 * t]);
+            glm::vec3   p1 = Position(indices[3 * t + 1]);
+            glm::vec3   p2 = Position(indices[3 * t + 2]);
+            glm::vec3   normal = glm::cross(p1 - p0, p2 - p0);
+            float       area = glm::length(normal);
+            clusterCenter[c] += (p0 + p1 + p2) * (area / 3.0f);
+            clusterNormal[c] += normal;
+            clusterArea[c] += area;
+        }
+        meshCenter += clusterCenter[c];
+        meshArea += clusterArea[c];
+    }
+    if (meshArea > 0.0f)
+        meshCenter /= meshArea;
+
+    std::vector<float>      sortKey(clusters.size() - 1, 0.0f);
+    std::vector<uint32_t>   order(clusters.size() - 1);
+    for (size_t c = 0; c < order.size(); ++c)
+    {
+        order[c] = static_cast<uint32_t>(c);
+        float   normalLength = glm::length(clusterNormal[c]);
+        if (clusterArea[c] > 0.0f && normalLength > 0.0f)
+            sortKey[c] = glm::dot(clusterCenter[c] / clusterArea[c] - meshCenter, clusterNormal[c] / normalLength);
+    }
+    std::stable_sort(order.begin(), order.end(),
+                    [&sortKey](uint32_t a, uint32_t b) { return (sortKey[a] > sortKey[b]); });
+
+    std::vector<uint32_t>   result;
+    result.reserve(indices.size());
+    for (uint32_t c : order)
+        result.insert(result.end(), indices.begin() + 3 * clusters[c], indices.begin() + 3 * clusters[c + 1]);
+    indices.swap(result);
+};
+
+template <typename T>
+void    MeshOptimizer::OptimizeVertexFetch(std::vector<T>& vertices, std::vector<uint32_t>& indices)
+{
+    // Index에 처음 등장한 순서대로 번호를 다시 매긴다. 참조되지 않는 Vertex는 버린다.
+    const uint32_t          UNUSED = 0xFFFFFFFF;
+    std::vector<uint32_t>   remap(vertices.size(), UNUSED);
+    std::vector<T>          result;
+    result.reserve(vertices.size());
+    for (auto& index : indices)
+    {
+        if (remap[index] == UNUSED)
+        {
+            remap[index] = static_cast<uint32_t>(result.size());
+            result.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices.swap(result);
+};
+
+template <typename T>
+MeshOptimizer::Stats    MeshOptimizer::Optimize(std::vector<T>& vertices, std::vector<uint32_t>& indices,
+                                                size_t positionOffset)
+{
+    Stats   stats;
+    stats.acmrBefore = ComputeACMR(indices, vertices.size());
+    stats.atvrBefore = ComputeATVR(indices, vertices.size());
+
+    OptimizeVertexCache(indices, vertices.size());
+    OptimizeOverdraw(indices, reinterpret_cast<const uint8_t*>(vertices.data()) + positionOffset,
+                    sizeof(T), vertices.size());
+    OptimizeVertexFetch(vertices, indices);
+
+    stats.acmrAfter = ComputeACMR(indices, vertices.size());
+    stats.atvrAfter = ComputeATVR(indices, vertices.size());
+    return (stats);
+};
+
+void    MeshOptimizer::PrintStats(const Stats& stats, size_t triangleCount)
+{
+    std::cout << "Mesh optimized (" << triangleCount << " tris): ACMR "
+            << stats.acmrBefore << " -> " << stats.acmrAfter << ", ATVR "
+            << stats.atvrBefore << " -> " << stats.atvrAfter << std::endl;
+};
+
+#endif
@@ -0,0 +1,303 @@
+#ifndef MIPGENERATOR_HPP
+#define MIPGENERATOR_HPP
+
+#include "Common.hpp"
+#include "ThreadPool.hpp"
+
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# include <emmintrin.h>
+# define MIP_GENERATOR_SSE2
+#endif
+// AVX2 Kernel은 -mavx2 (/arch:AVX2)로 빌드했을 때만 쓴다.
+#if defined(__AVX2__)
+# include <immintrin.h>
+# define MIP_GENERATOR_AVX2
+#endif
+
+// 다음 Mip Level을 만들 때 값을 해석하는 방식
+enum MipFilter : uint32_t {
+    MIP_FILTER_BOX = 0,     // 8bit 값을 그대로 평균 (Linear Data, Mask 등)
+    MIP_FILTER_SRGB,        // 색(RGB)은 sRGB -> Linear로 풀어서 평균한 뒤 다시 sRGB로 (Alpha는 Linear)
+    MIP_FILTER_NORMAL_MAP,  // [-1, 1] Vector로 평균한 뒤 다시 정규화 (2 Channel이면 Z를 복원해서 계산)
+};
+
+// 2x2 Box Downsample Kernel.
+// 한 행을 Pixel마다 float 4개(RGBA)로 펼친 뒤 두 행 / 두 열을 SIMD로 더한다.
+// 홀수 크기의 마지막 행 / 열은 버리고, 크기가 1인 축은 같은 Pixel을 다시 쓴다. (Image::CreateDownsampled와 같음)
+class MipGenerator
+{
+public:
+    static const char*  GetName(MipFilter filter);
+    // src(width x height x channelCount) -> dst(max(1, width / 2) x max(1, height / 2) x channelCount)
+    // 큰 Level은 ThreadPool로 행을 나눠서 처리한다.
+    static void     Downsample(const uint8_t* src, int width, int height, int channelCount,
+                                MipFilter filter, uint8_t* dst);
+
+    // RGBA Pixel 중 alpha * scale이 cutoff(0 ~ 1)를 넘는 비율
+    static float    ComputeAlphaCoverage(const uint8_t* pixels, size_t pixelCount, float cutoff, float scale = 1.0f);
+    // Alpha Test 통과 비율이 coverage와 같아지도록 Alpha에 곱할 값을 찾아 적용한다.
+    // (Mip이 작아질수록 잎 같은 Alpha Test 물체가 얇아지거나 사라지는 것을 막는다.)
+    static void     ScaleAlphaToCoverage(uint8_t* pixels, size_t pixelCount, float cutoff, float coverage);
+private:
+    static const size_t SRGB_TABLE_SIZE = 16384;
+
+    static const float*     GetDecodeTable(MipFilter filter, bool color);
+    static const uint8_t*   GetLinearToSrgbTable(void);
+    static void     DecodeRow(const uint8_t* src, int width, int channelCount, MipFilter filter, float* dst);
+    static void     AverageRows(const float* row0, const float* row1, int width, float* dst);
+    static void     NormalizeRow(float* row, int width);
+    static void     EncodeRow(const float* src, int width, int channelCount, MipFilter filter, uint8_t* dst);
+};
+
+const char* MipGenerator::GetName(MipFilter filter)
+{
+    switch (filter)
+    {
+    case MIP_FILTER_SRGB: return ("srgb");
+    case MIP_FILTER_NORMAL_MAP: return ("normal");
+    default: return ("box");
+    }
+};
+
+const float*    MipGenerator::GetDecodeTable(MipFilter filter, bool color)
+{
+    static const auto   tables = []()
+    {
+        std::vector<float>  table(256 * 3);
+        for (int i = 0; i < 256; ++i)
+        {
+            float   value = i / 255.0f;
+            table[i] = value;
+            table[256 + i] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+            table[512 + i] = value * 2.0f - 1.0f;
+        }
+        return (table);
+    }();
+    if (!color || filter == MIP_FILTER_BOX)
+        return (tables.data());
+    return (tables.data() + (filter == MIP_FILTER_SRGB ? 256 : 512));
+};
+
+const uint8_t*  MipGenerator::GetLinearToSrgbTable(void)
+{
+    // Linear [0, 1]을 SRGB_TABLE_SIZE 단계로 나눈 표. 어두운 쪽 기울기가 커서 단계를 넉넉히 잡는다.
+    static const auto   table = []()
+    {
+        std::vector<uint8_t>    table(SRGB_TABLE_SIZE);
+        for (size_t i = 0; i < SRGB_TABLE_SIZE; ++i)
+        {
+            float   value = static_cast<float>(i) / (SRGB_TABLE_SIZE - 1);
+            float   srgb = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+            table[i] = static_cast<uint8_t>(glm::clamp(srgb * 255.0f + 0.5f, 0.0f, 255.0f));
+        }
+        return (table);
+    }();
+    return (table.data());
+};
+
+void    MipGenerator::DecodeRow(const uint8_t* src, int width, int channelCount, MipFilter filter, float* dst)
+{
+    const float*    color = GetDecodeTable(filter, true);
+    const float*    linear = GetDecodeTable(filter, false);
+    for (int x = 0; x < width; ++x, src += channelCount, dst += 4)
+    {
+        dst[0] = color[src[0]];
+        dst[1] = channelCount > 1 ? color[src[1]] : 0.0f;
+        dst[2] = channelCount > 2 ? color[src[2]] : 0.0f;
+        dst[3] = channelCount > 3 ? linear[src[3]] : 0.0f;
+        // RG Normal Map은 Z를 복원해야 정규화 결과가 맞다.
+        if (filter == MIP_FILTER_NORMAL_MAP && channelCount == 2)
+            dst[2] = std::sqrt(std::max(1.0f - dst[0] * dst[0] - dst[1] * dst[1], 0.0f));
+    }
+};
+
+void    MipGenerator::AverageRows(const float* row0, const float* row1, int width, float* dst)
+{
+    int dstWidth = std::max(1, width / 2);
+    int x = 0;
+    if (width == 1)
+    {
+        for (int c = 0; c < 4; ++c)
+            dst[c] = (row0[c] + row1[c]) * 0.5f;
+        return ;
+    }
+#ifdef MIP_GENERATOR_AVX2
+    // 두 행을 더한 [p0, p1], [p2, p3]에서 128bit 반쪽끼리 섞어 [p0, p2] + [p1, p3]
+    const __m256    quarter8 = _mm256_set1_ps(0.25f);
+    for (; x + 2 <= dstWidth; x += 2)
+    {
+        __m256  a = _mm256_add_ps(_mm256_loadu_ps(row0 + x * 8), _mm256_loadu_ps(row1 + x * 8));
+        __m256  b = _mm256_add_ps(_mm256_loadu_ps(row0 + x * 8 + 8), _mm256_loadu_ps(row1 + x * 8 + 8));
+        __m256  sum = _mm256_add_ps(_mm256_permute2f128_ps(a, b, 0x20), _mm256_permute2f128_ps(a, b, 0x31));
+        _mm256_storeu_ps(dst + x * 4, _mm256_mul_ps(sum, quarter8));
+    }
+#endif
+#ifdef MIP_GENERATOR_SSE2
+    const __m128    quarter = _mm_set1_ps(0.25f);
+    for (; x < dstWidth; ++x)
+    {
+        __m128  left = _mm_add_ps(_mm_loadu_ps(row0 + x * 8), _mm_loadu_ps(row1 + x * 8));
+        __m128  right = _mm_add_ps(_mm_loadu_ps(row0 + x * 8 + 4), _mm_loadu_ps(row1 + x * 8 + 4));
+        _mm_storeu_ps(dst + x * 4, _mm_mul_ps(_mm_add_ps(left, right), quarter));
+    }
+#else
+    for (; x < dstWidth; ++x)
+    {
+        for (int c = 0; c < 4; ++c)
+            dst[x * 4 + c] = (row0[x * 8 + c] + row0[x * 8 + 4 + c] + row1[x * 8 + c] + row1[x * 8 + 4 + c]) * 0.25f;
+    }
+#endif
+};
+
+void    MipGenerator::NormalizeRow(float* row, int width)
+{
+    int x = 0;
+#ifdef MIP_GENERATOR_SSE2
+    // 한 Pixel(xyzw)이 __m128 하나. 길이는 xyz로만 계산하고 w(Alpha)는 그대로 둔다.
+    const __m128    xyzMask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+    const __m128    epsilon = _mm_set1_ps(1e-12f);
+    const __m128    up = _mm_setr_ps(0.0f, 0.0f, 1.0f, 0.0f);
+    for (; x < width; ++x)
+    {
+        __m128  v = _mm_loadu_ps(row + x * 4);
+        __m128  xyz = _mm_and_ps(v, xyzMask);
+        __m128  squared = _mm_mul_ps(xyz, xyz);
+        __m128  sum = _mm_add_ps(squared, _mm_shuffle_ps(squared, squared, _MM_SHUFFLE(2, 3, 0, 1)));
+        sum = _mm_add_ps(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 0, 3, 2)));
+        // 서로 반대 방향이 평균되어 길이가 0이면 (0, 0, 1)
+        __m128  degenerate = _mm_cmplt_ps(sum, epsilon);
+        __m128  normalized = _mm_div_ps(xyz, _mm_sqrt_ps(_mm_max_ps(sum, epsilon)));
+        normalized = _mm_or_ps(_mm_and_ps(degenerate, up), _mm_andnot_ps(degenerate, normalized));
+        _mm_storeu_ps(row + x * 4, _mm_or_ps(normalized, _mm_andnot_ps(xyzMask, v)));
+    }
+#endif
+    for (; x < width; ++x)
+    {
+        float*  v = row + x * 4;
+        float   length2 = v[0] * v[0] + v[1] * v[1] + v[2] * v[2];
+        if (length2 < 1e-12f)
+        {
+            v[0] = v[1] = 0.0f;
+            v[2] = 1.0f;
+            continue;
+        }
+        float   inverse = 1.0f / std::sqrt(length2);
+        for (int c = 0; c < 3; ++c)
+            v[c] *= inverse;
+    }
+};
+
+void    MipGenerator::EncodeRow(const float* src, int width, int channelCount, MipFilter filter, uint8_t* dst)
+{
+    int x = 0;
+    if (filter == MIP_FILTER_SRGB)
+    {
+        const uint8_t*  table = GetLinearToSrgbTable();
+        for (; x < width; ++x, src += 4, dst += channelCount)
+        {
+            for (int c = 0; c < std::min(channelCount, 3); ++c)
+                dst[c] = table[static_cast<size_t>(glm::clamp(src[c], 0.0f, 1.0f) * (SRGB_TABLE_SIZE - 1) + 0.5f)];
+            if (channelCount > 3)
+                dst[3] = static_cast<uint8_t>(glm::clamp(src[3], 0.0f, 1.0f) * 255.0f + 0.5f);
+        }
+        return ;
+    }
+
+    // Normal은 [-1, 1] -> [0, 1]로 되돌린 뒤 나머지는 Linear와 같다.
+    float   scale = filter == MIP_FILTER_NORMAL_MAP ? 0.5f : 1.0f;
+    float   bias = filter == MIP_FILTER_NORMAL_MAP ? 0.5f : 0.0f;
+#ifdef MIP_GENERATOR_SSE2
+    if (channelCount == 4)
+    {
+        // RGB와 Alpha의 변환이 다르므로 Lane마다 다른 값을 쓴다.
+        const __m128    laneScale = _mm_setr_ps(scale * 255.0f, scale * 255.0f, scale * 255.0f, 255.0f);
+        const __m128    laneBias = _mm_setr_ps(bias * 255.0f, bias * 255.0f, bias * 255.0f, 0.0f);
+        for (; x + 4 <= width; x += 4)
+        {
+            __m128i p0 = _mm_cvtps_epi32(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(src + x * 4), laneScale), laneBias));
+            __m128i p1 = _mm_cvtps_epi32(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(src + x * 4 + 4), laneScale), laneBias));
+            __m128i p2 = _mm_cvtps_epi32(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(src + x * 4 + 8), laneScale), laneBias));
+            __m128i p3 = _mm_cvtps_epi32(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(src + x * 4 + 12), laneScale), laneBias));
+            // packs / packus가 0 ~ 255로 잘라 준다.
+            __m128i packed = _mm_packus_epi16(_mm_packs_epi32(p0, p1), _mm_packs_epi32(p2, p3));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), packed);
+        }
+    }
+#endif
+    for (src += x * 4, dst += x * channelCount; x < width; ++x, src += 4, dst += channelCount)
+    {
+        for (int c = 0; c < channelCount; ++c)
+        {
+            float   value = c < 3 ? src[c] * scale + bias : src[c];
+            dst[c] = static_cast<uint8_t>(glm::clamp(value * 255.0f + 0.5f, 0.0f, 255.0f));
+        }
+    }
+};
+
+void    MipGenerator::Downsample(const uint8_t* src, int width, int height, int channelCount,
+                                MipFilter filter, uint8_t* dst)
+{
+    int     dstWidth = std::max(1, width / 2);
+    int     dstHeight = std::max(1, height / 2);
+    auto    downsampleRows = [&](uint32_t, size_t begin, size_t end)
+    {
+        std::vector<float>  rows(static_cast<size_t>(width) * 4 * 2 + static_cast<size_t>(dstWidth) * 4);
+        float*  row0 = rows.data();
+        float*  row1 = row0 + width * 4;
+        float*  result = row1 + width * 4;
+        for (size_t y = begin; y < end; ++y)
+        {
+            int y0 = std::min(static_cast<int>(y) * 2, height - 1);
+            int y1 = std::min(static_cast<int>(y) * 2 + 1, height - 1);
+            DecodeRow(src + static_cast<size_t>(y0) * width * channelCount, width, channelCount, filter, row0);
+            DecodeRow(src + static_cast<size_t>(y1) * width * channelCount, width, channelCount, filter, row1);
+            AverageRows(row0, row1, width, result);
+            if (filter == MIP_FILTER_NORMAL_MAP)
+                NormalizeRow(result, dstWidth);
+            EncodeRow(result, dstWidth, channelCount, filter, dst + y * dstWidth * channelCount);
+        }
+    };
+    // 작은 Level은 나눠 봐야 Submit 비용이 더 크다.
+    if (static_cast<size_t>(dstWidth) * dstHeight >= 64 * 64)
+        ThreadPool::Get().ParallelFor(dstHeight, 16, downsampleRows);
+    else
+        downsampleRows(0, 0, dstHeight);
+};
+
+float   MipGenerator::ComputeAlphaCoverage(const uint8_t* pixels, size_t pixelCount, float cutoff, float scale)
+{
+    if (pixelCount == 0)
+        return (0.0f);
+    // alpha * scale > cutoff * 255  <=>  alpha > threshold
+    float   threshold = cutoff * 255.0f / std::max(scale, 1e-6f);
+    size_t  passed = 0;
+    for (size_t i = 0; i < pixelCount; ++i)
+    {
+        if (pixels[i * 4 + 3] > threshold)
+            ++passed;
+    }
+    return (static_cast<float>(passed) / pixelCount);
+};
+
+void    MipGenerator::ScaleAlphaToCoverage(uint8_t* pixels, size_t pixelCount, float cutoff, float coverage)
+{
+    // Coverage는 scale에 대해 단조 증가하므로 이분 탐색
+    float   low = 0.0f, high = 4.0f, scale = 1.0f;
+    for (int iter = 0; iter < 12; ++iter)
+    {
+        float   current = ComputeAlphaCoverage(pixels, pixelCount, cutoff, scale);
+        if (std::fabs(current - coverage) < 0.001f)
+            break;
+        if (current < coverage)
+            low = scale;
+        else
+            high = scale;
+        scale = (low + high) * 0.5f;
+    }
+    for (size_t i = 0; i < pixelCount; ++i)
+        pixels[i * 4 + 3] = static_cast<uint8_t>(std::min(pixels[i * 4 + 3] * scale + 0.5f, 255.0f));
+};
+
+#endif
@@ -3,6 +3,10 @@
 
 #include "Common.hpp"
 #include "Mesh.hpp"
+#include "MeshCache.hpp"
+#include "MeshLOD.hpp"
+#include "RenderQueue.hpp"
+#include "SceneGraph.hpp"
 
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
@@ -12,35 +16,176 @@ CLASS_PTR(Model);
 class Model
 {
 public:
-    static  ModelUPtr   Load(const std::string& filename);
+    // optimize : Mesh마다 MeshOptimizer를 적용한다. (결과는 Mesh Cache에 그대로 저장된다.)
+    // format   : VERTEX_FORMAT_PACKED는 common/vertex_input.glsl을 쓰는 Program(PACKED_VERTEX Define)으로만 그린다.
+    // lodLevelCount : 1보다 크면 Mesh마다 LOD 사슬을 만든다. (Mesh Cache에 같이 저장된다.)
+    static  ModelUPtr   Load(const std::string& filename, bool optimize = false,
+                            VertexFormat format = VERTEX_FORMAT_FLOAT, uint32_t lodLevelCount = 1);
 
     int     GetMeshCount(void) const
     { return (static_cast<int>(this->m_meshes.size())); };
     MeshSPtr    GetMesh(int index) const
     { return (m_meshes[index]) ;};
-    void        Draw(const Program* program) const;
+    // LOD를 만들지 않았으면 nullptr
+    const MeshLOD*  GetMeshLOD(int index) const
+    { return (this->m_lods.empty() ? nullptr : this->m_lods[index].get()); };
+    VertexFormat    GetVertexFormat(void) const
+    { return (this->m_vertexFormat); };
+    // Node의 Local 행렬을 바꾸면 다음 Draw / Submit에서 바뀐 Node 아래만 다시 계산된다.
+    SceneGraph*     GetSceneGraph(void) const
+    { return (this->m_scene.get()); };
+
+    // Mesh마다 modelTransform * (Node의 World 행렬)로 transform / modelTransform Uniform을 설정한다.
+    void        Draw(const Program* program, const glm::mat4& viewProjection,
+                    const glm::mat4& modelTransform = glm::mat4(1.0f)) const;
+    // LOD가 있으면 RenderQueue가 화면 오차로 Level을 고른다.
+    // packedProgram : VERTEX_FORMAT_PACKED Mesh에 쓸 Program (nullptr면 program. 위치만 읽는 Shader는 둘 다 된다.)
+    void        Submit(RenderQueue* queue, RenderPass pass, const Program* program,
+                        const glm::mat4& modelTransform, const Program* packedProgram = nullptr) const;
 private:
+    // Node가 참조하는 Mesh. Node 순서대로 저장된다.
+    struct MeshInstance {
+        uint32_t    node;
+        uint32_t    mesh;
+    };
+
     std::vector<MeshSPtr>       m_meshes;
+    std::vector<MeshLODSPtr>    m_lods;
+    SceneGraphUPtr              m_scene;
+    std::vector<MeshInstance>   m_instances;
     std::vector<MaterialSPtr>   m_materials;
+    bool                        m_optimize { false };
+    VertexFormat                m_vertexFormat { VERTEX_FORMAT_FLOAT };
+    uint32_t                    m_lodLevelCount { 1 };
 
     Model() {};
+    uint32_t    GetCacheFlags(void) const
+    { return ((this->m_optimize ? MESH_CACHE_OPTIMIZED : 0)
+            | (this->m_vertexFormat == VERTEX_FORMAT_PACKED ? MESH_CACHE_PACKED_VERTEX : 0)
+            | (this->m_lodLevelCount > 1 ? this->m_lodLevelCount << MESH_CACHE_LOD_SHIFT : 0)); };
+    bool    LoadFromCache(const std::string& filename);
     bool    LoadByAssimp(const std::string& filename);
-    void    ProcessNode(aiNode* node, const aiScene* scene);
-    void    ProcessMesh(aiMesh* mesh, const aiScene* scene);
+    void    ProcessNode(aiNode* node, uint32_t parent, MeshCacheData& data);
+    void    ProcessMesh(aiMesh* mesh, MeshCacheData& data);
+    void    AddMesh(MeshSPtr mesh, std::vector<MeshLOD::Level> levels);
+    void    CreateMaterial(const std::string& dirname,
+                        const std::string& diffusePath, const std::string& specularPath);
 };
 
-ModelUPtr   Model::Load(const std::string& filename)
+ModelUPtr   Model::Load(const std::string& filename, bool optimize, VertexFormat format,
+                        uint32_t lodLevelCount)
 {
+    auto        start = std::chrono::steady_clock::now();
     ModelUPtr   model = ModelUPtr(new Model());
-    if (!model->LoadByAssimp(filename))
+    model->m_optimize = optimize;
+    model->m_vertexFormat = format;
+    model->m_lodLevelCount = std::max<uint32_t>(1, lodLevelCount);
+    model->m_scene = SceneGraph::Create();
+    bool        cached = model->LoadFromCache(filename);
+    if (!cached && !model->LoadByAssimp(filename))
         return (nullptr);
+
+    double  elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Model loaded " << (cached ? "from mesh cache" : "by assimp") << ": "
+            << filename << " (" << elapsed << " ms)" << std::endl;
     return (std::move(model));
 };
 
-void    Model::Draw(const Program* program) const
+void    Model::Draw(const Program* program, const glm::mat4& viewProjection,
+                    const glm::mat4& modelTransform) const
 {
-    for (auto& mesh : this->m_meshes)
-        mesh->Draw(program);
+    this->m_scene->Update();
+    UniformId   transformId = program->GetTransformId();
+    UniformId   modelTransformId = program->GetModelTransformId();
+    for (auto& instance : this->m_instances)
+    {
+        glm::mat4   world = modelTransform * this->m_scene->GetWorldTransform(instance.node);
+        program->SetUniform(transformId, viewProjection * world);
+        program->SetUniform(modelTransformId, world);
+        this->m_meshes[instance.mesh]->Draw(program);
+    }
+};
+
+void    Model::Submit(RenderQueue* queue, RenderPass pass, const Program* program,
+                    const glm::mat4& modelTransform, const Program* packedProgram) const
+{
+    this->m_scene->Update();
+    for (auto& instance : this->m_instances)
+    {
+        glm::mat4   world = modelTransform * this->m_scene->GetWorldTransform(instance.node);
+        auto&       mesh = this->m_meshes[instance.mesh];
+        // LOD Level은 원본 Mesh와 Vertex Buffer(Format)를 공유한다.
+        const Program*  meshProgram = (packedProgram && mesh->GetVertexFormat() == VERTEX_FORMAT_PACKED)
+                                    ? packedProgram : program;
+        if (!this->m_lods.empty())
+            queue->Submit(pass, this->m_lods[instance.mesh].get(), nullptr, meshProgram, world);
+        else
+            queue->Submit(pass, mesh.get(), mesh->GetMaterial().get(), meshProgram, world);
+    }
+};
+
+void    Model::AddMesh(MeshSPtr mesh, std::vector<MeshLOD::Level> levels)
+{
+    if (this->m_lodLevelCount > 1)
+    {
+        // LOD Level은 Vertex Buffer / Material / Bounds를 원본 Mesh와 공유한다.
+        for (auto& level : levels)
+        {
+            level.mesh->SetBounds(mesh->GetBoundsMin(), mesh->GetBoundsMax());
+            level.mesh->SetMaterial(mesh->GetMaterial());
+        }
+        levels.insert(levels.begin(), { mesh, 0.0f });
+        this->m_lods.push_back(MeshLOD::Create(std::move(levels)));
+    }
+    this->m_meshes.push_back(std::move(mesh));
+};
+
+bool    Model::LoadFromCache(const std::string& filename)
+{
+    MeshCacheUPtr   cache = MeshCache::Open(filename, GetCacheFlags());
+    if (!cache)
+        return (false);
+
+    auto    dirname = filename.substr(0, filename.find_last_of("/\\"));
+    for (uint32_t i = 0; i < cache->GetMaterialCount(); ++i)
+        CreateMaterial(dirname, cache->GetDiffusePath(i), cache->GetSpecularPath(i));
+
+    // mmap 된 Blob을 그대로 넘긴다. GPU로 복사가 끝나면 Cache는 닫아도 된다.
+    for (uint32_t i = 0; i < cache->GetMeshCount(); ++i)
+    {
+        auto&       record = cache->GetMesh(i);
+        MeshSPtr    glMesh = Mesh::CreateFromData(cache->GetVertices(i), record.vertexCount,
+                                                cache->GetVertexFormat(),
+                                                cache->GetIndices(i), record.indexCount,
+                                                record.indexType, GL_TRIANGLES);
+        glMesh->SetBounds(glm::vec3(record.boundsMin[0], record.boundsMin[1], record.boundsMin[2]),
+                        glm::vec3(record.boundsMax[0], record.boundsMax[1], record.boundsMax[2]));
+        if (record.materialIndex >= 0)
+            glMesh->SetMaterial(m_materials[record.materialIndex]);
+
+        std::vector<MeshLOD::Level> levels;
+        for (uint32_t level = 0; level < cache->GetLodCount(i); ++level)
+        {
+            auto&       lod = cache->GetLod(i, level);
+            MeshSPtr    lodMesh = Mesh::CreateWithVertexBuffer(glMesh->GetVertexBuffer(), cache->GetVertexFormat(),
+                                                            cache->GetLodIndices(i, level), lod.indexCount,
+                                                            record.indexType, GL_TRIANGLES);
+            levels.push_back({ lodMesh, lod.error });
+        }
+        AddMesh(std::move(glMesh), std::move(levels));
+    }
+
+    for (uint32_t i = 0; i < cache->GetNodeCount(); ++i)
+    {
+        auto&       record = cache->GetNode(i);
+        const float* m = record.transform;
+        glm::mat4   transform(glm::vec4(m[0], m[1], m[2], m[3]), glm::vec4(m[4], m[5], m[6], m[7]),
+                            glm::vec4(m[8], m[9], m[10], m[11]), glm::vec4(m[12], m[13], m[14], m[15]));
+        uint32_t    node = this->m_scene->AddNode(record.parent, transform, cache->GetNodeName(i));
+        for (uint32_t mesh = 0; mesh < record.meshCount; ++mesh)
+            this->m_instances.push_back({ node, cache->GetNodeMesh(i, mesh) });
+    }
+    return (true);
 };
 
 bool    Model::LoadByAssimp(const std::string& filename)
@@ -54,56 +199,107 @@ bool    Model::LoadByAssimp(const std::string& filename)
         return (false);
     }
 
-    auto    dirname = filename.substr(0, filename.find_last_of("\\"));
-    auto    LoadTexture = [&](aiMaterial* material, aiTextureType type) -> TextureSPtr
+    MeshCacheData   data;
+    auto    GetTexturePath = [&](aiMaterial* material, aiTextureType type) -> std::string
     {
         if (material->GetTextureCount(type) <= 0)
-            return nullptr;
+            return (std::string());
         aiString    filepath;
-        material->GetTexture(aiTextureType_DIFFUSE, 0, &filepath);
-        auto    image = Image::Load(dirname + "\\" + std::string(filepath.C_Str()));
-        if (!image)
-            return nullptr;
-        return (Texture::CreateFromImage(image.get()));
+        material->GetTexture(type, 0, &filepath);
+        return (std::string(filepath.C_Str()));
     };
 
     for (uint32_t i = 0; i < scene->mNumMaterials; ++i)
     {
         auto    material = scene->mMaterials[i];
-        auto    glMaterial = Material::Create();
-        glMaterial->diffuse = LoadTexture(material, aiTextureType_DIFFUSE);
-        glMaterial->specular = LoadTexture(material, aiTextureType_SPECULAR);
-        m_materials.push_back(std::move(glMaterial));
+        data.materials.push_back({ GetTexturePath(material, aiTextureType_DIFFUSE),
+                                    GetTexturePath(material, aiTextureType_SPECULAR) });
     }
+    // Mesh는 한 번씩만 처리하고 여러 Node가 같은 Mesh를 참조할 수 있게 한다.
+    for (uint32_t i = 0; i < scene->mNumMeshes; ++i)
+        ProcessMesh(scene->mMeshes[i], data);
+    ProcessNode(scene->mRootNode, SceneGraph::INVALID_NODE, data);
 
-    ProcessNode(scene->mRootNode, scene);
+    // 다음 실행부터는 Import / Tangent 계산 없이 Cache에서 바로 읽는다.
+    MeshCache::Write(filename, data, GetCacheFlags());
+
+    auto    dirname = filename.substr(0, filename.find_last_of("/\\"));
+    for (auto& material : data.materials)
+        CreateMaterial(dirname, material.diffuse, material.specular);
+    for (auto& mesh : data.meshes)
+    {
+        MeshSPtr    glMesh = Mesh::CreateFromData(mesh.vertices.data(), mesh.vertices.size(),
+                                                mesh.indices.data(), mesh.indices.size(), GL_TRIANGLES,
+                                                this->m_vertexFormat);
+        glMesh->SetBounds(mesh.boundsMin, mesh.boundsMax);
+        if (mesh.materialIndex >= 0)
+            glMesh->SetMaterial(m_materials[mesh.materialIndex]);
+
+        std::vector<MeshLOD::Level> levels;
+        for (size_t level = 0; level < mesh.lodIndices.size(); ++level)
+        {
+            MeshSPtr    lodMesh = Mesh::CreateWithVertexBuffer(glMesh->GetVertexBuffer(), this->m_vertexFormat,
+                                                            mesh.lodIndices[level], GL_TRIANGLES);
+            levels.push_back({ lodMesh, mesh.lodErrors[level] });
+        }
+        AddMesh(std::move(glMesh), std::move(levels));
+    }
+    for (auto& nodeData : data.nodes)
+    {
+        uint32_t    node = this->m_scene->AddNode(nodeData.parent, nodeData.transform, nodeData.name);
+        for (auto mesh : nodeData.meshes)
+            this->m_instances.push_back({ node, mesh });
+    }
     return (true);
 };
 
-void    Model::ProcessNode(aiNode* node, const aiScene* scene)
+void    Model::CreateMaterial(const std::string& dirname,
+                            const std::string& diffusePath, const std::string& specularPath)
 {
-    for (uint32_t idx = 0; idx < node->mNumMeshes; ++idx)
+    // 여러 Material이 같은 파일을 참조해도 Texture Cache에서 하나를 공유한다.
+    auto    LoadTexture = [&](const std::string& filepath) -> TextureSPtr
     {
-        // 현재 노드의 메쉬들을 뽑는다.
-        uint32_t    meshIdx = node->mMeshes[idx];
-        // 해당하는 메쉬를 SCENE에서 뽑는다.
-        aiMesh*     mesh = scene->mMeshes[meshIdx];
-        ProcessMesh(mesh, scene);
-    }
+        if (filepath.empty())
+            return nullptr;
+        return (Texture::Load(dirname + "/" + filepath));
+    };
+
+    auto    glMaterial = Material::Create();
+    glMaterial->diffuse = LoadTexture(diffusePath);
+    glMaterial->specular = LoadTexture(specularPath);
+    m_materials.push_back(std::move(glMaterial));
+};
+
+void    Model::ProcessNode(aiNode* node, uint32_t parent, MeshCacheData& data)
+{
+    // 전위 순회 -> 부모가 항상 자식보다 앞에 온다.
+    MeshCacheData::NodeData nodeData;
+    const aiMatrix4x4&  m = node->mTransformation;
+    // aiMatrix4x4는 Row-Major, glm은 Column-Major
+    nodeData.transform = glm::mat4(glm::vec4(m.a1, m.b1, m.c1, m.d1), glm::vec4(m.a2, m.b2, m.c2, m.d2),
+                                    glm::vec4(m.a3, m.b3, m.c3, m.d3), glm::vec4(m.a4, m.b4, m.c4, m.d4));
+    nodeData.parent = parent;
+    nodeData.name = node->mName.C_Str();
+    // 현재 노드가 참조하는 메쉬들 (ProcessMesh에서 Scene 순서대로 만들었으므로 인덱스가 같다.)
+    nodeData.meshes.assign(node->mMeshes, node->mMeshes + node->mNumMeshes);
+    uint32_t    index = static_cast<uint32_t>(data.nodes.size());
+    data.nodes.push_back(std::move(nodeData));
 
-    // 재귀적으로 돌면서 노드에 해당하는 메쉬들을 처리한다.
+    // 재귀적으로 돌면서 자식 노드들을 처리한다.
     for (uint32_t idx = 0; idx < node->mNumChildren; ++idx)
-        ProcessNode(node->mChildren[idx], scene);
+        ProcessNode(node->mChildren[idx], index, data);
 };
 
-void    Model::ProcessMesh(aiMesh* mesh, const aiScene* scene)
+void    Model::ProcessMesh(aiMesh* mesh, MeshCacheData& data)
 {
     // std::cout << "Process Mesh: " << std::string(mesh->mName.C_Str())
     //             << ", #Vert: " << mesh->mNumVertices
     //             << ", #face: " << mesh->mNumFaces << std::endl;
 
+    MeshCacheData::MeshData meshData;
+
     // 해당하는 Mesh에서 Vertices를 임시 저장.
-    std::vector<Vertex> vertices;
+    std::vector<Vertex>&    vertices = meshData.vertices;
     vertices.resize(mesh->mNumVertices);
     for (uint32_t idx = 0; idx < mesh->mNumVertices; ++idx)
     {
@@ -114,7 +310,7 @@ void    Model::ProcessMesh(aiMesh* mesh, const aiScene* scene)
     }
 
     // 해당하는 Mesh에서 Indices를 임시 저장.
-    std::vector<uint32_t>   indices;
+    std::vector<uint32_t>&  indices = meshData.indices;
     indices.resize(mesh->mNumFaces * 3);
     for (uint32_t idx = 0; idx < mesh->mNumFaces; ++idx)
     {
@@ -123,11 +319,27 @@ void    Model::ProcessMesh(aiMesh* mesh, const aiScene* scene)
         indices[3 * idx + 2] = mesh->mFaces[idx].mIndices[2];
     }
 
-    // 해당하는 Mesh에서 뽑은 정보로 그리기 편한 Mesh로 생성
-    MeshSPtr    glMesh = Mesh::Create(vertices, indices, GL_TRIANGLES);
-    if (mesh->mMaterialIndex >= 0)
-        glMesh->SetMaterial(m_materials[mesh->mMaterialIndex]);
-    this->m_meshes.push_back(std::move(glMesh));
+    // Cache에 그대로 저장할 수 있도록 Tangent / Bounds를 여기서 계산한다.
+    Mesh::ComputeTangents(vertices, indices);
+    if (this->m_optimize)
+    {
+        auto    stats = MeshOptimizer::Optimize(vertices, indices, offsetof(Vertex, position));
+        MeshOptimizer::PrintStats(stats, indices.size() / 3);
+    }
+    // Level 0이 최적화된 뒤에 만들어야 LOD도 같은 Vertex 순서를 쓴다.
+    if (this->m_lodLevelCount > 1)
+        meshData.lodIndices = MeshLOD::BuildLevels(vertices, indices, this->m_lodLevelCount, meshData.lodErrors);
+    if (!vertices.empty())
+    {
+        meshData.boundsMin = meshData.boundsMax = vertices[0].position;
+        for (auto& vertex : vertices)
+        {
+            meshData.boundsMin = glm::min(meshData.boundsMin, vertex.position);
+            meshData.boundsMax = glm::max(meshData.boundsMax, vertex.position);
+        }
+    }
+    meshData.materialIndex = static_cast<int32_t>(mesh->mMaterialIndex);
+    data.meshes.push_back(std::move(meshData));
 };
 
 #endif
\ No newline at end of file
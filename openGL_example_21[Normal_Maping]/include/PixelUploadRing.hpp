@@ -0,0 +1,170 @@
+#ifndef PIXELUPLOADRING_HPP
+#define PIXELUPLOADRING_HPP
+
+#include "Common.hpp"
+#include "GLStateCache.hpp"
+
+#include <deque>
+
+// Texture Upload용 Staging Ring Buffer (GL_PIXEL_UNPACK_BUFFER)
+// 한 번 Persistent Map 해 두고 Image를 memcpy 한 뒤 glTexSubImage2D에는 Buffer Offset을 넘긴다.
+// -> Driver가 Client Memory를 동기 복사하지 않고 GPU가 나중에 DMA로 읽어 간다.
+// Fence()로 지금까지 쓴 구간을 묶어 두고, 공간이 모자라면 가장 오래된 구간의 Fence만 기다린다.
+CLASS_PTR(PixelUploadRing);
+class PixelUploadRing
+{
+public:
+    struct Allocation {
+        uint8_t*    data { nullptr };   // CPU에서 쓸 위치
+        size_t      offset { 0 };       // glTexSubImage2D에 넘길 Buffer Offset
+    };
+    struct Stats {
+        size_t  uploadedBytes { 0 };
+        size_t  stalls { 0 };   // 공간이 없어서 Fence를 기다린 횟수
+    };
+
+    static PixelUploadRingUPtr  Create(size_t size = 32 * 1024 * 1024);
+
+    ~PixelUploadRing();
+    size_t          GetSize(void) const
+    { return (this->m_size); };
+    const Stats&    GetStats(void) const
+    { return (this->m_stats); };
+
+    // size가 Ring보다 크거나 Fence를 기다리지 못하면 false (직접 Upload 해야 한다.)
+    bool    Allocate(size_t size, Allocation& allocation);
+    // 쓰기가 끝난 Allocation을 읽는 GL 명령을 모두 낸 뒤에 호출한다. (보통 프레임마다 한 번)
+    void    Fence(void);
+    void    Bind(void) const
+    { GLStateCache::Get().BindBuffer(GL_PIXEL_UNPACK_BUFFER, this->m_buffer); };
+    // 다른 glTexImage2D가 Client Pointer를 Offset으로 해석하지 않도록 사용 후 반드시 푼다.
+    void    Unbind(void) const
+    { GLStateCache::Get().BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0); };
+private:
+    static const size_t ALIGNMENT = 16;
+
+    struct Region {
+        GLsync  fence;
+        size_t  size;   // Wrap 때 버린 끝부분까지 포함
+    };
+
+    uint32_t            m_buffer { 0 };
+    uint8_t*            m_mapped { nullptr };
+    size_t              m_size { 0 };
+    size_t              m_head { 0 };       // 다음에 쓸 위치
+    size_t              m_used { 0 };       // GPU가 아직 읽고 있을 수 있는 byte
+    size_t              m_unfenced { 0 };   // 마지막 Fence 이후에 쓴 byte
+    std::deque<Region>  m_regions;
+    Stats               m_stats;
+
+    PixelUploadRing() {};
+    bool    init(size_t size);
+    bool    Retire(bool wait);
+};
+
+PixelUploadRingUPtr PixelUploadRing::Create(size_t size)
+{
+    PixelUploadRingUPtr ring = PixelUploadRingUPtr(new PixelUploadRing());
+    if (!ring->init(size))
+        return (nullptr);
+    return (std::move(ring));
+};
+
+PixelUploadRing::~PixelUploadRing()
+{
+    for (auto& region : this->m_regions)
+        glDeleteSync(region.fence);
+    if (this->m_buffer)
+    {
+        GLStateCache::Get().ForgetBuffer(this->m_buffer);
+        glDeleteBuffers(1, &this->m_buffer);
+    }
+};
+
+bool    PixelUploadRing::init(size_t size)
+{
+    this->m_size = size;
+    const GLbitfield    flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glGenBuffers(1, &this->m_buffer);
+    Bind();
+    glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, nullptr, flags);
+    this->m_mapped = static_cast<uint8_t*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags));
+    Unbind();
+    if (!this->m_mapped)
+    {
+        putError("Failed to map pixel upload ring");
+        return (false);
+    }
+    return (true);
+};
+
+bool    PixelUploadRing::Allocate(size_t size, Allocation& allocation)
+{
+    if (size == 0 || size > this->m_size)
+        return (false);
+
+    size_t  offset = (this->m_head + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    if (offset + size > this->m_size)
+        offset = 0;
+    // 정렬 / Wrap으로 건너뛴 부분도 GPU가 앞 구간을 다 읽을 때까지는 쓸 수 없다.
+    size_t  need = (offset >= this->m_head ? offset - this->m_head : this->m_size - this->m_head) + size;
+
+    Retire(false);
+    while (this->m_used + need > this->m_size)
+    {
+        if (this->m_regions.empty())
+        {
+            // 아직 Fence를 걸지 않은 구간이 공간을 잡고 있다.
+            if (this->m_unfenced == 0)
+                return (false);
+            Fence();
+        }
+        ++this->m_stats.stalls;
+        if (!Retire(true))
+            return (false);
+    }
+
+    this->m_head = offset + size;
+    this->m_used += need;
+    this->m_unfenced += need;
+    this->m_stats.uploadedBytes += size;
+    allocation.data = this->m_mapped + offset;
+    allocation.offset = offset;
+    return (true);
+};
+
+void    PixelUploadRing::Fence(void)
+{
+    if (this->m_unfenced == 0)
+        return ;
+    this->m_regions.push_back({ glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), this->m_unfenced });
+    this->m_unfenced = 0;
+};
+
+bool    PixelUploadRing::Retire(bool wait)
+{
+    // wait : 가장 오래된 구간 하나는 끝날 때까지 기다린다.
+    // Signal 되지 않은 구간은 GPU가 아직 읽고 있을 수 있으므로 어떤 경우에도 풀지 않는다.
+    while (!this->m_regions.empty())
+    {
+        auto&       region = this->m_regions.front();
+        GLuint64    timeout = wait ? 1000000000ULL : 0;
+        GLenum      result = glClientWaitSync(region.fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+        while (wait && result == GL_TIMEOUT_EXPIRED)
+            result = glClientWaitSync(region.fence, 0, timeout);
+        if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+        {
+            if (!wait)
+                return (true);
+            putError("Pixel upload ring fence wait failed");
+            return (false);
+        }
+        glDeleteSync(region.fence);
+        this->m_used -= region.size;
+        this->m_regions.pop_front();
+        wait = false;
+    }
+    return (true);
+};
+
+#endif
@@ -3,6 +3,11 @@
 
 #include "Common.hpp"
 #include "Shader.hpp"
+#include "GLStateCache.hpp"
+#include "ProgramBinaryCache.hpp"
+
+// glGetUniformLocation 결과(location)를 그대로 Handle로 사용한다. (-1 : 없는 Uniform)
+using UniformId = GLint;
 
 CLASS_PTR(Program);
 class Program
@@ -10,30 +15,62 @@ class Program
 public:
     static ProgramUPtr  Create(const std::vector<ShaderSPtr>& shaders);
     static ProgramUPtr  Create(const std::string& vertexShaderFilename
-                            , const std::string& fragmentShaderFilename);
+                            , const std::string& fragmentShaderFilename
+                            , const std::vector<std::string>& defines = {});
 
     ~Program(void);
     uint32_t    Get(void) const
     { return (this->m_program); };
     void        Use(void) const
-    { glUseProgram(m_program); };
+    { GLStateCache::Get().UseProgram(m_program); };
+    UniformId   GetUniformId(const std::string& name) const;
+    // 모든 Draw가 쓰는 Transform은 Link 때 찾아 둔다.
+    UniformId   GetTransformId(void) const
+    { return (this->m_transformId); };
+    UniformId   GetModelTransformId(void) const
+    { return (this->m_modelTransformId); };
+
+    void        SetUniform(UniformId id, int value) const
+    { GLStateCache::Get().CountUniformSet(); glUniform1i(id, value); };
+    void        SetUniform(UniformId id, float value) const
+    { GLStateCache::Get().CountUniformSet(); glUniform1f(id, value); };
+    void        SetUniform(UniformId id, const glm::mat4& value) const
+    { GLStateCache::Get().CountUniformSet(); glUniformMatrix4fv(id, 1, GL_FALSE, glm::value_ptr(value)); };
+    void        SetUniform(UniformId id, const glm::vec2& value) const
+    { GLStateCache::Get().CountUniformSet(); glUniform2fv(id, 1, glm::value_ptr(value)); };
+    void        SetUniform(UniformId id, const glm::vec3& value) const
+    { GLStateCache::Get().CountUniformSet(); glUniform3fv(id, 1, glm::value_ptr(value)); };
+    void        SetUniform(UniformId id, const glm::vec4& value) const
+    { GLStateCache::Get().CountUniformSet(); glUniform4fv(id, 1, glm::value_ptr(value)); };
+
+    // 이름으로 넘기는 경우에도 Driver에 묻지 않고 Link 시점에 만든 Cache에서 찾는다.
     void        SetUniform(const std::string& name, int value) const
-    { glUniform1i(glGetUniformLocation(m_program, name.c_str()), value); };
+    { SetUniform(GetUniformId(name), value); };
     void        SetUniform(const std::string& name, float value) const
-    { glUniform1f(glGetUniformLocation(m_program, name.c_str()), value); };
+    { SetUniform(GetUniformId(name), value); };
     void        SetUniform(const std::string& name, const glm::mat4& value) const
-    { glUniformMatrix4fv(glGetUniformLocation(m_program, name.c_str()), 1, GL_FALSE, glm::value_ptr(value)); };
+    { SetUniform(GetUniformId(name), value); };
     void        SetUniform(const std::string& name, const glm::vec2& value) const
-    { glUniform2fv(glGetUniformLocation(m_program, name.c_str()), 1, glm::value_ptr(value)); };
+    { SetUniform(GetUniformId(name), value); };
     void        SetUniform(const std::string& name, const glm::vec3& value) const
-    { glUniform3fv(glGetUniformLocation(m_program, name.c_str()), 1, glm::value_ptr(value)); };
+    { SetUniform(GetUniformId(name), value); };
     void        SetUniform(const std::string& name, const glm::vec4& value) const
-    { glUniform4fv(glGetUniformLocation(m_program, name.c_str()), 1, glm::value_ptr(value)); };
+    { SetUniform(GetUniformId(name), value); };
 private:
     uint32_t    m_program { 0 };
+    std::unordered_map<std::string, UniformId>  m_uniforms;
+    UniformId   m_transformId { -1 };
+    UniformId   m_modelTransformId { -1 };
 
     Program(void) {};
+    friend class ProgramBatch;
+
     bool    Link(const std::vector<ShaderSPtr>& shaders);
+    void    SubmitLink(const std::vector<ShaderSPtr>& shaders);
+    bool    IsLinkCompleted(void) const;
+    bool    CheckLinkStatus(void);
+    bool    LoadBinary(uint64_t key);
+    void    LoadUniforms(void);
 };
 
 ProgramUPtr Program::Create(const std::vector<ShaderSPtr>& shaders)
@@ -43,31 +80,74 @@ ProgramUPtr Program::Create(const std::vector<ShaderSPtr>& shaders)
         return (nullptr);
     return (std::move(program));
 };
-ProgramUPtr  Program::Create(const std::string& vertexShaderFilename, const std::string& fragmentShaderFilename)
+ProgramUPtr  Program::Create(const std::string& vertexShaderFilename, const std::string& fragmentShaderFilename,
+                            const std::vector<std::string>& defines)
 {
-    ShaderSPtr	vertexShader = Shader::CreateFromFile(vertexShaderFilename, GL_VERTEX_SHADER);
-	ShaderSPtr	fragmentShader = Shader::CreateFromFile(fragmentShaderFilename, GL_FRAGMENT_SHADER);
-	if (!vertexShader || !fragmentShader)
+    auto    startTime = std::chrono::steady_clock::now();
+    auto    vertexCode = Shader::Preprocess(vertexShaderFilename, defines);
+    auto    fragmentCode = Shader::Preprocess(fragmentShaderFilename, defines);
+    if (!vertexCode.has_value() || !fragmentCode.has_value())
         return (nullptr);
-    std::cout << "Vertex Shader id: " << vertexShader->Get() << std::endl;
-	std::cout << "Fragment Shader id: " << fragmentShader->Get() << std::endl;
 
-    return (std::move(Create({vertexShader, fragmentShader})));
+    // 같은 Source / Driver로 만든 Binary가 있으면 Compile 없이 불러온다.
+    auto&       binaryCache = ProgramBinaryCache::Get();
+    uint64_t    key = binaryCache.MakeKey({ vertexCode.value(), fragmentCode.value() });
+    ProgramUPtr program = ProgramUPtr(new Program());
+    if (!program->LoadBinary(key))
+    {
+        ShaderSPtr	vertexShader = Shader::CreateFromSource(vertexCode.value(), GL_VERTEX_SHADER,
+                                                            vertexShaderFilename);
+        ShaderSPtr	fragmentShader = Shader::CreateFromSource(fragmentCode.value(), GL_FRAGMENT_SHADER,
+                                                            fragmentShaderFilename);
+        if (!vertexShader || !fragmentShader)
+            return (nullptr);
+        std::cout << "Vertex Shader id: " << vertexShader->Get() << std::endl;
+        std::cout << "Fragment Shader id: " << fragmentShader->Get() << std::endl;
+        if (!program->Link({vertexShader, fragmentShader}))
+            return (nullptr);
+        binaryCache.Save(key, program->Get());
+    }
+
+    std::chrono::duration<double, std::milli>   elapsed = std::chrono::steady_clock::now() - startTime;
+    binaryCache.AddLoadTime(elapsed.count());
+    return (std::move(program));
 };
 
 Program::~Program(void)
 {
     if (this->m_program)
+    {
+        GLStateCache::Get().ForgetProgram(this->m_program);
         glDeleteProgram(this->m_program);
+    }
 };
 
 bool    Program::Link(const std::vector<ShaderSPtr>& shaders)
+{
+    SubmitLink(shaders);
+    return (CheckLinkStatus());
+};
+
+void    Program::SubmitLink(const std::vector<ShaderSPtr>& shaders)
 {
     this->m_program = glCreateProgram();
     for (auto& shader : shaders)
         glAttachShader(this->m_program, shader->Get());
+    glProgramParameteri(this->m_program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     glLinkProgram(this->m_program);
+};
 
+bool    Program::IsLinkCompleted(void) const
+{
+    if (!GLAD_GL_KHR_parallel_shader_compile)
+        return (true);
+    int completed = 0;
+    glGetProgramiv(this->m_program, GL_COMPLETION_STATUS_KHR, &completed);
+    return (completed == GL_TRUE);
+};
+
+bool    Program::CheckLinkStatus(void)
+{
     int success = 0;
     glGetProgramiv(this->m_program, GL_LINK_STATUS, &success);
     if (!success)
@@ -77,7 +157,69 @@ bool    Program::Link(const std::vector<ShaderSPtr>& shaders)
         putError("Failed to link program: " + std::string(infoLog));
         return (false);
     }
+    LoadUniforms();
     return (true);
 };
 
+bool    Program::LoadBinary(uint64_t key)
+{
+    this->m_program = glCreateProgram();
+    if (!ProgramBinaryCache::Get().Load(key, this->m_program))
+    {
+        glDeleteProgram(this->m_program);
+        this->m_program = 0;
+        return (false);
+    }
+    LoadUniforms();
+    return (true);
+};
+
+void    Program::LoadUniforms(void)
+{
+    int uniformCount = 0;
+    int maxNameLength = 0;
+    glGetProgramiv(this->m_program, GL_ACTIVE_UNIFORMS, &uniformCount);
+    glGetProgramiv(this->m_program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+    std::vector<char>   nameBuffer(maxNameLength + 1);
+    for (int idx = 0; idx < uniformCount; ++idx)
+    {
+        GLsizei length = 0;
+        GLint   size = 0;
+        GLenum  type = 0;
+        glGetActiveUniform(this->m_program, idx, static_cast<GLsizei>(nameBuffer.size()),
+                            &length, &size, &type, nameBuffer.data());
+        std::string name(nameBuffer.data(), length);
+        UniformId   location = glGetUniformLocation(this->m_program, name.c_str());
+        // Uniform Block 안의 변수는 location이 없다.
+        if (location < 0)
+            continue;
+        this->m_uniforms[name] = location;
+
+        // 배열은 "name[0]"으로 나오므로 "name"과 각 원소 이름도 등록한다.
+        // 구조체 배열의 멤버("lights[0].position")는 끝이 "[0]"이 아니므로 그대로 둔다.
+        const std::string   suffix = "[0]";
+        if (name.size() <= suffix.size() || name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0)
+            continue;
+        std::string base = name.substr(0, name.size() - suffix.size());
+        this->m_uniforms[base] = location;
+        for (int elem = 1; elem < size; ++elem)
+        {
+            std::string elemName = base + "[" + std::to_string(elem) + "]";
+            this->m_uniforms[elemName] = glGetUniformLocation(this->m_program, elemName.c_str());
+        }
+    }
+    this->m_transformId = GetUniformId("transform");
+    this->m_modelTransformId = GetUniformId("modelTransform");
+};
+
+UniformId   Program::GetUniformId(const std::string& name) const
+{
+    GLStateCache::Get().CountUniformLookup();
+    auto    iter = this->m_uniforms.find(name);
+    if (iter == this->m_uniforms.end())
+        return (-1);
+    return (iter->second);
+};
+
 #endif
\ No newline at end of file
@@ -0,0 +1,161 @@
+#ifndef PROGRAMBATCH_HPP
+#define PROGRAMBATCH_HPP
+
+#include "Common.hpp"
+#include "Program.hpp"
+
+// 여러 Program의 Compile / Link를 먼저 모두 Driver에 넘기고, 결과는 Finish()에서 한 번에 확인한다.
+// GL_KHR_parallel_shader_compile이 있으면 Driver가 여러 Thread에서 동시에 Compile 한다.
+CLASS_PTR(ProgramBatch);
+class ProgramBatch
+{
+public:
+    static ProgramBatchUPtr Create(void);
+
+    // Finish()가 성공하면 target에 Program이 들어간다.
+    void    Add(ProgramUPtr* target, const std::string& vertexShaderFilename,
+                const std::string& fragmentShaderFilename,
+                const std::vector<std::string>& defines = {});
+    // Submit()과 Finish() 사이에 다른 작업(Image 로딩 등)을 하면 Compile과 겹쳐진다.
+    bool    Submit(void);
+    bool    Finish(void);
+private:
+    struct Entry {
+        ProgramUPtr*            target;
+        std::string             vertexShaderFilename;
+        std::string             fragmentShaderFilename;
+        std::vector<std::string>    defines;
+        std::vector<std::string>    sources;
+        uint64_t                key { 0 };
+        ProgramUPtr             program;
+        std::vector<ShaderSPtr> shaders;
+        bool                    fromBinary { false };
+    };
+    std::vector<Entry>  m_entries;
+    bool                m_submitted { false };
+    std::chrono::steady_clock::time_point   m_startTime;
+
+    ProgramBatch() {};
+    void    init(void);
+    bool    FinishEntry(Entry& entry);
+};
+
+ProgramBatchUPtr    ProgramBatch::Create(void)
+{
+    ProgramBatchUPtr    batch = ProgramBatchUPtr(new ProgramBatch());
+    batch->init();
+    return (std::move(batch));
+};
+
+void    ProgramBatch::init(void)
+{
+    // Driver가 쓸 수 있는 만큼 Compile Thread를 사용하도록 한다.
+    if (GLAD_GL_KHR_parallel_shader_compile)
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+};
+
+void    ProgramBatch::Add(ProgramUPtr* target, const std::string& vertexShaderFilename,
+                        const std::string& fragmentShaderFilename,
+                        const std::vector<std::string>& defines)
+{
+    Entry   entry;
+    entry.target = target;
+    entry.vertexShaderFilename = vertexShaderFilename;
+    entry.fragmentShaderFilename = fragmentShaderFilename;
+    entry.defines = defines;
+    this->m_entries.push_back(std::move(entry));
+};
+
+bool    ProgramBatch::Submit(void)
+{
+    this->m_startTime = std::chrono::steady_clock::now();
+    auto&   binaryCache = ProgramBinaryCache::Get();
+
+    // 1. Source를 읽고 Binary Cache에 있는 것은 바로 불러온다.
+    for (auto& entry : this->m_entries)
+    {
+        auto    vertexCode = Shader::Preprocess(entry.vertexShaderFilename, entry.defines);
+        auto    fragmentCode = Shader::Preprocess(entry.fragmentShaderFilename, entry.defines);
+        // 실패하면 m_submitted를 세우지 않으므로 Finish()가 Program이 없는 Entry를 보지 않는다.
+        if (!vertexCode.has_value() || !fragmentCode.has_value())
+            return (false);
+        entry.sources = { vertexCode.value(), fragmentCode.value() };
+        entry.key = binaryCache.MakeKey(entry.sources);
+        entry.program = ProgramUPtr(new Program());
+        entry.fromBinary = entry.program->LoadBinary(entry.key);
+    }
+
+    // 2. 나머지는 Compile / Link를 결과 확인 없이 모두 넘긴다.
+    for (auto& entry : this->m_entries)
+    {
+        if (entry.fromBinary)
+            continue;
+        entry.shaders = {
+            Shader::SubmitSource(entry.sources[0], GL_VERTEX_SHADER, entry.vertexShaderFilename),
+            Shader::SubmitSource(entry.sources[1], GL_FRAGMENT_SHADER, entry.fragmentShaderFilename)
+        };
+    }
+    for (auto& entry : this->m_entries)
+        if (!entry.fromBinary)
+            entry.program->SubmitLink(entry.shaders);
+    this->m_submitted = true;
+    return (true);
+};
+
+bool    ProgramBatch::Finish(void)
+{
+    if (!this->m_submitted && !Submit())
+        return (false);
+
+    // 3. 먼저 끝난 것부터 결과를 확인한다.
+    bool    success = true;
+    size_t  remain = this->m_entries.size();
+    std::vector<bool>   done(this->m_entries.size(), false);
+    while (remain > 0)
+    {
+        bool    progressed = false;
+        for (size_t idx = 0; idx < this->m_entries.size(); ++idx)
+        {
+            auto&   entry = this->m_entries[idx];
+            if (done[idx] || (!entry.fromBinary && !entry.program->IsLinkCompleted()))
+                continue;
+            success = FinishEntry(entry) && success;
+            done[idx] = true;
+            --remain;
+            progressed = true;
+        }
+        // 아무것도 끝나지 않았으면 잠깐 쉬었다가 다시 묻는다. (yield로 돌면 Core 하나를 계속 쓴다.)
+        if (!progressed)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    std::chrono::duration<double, std::milli>   elapsed = std::chrono::steady_clock::now() - this->m_startTime;
+    ProgramBinaryCache::Get().AddLoadTime(elapsed.count());
+    putLog("Program batch: " + std::to_string(this->m_entries.size()) + " programs, "
+            + std::to_string(elapsed.count()) + " ms");
+    this->m_entries.clear();
+    this->m_submitted = false;
+    return (success);
+};
+
+bool    ProgramBatch::FinishEntry(Entry& entry)
+{
+    if (!entry.fromBinary)
+    {
+        bool    compiled = true;
+        for (auto& shader : entry.shaders)
+            compiled = shader->CheckCompileStatus() && compiled;
+        if (!compiled || !entry.program->CheckLinkStatus())
+        {
+            putError("Failed to create program: " + entry.vertexShaderFilename
+                    + ", " + entry.fragmentShaderFilename);
+            return (false);
+        }
+        ProgramBinaryCache::Get().Save(entry.key, entry.program->Get());
+        entry.shaders.clear();
+    }
+    *entry.target = std::move(entry.program);
+    return (true);
+};
+
+#endif
@@ -0,0 +1,162 @@
+#ifndef PROGRAMBINARYCACHE_HPP
+#define PROGRAMBINARYCACHE_HPP
+
+#include "Common.hpp"
+
+// Link가 끝난 Program을 glGetProgramBinary로 파일에 저장해 두고
+// 다음 실행에서는 Compile / Link 대신 glProgramBinary로 바로 불러온다.
+class ProgramBinaryCache
+{
+public:
+    static ProgramBinaryCache&  Get(void);
+
+    struct Stats {
+        int     hits { 0 };
+        int     misses { 0 };
+        int     rejected { 0 };
+        double  loadMs { 0.0 };
+    };
+
+    void        SetDirectory(const std::string& directory)
+    { this->m_directory = directory; };
+    bool        IsSupported(void);
+    // Shader Source와 Driver(GL_RENDERER / GL_VERSION)가 같을 때만 같은 Key가 나온다.
+    uint64_t    MakeKey(const std::vector<std::string>& sources);
+    bool        Load(uint64_t key, uint32_t program);
+    void        Save(uint64_t key, uint32_t program);
+
+    void        AddLoadTime(double ms)
+    { this->m_stats.loadMs += ms; };
+    const Stats&    GetStats(void) const
+    { return (this->m_stats); };
+    void        PrintStats(void) const;
+private:
+    struct Header {
+        uint32_t    magic;
+        uint32_t    version;
+        uint64_t    key;
+        uint32_t    format;
+        uint32_t    length;
+    };
+    static const uint32_t   MAGIC = 0x4E494250; // "PBIN"
+    static const uint32_t   VERSION = 1;
+
+    std::string m_directory { "./cache/program" };
+    std::string m_driver;
+    int         m_supported { -1 };
+    Stats       m_stats;
+
+    ProgramBinaryCache(void) {};
+    std::string GetPath(uint64_t key) const;
+};
+
+ProgramBinaryCache& ProgramBinaryCache::Get(void)
+{
+    static ProgramBinaryCache   instance;
+    return (instance);
+};
+
+bool    ProgramBinaryCache::IsSupported(void)
+{
+    if (this->m_supported < 0)
+    {
+        int formatCount = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+        this->m_supported = formatCount > 0 ? 1 : 0;
+    }
+    return (this->m_supported == 1);
+};
+
+uint64_t    ProgramBinaryCache::MakeKey(const std::vector<std::string>& sources)
+{
+    if (this->m_driver.empty())
+    {
+        auto    renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+        auto    version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+        this->m_driver = std::string(renderer ? renderer : "") + "|" + std::string(version ? version : "");
+    }
+    uint64_t    key = HashString(this->m_driver);
+    for (auto& source : sources)
+        key = HashString(source, key ^ source.size());
+    return (key);
+};
+
+bool    ProgramBinaryCache::Load(uint64_t key, uint32_t program)
+{
+    if (!IsSupported())
+        return (false);
+    std::ifstream   fin(GetPath(key), std::ios::binary);
+    if (!fin.is_open())
+    {
+        ++this->m_stats.misses;
+        return (false);
+    }
+
+    Header  header {};
+    fin.read(reinterpret_cast<char*>(&header), sizeof(header));
+    std::vector<char>   binary;
+    if (fin && header.magic == MAGIC && header.version == VERSION && header.key == key)
+    {
+        binary.resize(header.length);
+        fin.read(binary.data(), header.length);
+    }
+    if (binary.empty() || !fin)
+    {
+        ++this->m_stats.rejected;
+        return (false);
+    }
+
+    // Driver가 바뀌었거나 Binary가 깨졌으면 Link 실패로 돌아온다. -> Source에서 다시 만든다.
+    glProgramBinary(program, header.format, binary.data(), static_cast<GLsizei>(binary.size()));
+    int success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        ++this->m_stats.rejected;
+        return (false);
+    }
+    ++this->m_stats.hits;
+    return (true);
+};
+
+void    ProgramBinaryCache::Save(uint64_t key, uint32_t program)
+{
+    if (!IsSupported())
+        return ;
+    int length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return ;
+
+    std::vector<char>   binary(length);
+    GLenum  format = 0;
+    glGetProgramBinary(program, length, &length, &format, binary.data());
+
+    std::error_code ec;
+    std::filesystem::create_directories(this->m_directory, ec);
+    std::ofstream   fout(GetPath(key), std::ios::binary | std::ios::trunc);
+    if (!fout.is_open())
+    {
+        putError("Failed to write program binary cache: " + GetPath(key));
+        return ;
+    }
+    Header  header { MAGIC, VERSION, key, format, static_cast<uint32_t>(length) };
+    fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    fout.write(binary.data(), length);
+};
+
+void    ProgramBinaryCache::PrintStats(void) const
+{
+    std::cout << "Program binary cache: " << this->m_stats.hits << " hit, "
+            << this->m_stats.misses << " miss, " << this->m_stats.rejected << " rejected, "
+            << this->m_stats.loadMs << " ms" << std::endl;
+};
+
+std::string ProgramBinaryCache::GetPath(uint64_t key) const
+{
+    std::stringstream   name;
+    name << this->m_directory << "/" << std::hex << key << ".bin";
+    return (name.str());
+};
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef PROGRAMVARIANTS_HPP
+#define PROGRAMVARIANTS_HPP
+
+#include "Common.hpp"
+#include "Program.hpp"
+#include "ProgramBatch.hpp"
+
+// 같은 Shader 파일을 #define 조합별로 Compile 해서 보관한다.
+// Runtime uniform 분기 대신 Draw마다 알맞은 Variant를 골라 쓴다.
+CLASS_PTR(ProgramVariants);
+class ProgramVariants
+{
+public:
+    static ProgramVariantsUPtr  Create(const std::string& vertexShaderFilename,
+                                    const std::string& fragmentShaderFilename);
+
+    // 처음 요청된 조합만 Compile 하고 이후에는 Cache에서 돌려준다. (실패하면 nullptr)
+    const Program*  Get(const std::vector<std::string>& defines);
+    // 시작할 때 쓸 조합을 미리 Batch에 넣어 두면 다른 Program과 함께 Compile 된다.
+    void            AddToBatch(ProgramBatch* batch, const std::vector<std::string>& defines);
+    size_t          GetVariantCount(void) const
+    { return (this->m_programs.size()); };
+private:
+    std::string m_vertexShaderFilename;
+    std::string m_fragmentShaderFilename;
+    std::unordered_map<uint64_t, ProgramUPtr>   m_programs;
+
+    ProgramVariants() {};
+};
+
+ProgramVariantsUPtr ProgramVariants::Create(const std::string& vertexShaderFilename,
+                                            const std::string& fragmentShaderFilename)
+{
+    ProgramVariantsUPtr variants = ProgramVariantsUPtr(new ProgramVariants());
+    variants->m_vertexShaderFilename = vertexShaderFilename;
+    variants->m_fragmentShaderFilename = fragmentShaderFilename;
+    return (std::move(variants));
+};
+
+const Program*  ProgramVariants::Get(const std::vector<std::string>& defines)
+{
+    uint64_t    key = Shader::HashDefines(defines);
+    auto        iter = this->m_programs.find(key);
+    if (iter != this->m_programs.end())
+        return (iter->second.get());
+
+    // 실패한 조합도 nullptr로 기록해서 매 프레임 다시 Compile 하지 않게 한다.
+    auto&   program = this->m_programs[key];
+    program = Program::Create(this->m_vertexShaderFilename, this->m_fragmentShaderFilename, defines);
+    return (program.get());
+};
+
+void    ProgramVariants::AddToBatch(ProgramBatch* batch, const std::vector<std::string>& defines)
+{
+    uint64_t    key = Shader::HashDefines(defines);
+    if (this->m_programs.find(key) != this->m_programs.end())
+        return ;
+    // unordered_map의 원소 주소는 rehash 후에도 유지된다.
+    batch->Add(&this->m_programs[key], this->m_vertexShaderFilename,
+                this->m_fragmentShaderFilename, defines);
+};
+
+#endif
@@ -0,0 +1,259 @@
+#ifndef RENDERQUEUE_HPP
+#define RENDERQUEUE_HPP
+
+#include "Common.hpp"
+#include "Mesh.hpp"
+#include "MeshLOD.hpp"
+
+// Sort Key의 최상위 8bit. 값이 작은 Pass가 먼저 정렬된다.
+enum RenderPass : uint8_t
+{
+    SHADOW_PASS = 0,            // 정적 물체 (Shadow Cache가 있으면 바뀔 때만 그린다.)
+    SHADOW_DYNAMIC_PASS = 1,    // 움직이는 물체 (매 프레임)
+    MAIN_PASS = 2,
+    RENDER_PASS_COUNT
+};
+
+struct DrawItem
+{
+    const Mesh*     mesh;
+    const Material* material;
+    const Program*  program;
+    glm::mat4       modelTransform;
+};
+
+CLASS_PTR(RenderQueue);
+class RenderQueue
+{
+public:
+    static RenderQueueUPtr  Create(void);
+
+    struct Stats {
+        size_t  drawCount { 0 };
+        size_t  programBinds { 0 };
+        size_t  materialBinds { 0 };
+        size_t  meshBinds { 0 };
+        size_t  bindsAvoided { 0 };
+        size_t  lodTrianglesSaved { 0 };
+    };
+
+    void    Clear(void);
+    // viewportHeight : LOD 선택 때 오차를 pixel로 바꾸는 데 쓴다.
+    void    SetPassCamera(RenderPass pass, const glm::mat4& view, const glm::mat4& projection,
+                        float viewportHeight = static_cast<float>(WINDOW_HEIGHT));
+    void    Submit(RenderPass pass, const Mesh* mesh, const Material* material,
+                    const Program* program, const glm::mat4& modelTransform);
+    // 화면에서의 오차가 lodPixelError 이하인 가장 거친 Level을 골라 제출한다.
+    void    Submit(RenderPass pass, const MeshLOD* lod, const Material* material,
+                    const Program* program, const glm::mat4& modelTransform);
+    void    SetLodPixelError(float pixelError)
+    { this->m_lodPixelError = pixelError; };
+    void    Sort(void);
+    void    Execute(RenderPass pass);
+    // pass에 제출된 Draw 수
+    size_t  GetItemCount(RenderPass pass) const;
+
+    const Stats&    GetStats(void) const
+    { return (this->m_stats); };
+private:
+    // [63..56] pass | [55..44] program | [43..32] material | [31..0] depth
+    struct SortEntry {
+        uint64_t    key;
+        uint32_t    index;
+    };
+    struct PassCamera {
+        glm::mat4   view { glm::mat4(1.0f) };
+        glm::mat4   projection { glm::mat4(1.0f) };
+        float       viewportHeight { static_cast<float>(WINDOW_HEIGHT) };
+    };
+
+    std::vector<DrawItem>   m_items;
+    std::vector<SortEntry>  m_entries;
+    std::vector<SortEntry>  m_scratch;
+    PassCamera              m_cameras[RENDER_PASS_COUNT];
+    Stats                   m_stats;
+    float                   m_lodPixelError { 1.0f };
+
+    // 포인터를 Key에 들어갈 작은 번호로 바꿔 둔다. (프레임이 바뀌어도 유지)
+    std::unordered_map<const void*, uint32_t>   m_programIds;
+    std::unordered_map<const void*, uint32_t>   m_materialIds;
+
+    RenderQueue() {};
+    static uint32_t GetId(std::unordered_map<const void*, uint32_t>& ids, const void* ptr);
+    static uint32_t DepthToBits(float depth);
+};
+
+RenderQueueUPtr RenderQueue::Create(void)
+{ return (RenderQueueUPtr(new RenderQueue())); };
+
+void    RenderQueue::Clear(void)
+{
+    this->m_items.clear();
+    this->m_entries.clear();
+    this->m_stats = Stats();
+};
+
+void    RenderQueue::SetPassCamera(RenderPass pass, const glm::mat4& view, const glm::mat4& projection,
+                                    float viewportHeight)
+{
+    this->m_cameras[pass].view = view;
+    this->m_cameras[pass].projection = projection;
+    this->m_cameras[pass].viewportHeight = viewportHeight;
+};
+
+void    RenderQueue::Submit(RenderPass pass, const Mesh* mesh, const Material* material,
+                            const Program* program, const glm::mat4& modelTransform)
+{
+    if (!material)
+        material = mesh->GetMaterial().get();
+
+    // 카메라에서 가까운 것부터 그리도록 view space 깊이를 Key에 넣는다.
+    glm::vec4   viewPos = this->m_cameras[pass].view * modelTransform[3];
+    uint64_t    key = (static_cast<uint64_t>(pass) << 56)
+                    | (static_cast<uint64_t>(GetId(this->m_programIds, program) & 0xFFF) << 44)
+                    | (static_cast<uint64_t>(GetId(this->m_materialIds, material) & 0xFFF) << 32)
+                    | static_cast<uint64_t>(DepthToBits(-viewPos.z));
+
+    this->m_entries.push_back({ key, static_cast<uint32_t>(this->m_items.size()) });
+    this->m_items.push_back({ mesh, material, program, modelTransform });
+};
+
+void    RenderQueue::Submit(RenderPass pass, const MeshLOD* lod, const Material* material,
+                            const Program* program, const glm::mat4& modelTransform)
+{
+    const PassCamera&   camera = this->m_cameras[pass];
+    const Mesh*         base = lod->GetMesh(0);
+    glm::vec3   center = (base->GetBoundsMin() + base->GetBoundsMax()) * 0.5f;
+    float       radius = glm::length(base->GetBoundsMax() - base->GetBoundsMin()) * 0.5f;
+    float       scale = std::max(glm::length(glm::vec3(modelTransform[0])),
+                        std::max(glm::length(glm::vec3(modelTransform[1])), glm::length(glm::vec3(modelTransform[2]))));
+
+    // Perspective : 거리에 반비례 / Orthographic(Shadow) : 거리와 무관
+    float       projectionScale = camera.projection[1][1] * camera.viewportHeight * 0.5f;
+    float       distance = 1.0f;
+    if (camera.projection[3][3] != 1.0f)
+    {
+        glm::vec4   viewCenter = camera.view * modelTransform * glm::vec4(center, 1.0f);
+        distance = std::max(glm::length(glm::vec3(viewCenter)) - radius * scale, 1e-3f);
+    }
+    uint32_t    level = lod->SelectLevel(distance / scale, projectionScale, this->m_lodPixelError);
+
+    const Mesh* mesh = lod->GetMesh(level);
+    this->m_stats.lodTrianglesSaved += (base->GetIndexCount() - mesh->GetIndexCount()) / 3;
+    Submit(pass, mesh, material ? material : base->GetMaterial().get(), program, modelTransform);
+};
+
+void    RenderQueue::Sort(void)
+{
+    // LSD Radix Sort (8bit씩 8번). 안정 정렬이라 같은 Key는 제출 순서를 유지한다.
+    size_t  count = this->m_entries.size();
+    if (count == 0)
+        return ;
+    this->m_scratch.resize(count);
+    for (int shift = 0; shift < 64; shift += 8)
+    {
+        size_t  histogram[256] = { 0 };
+        for (auto& entry : this->m_entries)
+            ++histogram[(entry.key >> shift) & 0xFF];
+        // 모든 Key가 같은 bucket이면 이번 자리는 건너뛴다.
+        if (histogram[(this->m_entries[0].key >> shift) & 0xFF] == count)
+            continue;
+
+        size_t  offset = 0;
+        for (int bucket = 0; bucket < 256; ++bucket)
+        {
+            size_t  bucketCount = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += bucketCount;
+        }
+        for (auto& entry : this->m_entries)
+            this->m_scratch[histogram[(entry.key >> shift) & 0xFF]++] = entry;
+        this->m_entries.swap(this->m_scratch);
+    }
+};
+
+void    RenderQueue::Execute(RenderPass pass)
+{
+    const glm::mat4 viewProjection = this->m_cameras[pass].projection * this->m_cameras[pass].view;
+
+    const Program*  currentProgram = nullptr;
+    const Material* currentMaterial = nullptr;
+    const Mesh*     currentMesh = nullptr;
+    UniformId       transformId = -1;
+    UniformId       modelTransformId = -1;
+    for (auto& entry : this->m_entries)
+    {
+        if ((entry.key >> 56) != pass)
+            continue;
+        const DrawItem& item = this->m_items[entry.index];
+
+        bool    programChanged = (item.program != currentProgram);
+        if (programChanged)
+        {
+            currentProgram = item.program;
+            currentProgram->Use();
+            transformId = currentProgram->GetTransformId();
+            modelTransformId = currentProgram->GetModelTransformId();
+            ++this->m_stats.programBinds;
+        }
+        else
+            ++this->m_stats.bindsAvoided;
+
+        if (item.material && (programChanged || item.material != currentMaterial))
+        {
+            item.material->SetToProgram(currentProgram);
+            ++this->m_stats.materialBinds;
+        }
+        else if (item.material)
+            ++this->m_stats.bindsAvoided;
+        currentMaterial = item.material;
+
+        if (item.mesh != currentMesh)
+        {
+            currentMesh = item.mesh;
+            currentMesh->Bind();
+            ++this->m_stats.meshBinds;
+        }
+        else
+            ++this->m_stats.bindsAvoided;
+
+        currentProgram->SetUniform(transformId, viewProjection * item.modelTransform);
+        currentProgram->SetUniform(modelTransformId, item.modelTransform);
+        item.mesh->DrawElements();
+        ++this->m_stats.drawCount;
+    }
+};
+
+size_t  RenderQueue::GetItemCount(RenderPass pass) const
+{
+    size_t  count = 0;
+    for (auto& entry : this->m_entries)
+    {
+        if ((entry.key >> 56) == pass)
+            ++count;
+    }
+    return (count);
+};
+
+uint32_t    RenderQueue::GetId(std::unordered_map<const void*, uint32_t>& ids, const void* ptr)
+{
+    if (!ptr)
+        return (0);
+    auto    iter = ids.find(ptr);
+    if (iter != ids.end())
+        return (iter->second);
+    uint32_t    id = static_cast<uint32_t>(ids.size()) + 1;
+    ids[ptr] = id;
+    return (id);
+};
+
+uint32_t    RenderQueue::DepthToBits(float depth)
+{
+    // 양수 float은 bit 그대로 비교해도 대소 관계가 같다.
+    depth = glm::max(depth, 0.0f);
+    uint32_t    bits;
+    memcpy(&bits, &depth, sizeof(bits));
+    return (bits);
+};
+
+#endif
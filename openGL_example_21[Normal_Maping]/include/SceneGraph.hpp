@@ -0,0 +1,111 @@
+#ifndef SCENEGRAPH_HPP
+#define SCENEGRAPH_HPP
+
+#include "Common.hpp"
+
+// 배열로 펼친 Scene Graph.
+// Node는 부모가 항상 자식보다 앞에 오도록(위상 순서) 저장하므로
+// 앞에서부터 한 번 훑기만 하면 World 행렬이 모두 계산된다.
+// Local / World 행렬과 부모 인덱스는 각각 따로 연속된 배열(SoA)에 둔다.
+CLASS_PTR(SceneGraph);
+class SceneGraph
+{
+public:
+    static const uint32_t   INVALID_NODE = 0xFFFFFFFF;
+
+    static SceneGraphUPtr   Create(void);
+
+    // parent는 이미 추가된 Node여야 한다. (INVALID_NODE면 Root)
+    uint32_t    AddNode(uint32_t parent, const glm::mat4& localTransform, const std::string& name = "");
+    uint32_t    FindNode(const std::string& name) const;
+
+    size_t              GetNodeCount(void) const
+    { return (this->m_parents.size()); };
+    uint32_t            GetParent(uint32_t node) const
+    { return (this->m_parents[node]); };
+    const std::string&  GetName(uint32_t node) const
+    { return (this->m_names[node]); };
+    const glm::mat4&    GetLocalTransform(uint32_t node) const
+    { return (this->m_localTransforms[node]); };
+    // Update() 이후의 값
+    const glm::mat4&    GetWorldTransform(uint32_t node) const
+    { return (this->m_worldTransforms[node]); };
+
+    // 바뀐 Node만 표시해 두고 World 행렬은 Update()에서 한꺼번에 계산한다.
+    void        SetLocalTransform(uint32_t node, const glm::mat4& localTransform);
+    // 표시된 Node와 그 하위 Node의 World 행렬만 다시 계산한다. 다시 계산한 Node 수를 돌려준다.
+    uint32_t    Update(void);
+private:
+    std::vector<uint32_t>       m_parents;
+    std::vector<glm::mat4>      m_localTransforms;
+    std::vector<glm::mat4>      m_worldTransforms;
+    std::vector<uint8_t>        m_dirty;
+    std::vector<std::string>    m_names;
+    // 이보다 앞의 Node는 바뀌지 않았다. (부모가 항상 앞에 있으므로 여기부터 훑으면 된다.)
+    uint32_t                    m_firstDirty { INVALID_NODE };
+
+    SceneGraph() {};
+};
+
+SceneGraphUPtr  SceneGraph::Create(void)
+{ return (SceneGraphUPtr(new SceneGraph())); };
+
+uint32_t    SceneGraph::AddNode(uint32_t parent, const glm::mat4& localTransform, const std::string& name)
+{
+    uint32_t    node = static_cast<uint32_t>(this->m_parents.size());
+    if (parent != INVALID_NODE && parent >= node)
+    {
+        putError("SceneGraph node parent must be added before its children: " + name);
+        parent = INVALID_NODE;
+    }
+    this->m_parents.push_back(parent);
+    this->m_localTransforms.push_back(localTransform);
+    this->m_worldTransforms.push_back(localTransform);
+    this->m_dirty.push_back(1);
+    this->m_names.push_back(name);
+    this->m_firstDirty = std::min(this->m_firstDirty, node);
+    return (node);
+};
+
+uint32_t    SceneGraph::FindNode(const std::string& name) const
+{
+    for (size_t i = 0; i < this->m_names.size(); ++i)
+    {
+        if (this->m_names[i] == name)
+            return (static_cast<uint32_t>(i));
+    }
+    return (INVALID_NODE);
+};
+
+void    SceneGraph::SetLocalTransform(uint32_t node, const glm::mat4& localTransform)
+{
+    this->m_localTransforms[node] = localTransform;
+    this->m_dirty[node] = 1;
+    this->m_firstDirty = std::min(this->m_firstDirty, node);
+};
+
+uint32_t    SceneGraph::Update(void)
+{
+    if (this->m_firstDirty == INVALID_NODE)
+        return (0);
+
+    uint32_t    updated = 0;
+    uint32_t    count = static_cast<uint32_t>(this->m_parents.size());
+    for (uint32_t node = this->m_firstDirty; node < count; ++node)
+    {
+        uint32_t    parent = this->m_parents[node];
+        // 부모가 먼저 처리되므로 부모의 표시가 자식에게 그대로 전파된다.
+        if (parent != INVALID_NODE && this->m_dirty[parent])
+            this->m_dirty[node] = 1;
+        if (!this->m_dirty[node])
+            continue;
+        this->m_worldTransforms[node] = (parent == INVALID_NODE) ? this->m_localTransforms[node]
+                                        : this->m_worldTransforms[parent] * this->m_localTransforms[node];
+        ++updated;
+    }
+    std::fill(this->m_dirty.begin() + this->m_firstDirty, this->m_dirty.end(), 0);
+    this->m_firstDirty = INVALID_NODE;
+    return (updated);
+};
+
+#endif
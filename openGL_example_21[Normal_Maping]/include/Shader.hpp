@@ -7,15 +7,33 @@ CLASS_PTR(Shader);
 class Shader
 {
 public:
-    static  ShaderUPtr  CreateFromFile(std::string filename, GLenum shaderType);
+    static  ShaderUPtr  CreateFromFile(std::string filename, GLenum shaderType,
+                                    const std::vector<std::string>& defines = {});
+    static  ShaderUPtr  CreateFromSource(const std::string& code, GLenum shaderType,
+                                        const std::string& name = "");
+    // Compile 결과를 기다리지 않는다. CheckCompileStatus()로 나중에 확인한다.
+    static  ShaderUPtr  SubmitSource(const std::string& code, GLenum shaderType,
+                                    const std::string& name = "");
+    // #include "file"을 펼치고 #version 바로 다음에 #define을 넣은 Source를 만든다.
+    static  std::optional<std::string>  Preprocess(const std::string& filename,
+                                                const std::vector<std::string>& defines = {});
+    // define 순서와 상관없이 같은 조합이면 같은 값이 나온다.
+    static  uint64_t    HashDefines(const std::vector<std::string>& defines);
 
     ~Shader(void);
     uint32_t    Get() const {return this->m_shader; };
+    bool        IsCompileCompleted(void) const;
+    bool        CheckCompileStatus(void) const;
 private:
     uint32_t    m_shader { 0 };
+    std::string m_name;
 
     Shader(void) {};
-    bool    LoadFile(const std::string& filename, GLenum shaderType);
+    bool    LoadFile(const std::string& filename, GLenum shaderType,
+                    const std::vector<std::string>& defines);
+    static  bool    ResolveIncludes(const std::filesystem::path& filepath, std::string& out,
+                                    std::vector<std::filesystem::path>& included, int depth);
+    void    Submit(const std::string& code, GLenum shaderType, const std::string& name);
 };
 
 Shader::~Shader(void)
@@ -24,35 +42,159 @@ Shader::~Shader(void)
         glDeleteShader(this->m_shader);
 }
 
-ShaderUPtr  Shader::CreateFromFile(std::string filename, GLenum shaderType)
+ShaderUPtr  Shader::CreateFromFile(std::string filename, GLenum shaderType,
+                                const std::vector<std::string>& defines)
 {
     ShaderUPtr  shader = ShaderUPtr(new Shader());
-    if (!shader->LoadFile(filename, shaderType))
+    if (!shader->LoadFile(filename, shaderType, defines))
         return (nullptr);
     return (std::move(shader));
 }
 
-bool    Shader::LoadFile(const std::string& filename, GLenum shaderType)
+ShaderUPtr  Shader::CreateFromSource(const std::string& code, GLenum shaderType, const std::string& name)
 {
-    auto    result = LoadTextFile(filename);
+    ShaderUPtr  shader = SubmitSource(code, shaderType, name);
+    if (!shader->CheckCompileStatus())
+        return (nullptr);
+    return (std::move(shader));
+}
+
+ShaderUPtr  Shader::SubmitSource(const std::string& code, GLenum shaderType, const std::string& name)
+{
+    ShaderUPtr  shader = ShaderUPtr(new Shader());
+    shader->Submit(code, shaderType, name);
+    return (std::move(shader));
+}
+
+bool    Shader::LoadFile(const std::string& filename, GLenum shaderType,
+                        const std::vector<std::string>& defines)
+{
+    auto    result = Preprocess(filename, defines);
     if (!result.has_value())
         return (false);
-    
-    std::string&    code = result.value();
+    Submit(result.value(), shaderType, filename);
+    return (CheckCompileStatus());
+}
+
+std::optional<std::string>  Shader::Preprocess(const std::string& filename,
+                                            const std::vector<std::string>& defines)
+{
+    std::string code;
+    std::vector<std::filesystem::path>  included;
+    if (!ResolveIncludes(filename, code, included, 0))
+        return {};
+
+    // #version은 항상 첫 문장이어야 하므로 그 다음 줄에 define을 넣는다.
+    size_t  versionPos = code.find("#version");
+    size_t  insertPos = 0;
+    int     nextLine = 1;
+    if (versionPos != std::string::npos)
+    {
+        insertPos = code.find('\n', versionPos);
+        insertPos = (insertPos == std::string::npos) ? code.size() : insertPos + 1;
+        nextLine = static_cast<int>(std::count(code.begin(), code.begin() + insertPos, '\n')) + 1;
+    }
+    std::string header;
+    for (auto& define : defines)
+        header += "#define " + define + "\n";
+    if (!header.empty())
+        header += "#line " + std::to_string(nextLine) + "\n";
+    code.insert(insertPos, header);
+    return (code);
+}
+
+bool    Shader::ResolveIncludes(const std::filesystem::path& filepath, std::string& out,
+                                std::vector<std::filesystem::path>& included, int depth)
+{
+    if (depth > 16)
+    {
+        putError("Shader include depth exceeded: " + filepath.string());
+        return (false);
+    }
+    auto    result = LoadTextFile(filepath.string());
+    if (!result.has_value())
+        return (false);
+
+    std::error_code ec;
+    auto    canonical = std::filesystem::weakly_canonical(filepath, ec);
+    included.push_back(ec ? filepath : canonical);
+
+    std::istringstream  lines(result.value());
+    std::string         line;
+    int                 lineNumber = 0;
+    while (std::getline(lines, line))
+    {
+        ++lineNumber;
+        size_t  start = line.find_first_not_of(" \t");
+        if (start == std::string::npos || line.compare(start, 8, "#include") != 0)
+        {
+            out += line + "\n";
+            continue;
+        }
+
+        size_t  open = line.find('"', start);
+        size_t  close = (open == std::string::npos) ? open : line.find('"', open + 1);
+        if (close == std::string::npos)
+        {
+            putError("Invalid #include in " + filepath.string() + ":" + std::to_string(lineNumber));
+            return (false);
+        }
+        auto    includePath = filepath.parent_path() / line.substr(open + 1, close - open - 1);
+        auto    includeCanonical = std::filesystem::weakly_canonical(includePath, ec);
+        // 같은 파일은 한 번만 넣는다. (Uniform Block 중복 선언 방지)
+        if (std::find(included.begin(), included.end(), ec ? includePath : includeCanonical) != included.end())
+        {
+            out += "\n";
+            continue;
+        }
+        out += "#line 1\n";
+        if (!ResolveIncludes(includePath, out, included, depth + 1))
+            return (false);
+        out += "#line " + std::to_string(lineNumber + 1) + "\n";
+    }
+    return (true);
+}
+
+uint64_t    Shader::HashDefines(const std::vector<std::string>& defines)
+{
+    std::vector<std::string>    sorted = defines;
+    std::sort(sorted.begin(), sorted.end());
+    uint64_t    hash = HashString("");
+    for (auto& define : sorted)
+        hash = HashString(define + "\n", hash);
+    return (hash);
+}
+
+void    Shader::Submit(const std::string& code, GLenum shaderType, const std::string& name)
+{
     const char*     codePtr = code.c_str();
     int32_t         codeLength = static_cast<int32_t>(code.length());
 
+    this->m_name = name;
     this->m_shader = glCreateShader(shaderType);
     glShaderSource(this->m_shader, 1, (const GLchar* const*)&codePtr, &codeLength);
     glCompileShader(this->m_shader);
+}
 
+bool    Shader::IsCompileCompleted(void) const
+{
+    // GL_KHR_parallel_shader_compile이 없으면 항상 끝난 것으로 본다. (status 조회가 알아서 기다린다.)
+    if (!GLAD_GL_KHR_parallel_shader_compile)
+        return (true);
+    int completed = 0;
+    glGetShaderiv(this->m_shader, GL_COMPLETION_STATUS_KHR, &completed);
+    return (completed == GL_TRUE);
+}
+
+bool    Shader::CheckCompileStatus(void) const
+{
     int success = 0;
     glGetShaderiv(this->m_shader, GL_COMPILE_STATUS, &success);
     if (!success)
     {
         char    infoLog[1024];
         glGetShaderInfoLog(this->m_shader, 1024, nullptr, infoLog);
-        putError("Failed to Compile Shader: " + filename);
+        putError("Failed to Compile Shader: " + this->m_name);
         putError("Reason: " + std::string(infoLog));
         return (false);
     }
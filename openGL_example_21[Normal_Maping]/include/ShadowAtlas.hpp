@@ -0,0 +1,238 @@
+#ifndef SHADOWATLAS_HPP
+#define SHADOWATLAS_HPP
+
+#include "Common.hpp"
+#include "GLStateCache.hpp"
+
+// 여러 Light의 Shadow Map을 나눠 담는 큰 Depth Texture 한 장.
+// 영역은 Quadtree로 나눈다. (Tile 크기는 2의 거듭제곱, 반납하면 형제 4개가 모두 비었을 때 다시 합친다.)
+// Sampling은 항상 Compare Mode (Shader에서는 sampler2DShadow)
+CLASS_PTR(ShadowAtlas);
+class ShadowAtlas
+{
+public:
+    struct Tile {
+        int x { 0 };
+        int y { 0 };
+        int size { 0 };
+        int node { -1 };
+
+        bool    IsValid(void) const
+        { return (node >= 0); };
+    };
+
+    static ShadowAtlasUPtr  Create(int size, int minTileSize);
+    ~ShadowAtlas();
+
+    // tileSize(2의 거듭제곱)의 빈 영역을 찾는다. 없으면 IsValid()가 false인 Tile
+    Tile    Allocate(int tileSize);
+    void    Free(Tile& tile);
+
+    // tile 영역만 그리도록 Framebuffer / Viewport / Scissor를 맞춘다. 다 그린 뒤 EndTiles()
+    void    BindTile(const Tile& tile) const;
+    void    EndTiles(void) const;
+    void    BindTexture(uint32_t unit) const
+    { GLStateCache::Get().BindTexture(unit, GL_TEXTURE_2D, this->m_texture); };
+
+    // Shader에서 쓰는 [0, 1] 범위의 (x, y, width, height)
+    glm::vec4   GetRect(const Tile& tile) const;
+    int         GetSize(void) const
+    { return (this->m_size); };
+    int         GetMinTileSize(void) const
+    { return (this->m_minTileSize); };
+    size_t      GetTileCount(void) const
+    { return (this->m_tileCount); };
+    // 할당된 Texel 비율
+    float       GetOccupancy(void) const
+    { return (static_cast<float>(static_cast<double>(this->m_usedTexels) / (double(this->m_size) * this->m_size))); };
+private:
+    struct Node {
+        int     x;
+        int     y;
+        int     size;
+        int     parent;
+        int     children;   // 첫 번째 자식 (4개 연속), 없으면 -1
+        bool    used;
+    };
+
+    uint32_t            m_frameBuffer { 0 };
+    uint32_t            m_texture { 0 };
+    int                 m_size { 0 };
+    int                 m_minTileSize { 0 };
+    std::vector<Node>   m_nodes;
+    std::vector<int>    m_freeChildren;     // 합쳐져서 다시 쓸 수 있는 자식 묶음
+    size_t              m_tileCount { 0 };
+    size_t              m_usedTexels { 0 };
+
+    ShadowAtlas() {};
+    bool    init(int size, int minTileSize);
+    int     AllocateNode(int node, int tileSize);
+    void    Split(int node);
+};
+
+ShadowAtlasUPtr ShadowAtlas::Create(int size, int minTileSize)
+{
+    auto    atlas = ShadowAtlasUPtr(new ShadowAtlas());
+    if (!atlas->init(size, minTileSize))
+        return (nullptr);
+    return (std::move(atlas));
+};
+
+ShadowAtlas::~ShadowAtlas()
+{
+    if (this->m_frameBuffer)
+    {
+        GLStateCache::Get().ForgetFramebuffer(this->m_frameBuffer);
+        glDeleteFramebuffers(1, &this->m_frameBuffer);
+    }
+    if (this->m_texture)
+    {
+        GLStateCache::Get().ForgetTexture(this->m_texture);
+        glDeleteTextures(1, &this->m_texture);
+    }
+};
+
+bool    ShadowAtlas::init(int size, int minTileSize)
+{
+    this->m_size = size;
+    this->m_minTileSize = minTileSize;
+    this->m_nodes.push_back({ 0, 0, size, -1, -1, false });
+
+    glGenTextures(1, &this->m_texture);
+    GLStateCache::Get().BindTexture(GL_TEXTURE_2D, this->m_texture);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT32F, size, size);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+    glGenFramebuffers(1, &this->m_frameBuffer);
+    GLStateCache::Get().BindFramebuffer(this->m_frameBuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, this->m_texture, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    auto    status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    // 할당되지 않은 곳은 "가장 먼 깊이"로 둔다.
+    glClear(GL_DEPTH_BUFFER_BIT);
+    GLStateCache::Get().BindFramebuffer(0);
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        putError("failed to complete shadow atlas framebuffer: " + std::to_string(status));
+        return (false);
+    }
+    return (true);
+};
+
+ShadowAtlas::Tile   ShadowAtlas::Allocate(int tileSize)
+{
+    Tile    tile;
+    tileSize = std::max(tileSize, this->m_minTileSize);
+    int     node = AllocateNode(0, tileSize);
+    if (node < 0)
+        return (tile);
+    tile.x = this->m_nodes[node].x;
+    tile.y = this->m_nodes[node].y;
+    tile.size = this->m_nodes[node].size;
+    tile.node = node;
+    ++this->m_tileCount;
+    this->m_usedTexels += static_cast<size_t>(tile.size) * tile.size;
+    return (tile);
+};
+
+void    ShadowAtlas::Free(Tile& tile)
+{
+    if (!tile.IsValid())
+        return ;
+    this->m_nodes[tile.node].used = false;
+    --this->m_tileCount;
+    this->m_usedTexels -= static_cast<size_t>(tile.size) * tile.size;
+
+    // 형제 4개가 모두 쪼개지지 않은 빈 Leaf이면 부모로 합친다.
+    int parent = this->m_nodes[tile.node].parent;
+    while (parent >= 0)
+    {
+        int     first = this->m_nodes[parent].children;
+        bool    mergeable = true;
+        for (int child = first; child < first + 4; ++child)
+            mergeable = mergeable && !this->m_nodes[child].used && this->m_nodes[child].children < 0;
+        if (!mergeable)
+            break;
+        this->m_freeChildren.push_back(first);
+        this->m_nodes[parent].children = -1;
+        parent = this->m_nodes[parent].parent;
+    }
+    tile = Tile();
+};
+
+int     ShadowAtlas::AllocateNode(int node, int tileSize)
+{
+    if (this->m_nodes[node].used || this->m_nodes[node].size < tileSize)
+        return (-1);
+    if (this->m_nodes[node].children < 0)
+    {
+        if (this->m_nodes[node].size == tileSize)
+        {
+            this->m_nodes[node].used = true;
+            return (node);
+        }
+        Split(node);
+    }
+    // 이미 쪼개진 곳부터 채워서 큰 빈 영역을 남긴다.
+    int first = this->m_nodes[node].children;
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        for (int child = first; child < first + 4; ++child)
+        {
+            const Node& candidate = this->m_nodes[child];
+            bool        preferred = candidate.children >= 0 || candidate.size == tileSize;
+            if (preferred != (pass == 0))
+                continue;
+            int result = AllocateNode(child, tileSize);
+            if (result >= 0)
+                return (result);
+        }
+    }
+    return (-1);
+};
+
+void    ShadowAtlas::Split(int node)
+{
+    int first;
+    if (!this->m_freeChildren.empty())
+    {
+        first = this->m_freeChildren.back();
+        this->m_freeChildren.pop_back();
+    }
+    else
+    {
+        first = static_cast<int>(this->m_nodes.size());
+        this->m_nodes.resize(this->m_nodes.size() + 4);
+    }
+    Node    parent = this->m_nodes[node];
+    int     half = parent.size / 2;
+    for (int index = 0; index < 4; ++index)
+        this->m_nodes[first + index] = { parent.x + (index & 1) * half, parent.y + (index >> 1) * half,
+                                        half, node, -1, false };
+    this->m_nodes[node].children = first;
+};
+
+void    ShadowAtlas::BindTile(const Tile& tile) const
+{
+    GLStateCache::Get().BindFramebuffer(this->m_frameBuffer);
+    GLStateCache::Get().Enable(GL_SCISSOR_TEST);
+    glViewport(tile.x, tile.y, tile.size, tile.size);
+    glScissor(tile.x, tile.y, tile.size, tile.size);
+};
+
+void    ShadowAtlas::EndTiles(void) const
+{ GLStateCache::Get().Disable(GL_SCISSOR_TEST); };
+
+glm::vec4   ShadowAtlas::GetRect(const Tile& tile) const
+{
+    float   scale = 1.0f / this->m_size;
+    return (glm::vec4(tile.x * scale, tile.y * scale, tile.size * scale, tile.size * scale));
+};
+
+#endif
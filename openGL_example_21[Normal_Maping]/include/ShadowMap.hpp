@@ -3,60 +3,148 @@
 
 #include "Texture.hpp"
 
+// 움직이지 않는 물체만 그린 Shadow Map을 언제 다시 그려야 하는지 판단한다.
+// Light 변환과 정적 물체 집합의 Version이 마지막으로 그렸을 때와 같으면 그대로 쓴다.
+struct ShadowCacheKey {
+    glm::mat4   transform { glm::mat4(1.0f) };
+    uint32_t    staticVersion { 0 };
+    bool        valid { false };
+
+    bool    Matches(const glm::mat4& lightTransform, uint32_t version) const
+    { return (valid && staticVersion == version && transform == lightTransform); };
+    void    Set(const glm::mat4& lightTransform, uint32_t version)
+    {
+        transform = lightTransform;
+        staticVersion = version;
+        valid = true;
+    };
+};
+
 CLASS_PTR(ShadowMap);
 class ShadowMap {
 public:
-    static ShadowMapUPtr    Create(int width, int height);
+    // compare : GL_TEXTURE_COMPARE_MODE + GL_LINEAR (Shader에서는 sampler2DShadow)
+    static ShadowMapUPtr    Create(int width, int height, bool compare = false);
     ~ShadowMap();
 
     const uint32_t      Get() const { return (m_frameBuffer); };
     void                Bind() const;
     const TextureSPtr    GetShadowMap() const { return (m_shadowMap); };
+    // 켜면 한 번의 texture()가 주변 2x2 Texel과 비교한 결과를 Bilinear로 섞어 준다. (Hardware PCF)
+    void                SetCompareMode(bool compare);
+    bool                IsCompareMode() const { return (m_compare); };
+    // 같은 Depth를 Compare Mode 없이 읽는 Texture View (ImGui 등 sampler2D로 볼 때 사용)
+    uint32_t            GetPreviewTexture() const { return (m_previewTexture); };
+
+    // Static Cache : 정적 물체는 BindStatic()으로 따로 그려 두고, 매 프레임 CopyStatic()으로
+    // Shadow Map에 복사한 뒤 움직이는 물체만 위에 그린다.
+    void                BindStatic() const;
+    void                CopyStatic() const;
+    ShadowCacheKey&     GetStaticKey() { return (m_staticKey); };
 
 private:
     uint32_t    m_frameBuffer { 0 };
     TextureSPtr m_shadowMap;
+    bool        m_compare { false };
+    uint32_t    m_previewTexture { 0 };
+    uint32_t        m_staticFrameBuffer { 0 };
+    TextureSPtr     m_staticShadowMap;
+    ShadowCacheKey  m_staticKey;
 
     ShadowMap() {};
     bool    Init(int width, int height);
+    static bool InitTarget(uint32_t& frameBuffer, TextureSPtr& texture, int width, int height);
 };
 
-ShadowMapUPtr   ShadowMap::Create(int width, int height) {
+ShadowMapUPtr   ShadowMap::Create(int width, int height, bool compare) {
     auto shadowMap = ShadowMapUPtr(new ShadowMap());
     if (!shadowMap->Init(width, height))
         return (nullptr);
+    shadowMap->SetCompareMode(compare);
     return (std::move(shadowMap));
 }
 
 ShadowMap::~ShadowMap() {
-    if (m_frameBuffer)
-        glDeleteFramebuffers(1, &m_frameBuffer);
+    for (auto frameBuffer : { m_frameBuffer, m_staticFrameBuffer })
+    {
+        if (!frameBuffer)
+            continue;
+        GLStateCache::Get().ForgetFramebuffer(frameBuffer);
+        glDeleteFramebuffers(1, &frameBuffer);
+    }
+    if (m_previewTexture)
+    {
+        GLStateCache::Get().ForgetTexture(m_previewTexture);
+        glDeleteTextures(1, &m_previewTexture);
+    }
 }
 
 void    ShadowMap::Bind() const
-{ glBindFramebuffer(GL_FRAMEBUFFER, this->m_frameBuffer); }
+{ GLStateCache::Get().BindFramebuffer(this->m_frameBuffer); }
+
+void    ShadowMap::BindStatic() const
+{ GLStateCache::Get().BindFramebuffer(this->m_staticFrameBuffer); }
+
+void    ShadowMap::CopyStatic() const
+{
+    glCopyImageSubData(m_staticShadowMap->Get(), GL_TEXTURE_2D, 0, 0, 0, 0,
+                    m_shadowMap->Get(), GL_TEXTURE_2D, 0, 0, 0, 0,
+                    m_shadowMap->GetWidth(), m_shadowMap->GetHeight(), 1);
+}
+
+void    ShadowMap::SetCompareMode(bool compare)
+{
+    m_compare = compare;
+    m_shadowMap->Bind();
+    if (compare)
+    {
+        m_shadowMap->SetFilter(GL_LINEAR, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    }
+    else
+    {
+        m_shadowMap->SetFilter(GL_NEAREST, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+    }
+}
 
 bool    ShadowMap::Init(int width, int height)
 {
-    glGenFramebuffers(1, &m_frameBuffer);
-    Bind();
+    if (!InitTarget(m_frameBuffer, m_shadowMap, width, height)
+        || !InitTarget(m_staticFrameBuffer, m_staticShadowMap, width, height))
+        return (false);
+    // Texture Parameter는 View마다 따로라서 m_shadowMap의 Compare Mode와 상관없이 Depth 값을 읽는다.
+    glGenTextures(1, &m_previewTexture);
+    glTextureView(m_previewTexture, GL_TEXTURE_2D, m_shadowMap->Get(), m_shadowMap->GetInternalFormat(), 0, 1, 0, 1);
+    GLStateCache::Get().BindTexture(GL_TEXTURE_2D, m_previewTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+    return (true);
+}
+
+bool    ShadowMap::InitTarget(uint32_t& frameBuffer, TextureSPtr& texture, int width, int height)
+{
+    glGenFramebuffers(1, &frameBuffer);
+    GLStateCache::Get().BindFramebuffer(frameBuffer);
 
-    m_shadowMap = Texture::Create(width, height, GL_DEPTH_COMPONENT, GL_FLOAT);
-    m_shadowMap->SetFilter(GL_NEAREST, GL_NEAREST);
-    m_shadowMap->SetWrap(GL_CLAMP_TO_BORDER, GL_CLAMP_TO_BORDER);
-    m_shadowMap->SetBorderColor(glm::vec4(1.0f));
+    texture = Texture::Create(width, height, GL_DEPTH_COMPONENT, GL_FLOAT);
+    texture->SetFilter(GL_NEAREST, GL_NEAREST);
+    texture->SetWrap(GL_CLAMP_TO_BORDER, GL_CLAMP_TO_BORDER);
+    texture->SetBorderColor(glm::vec4(1.0f));
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D,
-                        m_shadowMap->Get(), 0);
+                        texture->Get(), 0);
     glDrawBuffer(GL_NONE);
     glReadBuffer(GL_NONE);
     auto    status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
     if (status != GL_FRAMEBUFFER_COMPLETE)
     {
         putError("failed to complete shadow map framebuffer: " + status);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        GLStateCache::Get().BindFramebuffer(0);
         return (false);
     }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLStateCache::Get().BindFramebuffer(0);
     return (true);
 }
 
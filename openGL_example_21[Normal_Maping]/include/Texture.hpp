@@ -2,14 +2,40 @@
 #define TEXTURE_HPP
 
 #include "Common.hpp"
+#include "GLStateCache.hpp"
+#include "AssetCache.hpp"
+#include "PixelUploadRing.hpp"
+#include "KtxImage.hpp"
+#include "CompressedImage.hpp"
 
+// AssetCache<Texture> Key에 붙는 Load 옵션
+const uint32_t  TEXTURE_LOAD_FLIP = 1 << 0;
+const uint32_t  TEXTURE_LOAD_COMPRESSED = 1 << 1;
+const uint32_t  TEXTURE_LOAD_NORMAL_MAP = 1 << 2;
+// flags의 8bit 이상은 Alpha Test 기준값(0 ~ 255). Mip의 Alpha Coverage를 맞출 때 사용
+const uint32_t  TEXTURE_LOAD_ALPHA_CUTOFF_SHIFT = 8;
+
+// 저장 공간은 glTexStorage2D(Immutable)로 Sized Format + 미리 계산한 Level 수만큼 한 번에 잡는다.
+// 크기 / Format이 다른 Image를 다시 올리면 GL Object를 새로 만든다. (Get()의 값이 바뀐다.)
 CLASS_PTR(Texture);
 class Texture
 {
 public:
     static TextureUPtr  Create(int width, int height,
                             uint32_t format, uint32_t type = GL_UNSIGNED_BYTE);
-    static TextureUPtr  CreateFromImage(const Image* image);
+    // srgb : 색 Texture를 GL_SRGB8(_ALPHA8)로 만든다. (Sampling 때 Linear로 변환된다.)
+    static TextureUPtr  CreateFromImage(const Image* image, bool srgb = false);
+    // KTX2의 Level을 mmap 된 위치에서 바로 올린다. (Level이 1개인 비압축 형식은 Mipmap을 만든다.)
+    static TextureUPtr  CreateFromImage(const KtxImage* image);
+    // AssetCache<Texture>를 거친다. 같은 파일 / 같은 색은 한 번만 Decode, Upload 한다.
+    // .ktx2 파일은 KtxImage로 읽는다. (flipVertical은 쓰지 않는다.)
+    static TextureSPtr  Load(const std::string& filepath, bool flipVertical = true);
+    static TextureSPtr  CreateSingleColor(const glm::vec4& color);
+    // Block 압축한 Mip Chain을 그대로 올린다. (glGenerateMipmap을 쓰지 않는다.)
+    static TextureUPtr  CreateFromCompressed(const CompressedImage* image);
+    // CompressedImage::Load(.bctex Cache)를 거친다. 압축 형식을 지원하지 않으면 Load()와 같다.
+    static TextureSPtr  LoadCompressed(const std::string& filepath, bool flipVertical = true,
+                                        bool normalMap = false);
 
     ~Texture();
     const uint32_t  Get() const { return (this->m_texture); };
@@ -17,22 +43,54 @@ public:
     int             GetHeight() const { return (this->m_height); };
     int             GetFormat() const { return (this->m_format); };
     uint32_t        GetType() const { return (this->m_type); };
+    uint32_t        GetInternalFormat() const { return (this->m_internalFormat); };
+    int             GetLevelCount() const { return (this->m_levelCount); };
+    // glTexStorage2D로 잡은 모든 Level의 byte 합
+    size_t          GetMemorySize() const { return (this->m_memorySize); };
+
+    // format / type(glTexImage2D의 값) -> glTexStorage2D에 쓸 Sized Internal Format
+    static uint32_t GetSizedFormat(uint32_t format, uint32_t type, bool srgb = false);
+    static size_t   GetPixelSize(uint32_t internalFormat);
+    static bool     IsCompressedFormat(uint32_t internalFormat);
+    // 한 Level의 byte 수 (Block 압축 형식은 4x4 Block 단위)
+    static size_t   GetLevelSize(uint32_t internalFormat, int width, int height);
+    static int      GetMipLevelCount(int width, int height);
 
     void    Bind() const
-    { glBindTexture(GL_TEXTURE_2D, this->m_texture); };
+    { GLStateCache::Get().BindTexture(GL_TEXTURE_2D, this->m_texture); };
+    void    Bind(uint32_t unit) const
+    { GLStateCache::Get().BindTexture(unit, GL_TEXTURE_2D, this->m_texture); };
     void    SetFilter(uint32_t minFilter, uint32_t magFilter) const;
     void    SetWrap(uint32_t sWrap, uint32_t tWrap) const;
     void    SetBorderColor(const glm::vec4& color) const;
+    // 같은 Texture Object에 새 Image를 올린다. (Placeholder를 실제 Image로 바꿀 때 사용)
+    // ring이 있으면 Staging Buffer를 거쳐 비동기로 올린다. 이때 Mipmap은 GPU 복사가 끝난 뒤
+    // (다음 프레임 등) GenerateMipmap()으로 만드는 것이 좋다.
+    void    SetImage(const Image* image, PixelUploadRing* ring = nullptr, bool generateMipmap = true);
+    // CPU에서 만든 Mip Chain(levels[0]이 원본)을 그대로 올린다. glGenerateMipmap을 쓰지 않는다.
+    void    SetImageLevels(const std::vector<const Image*>& levels, PixelUploadRing* ring = nullptr);
+    // Level 수 / 크기 / 형식은 image를 따른다. ring이 있으면 Staging Buffer를 거친다.
+    void    SetCompressedImage(const CompressedImage* image, PixelUploadRing* ring = nullptr);
+    void    SetImage(const KtxImage* image, PixelUploadRing* ring = nullptr);
+    void    GenerateMipmap(void);
 private:
     uint32_t    m_texture{0};
 
     int         m_width {0}, m_height {0};
     uint32_t    m_format { GL_RGBA }, m_type { GL_UNSIGNED_BYTE };
+    uint32_t    m_internalFormat { GL_RGBA8 };
+    int         m_levelCount { 0 };     // 0이면 아직 저장 공간이 없다.
+    size_t      m_memorySize { 0 };
+    bool        m_srgb { false };
 
     Texture() {};
     void    CreateTexture(void);
-    void    SetTextureFromImage(const Image* image);
+    void    AllocateStorage(int width, int height, uint32_t internalFormat, int levelCount);
+    void    SetTextureFromImage(const Image* image, PixelUploadRing* ring = nullptr,
+                                bool generateMipmap = true);
     void    SetTextureFormat(int width, int height, uint32_t format, uint32_t type);
+    // 저장 공간을 잡은 뒤 Level 하나를 올린다. (Block 압축 형식이면 glCompressedTexSubImage2D)
+    void    UploadLevel(int level, const KtxImage::Level& data, PixelUploadRing* ring);
 };
 
 TextureUPtr Texture::Create(int width, int height, uint32_t format, uint32_t type)
@@ -44,18 +102,179 @@ TextureUPtr Texture::Create(int width, int height, uint32_t format, uint32_t typ
     return (std::move(texture));
 };
 
-TextureUPtr Texture::CreateFromImage(const Image* image)
+TextureUPtr Texture::CreateFromImage(const Image* image, bool srgb)
 {
     TextureUPtr texture = TextureUPtr(new Texture());
+    texture->m_srgb = srgb;
     texture->CreateTexture();
     texture->SetTextureFromImage(image);
     return (std::move(texture));
 };
 
+TextureUPtr Texture::CreateFromImage(const KtxImage* image)
+{
+    TextureUPtr texture = TextureUPtr(new Texture());
+    texture->CreateTexture();
+    texture->SetImage(image);
+    return (std::move(texture));
+};
+
+TextureSPtr Texture::Load(const std::string& filepath, bool flipVertical)
+{
+    uint32_t    flags = flipVertical ? TEXTURE_LOAD_FLIP : 0;
+    return (AssetCache<Texture>::Get().Load(AssetCache<Texture>::MakeKey(filepath, flags),
+        [&]() -> TextureSPtr
+        {
+            if (std::filesystem::path(filepath).extension() == ".ktx2")
+            {
+                auto    ktx = KtxImage::Load(filepath);
+                if (!ktx || ktx->GetFaceCount() != 1)
+                    return (nullptr);
+                return (CreateFromImage(ktx.get()));
+            }
+            auto    image = Image::Load(filepath, flipVertical);
+            if (!image)
+                return (nullptr);
+            return (CreateFromImage(image.get()));
+        }));
+};
+
+TextureUPtr Texture::CreateFromCompressed(const CompressedImage* image)
+{
+    TextureUPtr texture = TextureUPtr(new Texture());
+    texture->CreateTexture();
+    texture->SetCompressedImage(image);
+    return (std::move(texture));
+};
+
+TextureSPtr Texture::LoadCompressed(const std::string& filepath, bool flipVertical, bool normalMap)
+{
+    // BC1 / BC3는 확장이 필요하다. BC5(RGTC)는 Core
+    if (!normalMap && !GLAD_GL_EXT_texture_compression_s3tc)
+        return (Load(filepath, flipVertical));
+    uint32_t    flags = TEXTURE_LOAD_COMPRESSED | (flipVertical ? TEXTURE_LOAD_FLIP : 0)
+                        | (normalMap ? TEXTURE_LOAD_NORMAL_MAP : 0);
+    return (AssetCache<Texture>::Get().Load(AssetCache<Texture>::MakeKey(filepath, flags),
+        [&]() -> TextureSPtr
+        {
+            auto    image = CompressedImage::Load(filepath, flipVertical, normalMap);
+            if (!image || !BlockCompressor::IsSupported(image->GetFormat()))
+                return (nullptr);
+            return (CreateFromCompressed(image.get()));
+        }));
+};
+
+TextureSPtr Texture::CreateSingleColor(const glm::vec4& color)
+{
+    // Image::CreateSingleColorImage와 같은 8bit 값으로 Key를 만든다.
+    auto    clamped = glm::clamp(color * 255.0f, 0.0f, 255.0f);
+    char    key[16];
+    snprintf(key, sizeof(key), "#%02x%02x%02x%02x", static_cast<uint8_t>(clamped.r),
+            static_cast<uint8_t>(clamped.g), static_cast<uint8_t>(clamped.b), static_cast<uint8_t>(clamped.a));
+    return (AssetCache<Texture>::Get().Load(key, [&]() -> TextureSPtr
+    { return (CreateFromImage(Image::CreateSingleColorImage(4, 4, color).get())); }));
+};
+
 Texture::~Texture()
 {
     if (this->m_texture)
+    {
+        GLStateCache::Get().ForgetTexture(this->m_texture);
         glDeleteTextures(1, &this->m_texture);
+    }
+};
+
+uint32_t    Texture::GetSizedFormat(uint32_t format, uint32_t type, bool srgb)
+{
+    switch (format)
+    {
+    case GL_DEPTH_COMPONENT:
+        return (GL_DEPTH_COMPONENT24);
+    case GL_DEPTH_STENCIL:
+        return (GL_DEPTH24_STENCIL8);
+    }
+    if (type == GL_FLOAT)
+    {
+        switch (format)
+        {
+        case GL_RED: return (GL_R32F);
+        case GL_RG: return (GL_RG32F);
+        case GL_RGB: return (GL_RGB32F);
+        default: return (GL_RGBA32F);
+        }
+    }
+    if (type == GL_HALF_FLOAT)
+    {
+        switch (format)
+        {
+        case GL_RED: return (GL_R16F);
+        case GL_RG: return (GL_RG16F);
+        case GL_RGB: return (GL_RGB16F);
+        default: return (GL_RGBA16F);
+        }
+    }
+    switch (format)
+    {
+    case GL_RED: return (GL_R8);
+    case GL_RG: return (GL_RG8);
+    case GL_RGB: return (srgb ? GL_SRGB8 : GL_RGB8);
+    default: return (srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8);
+    }
+};
+
+size_t  Texture::GetPixelSize(uint32_t internalFormat)
+{
+    switch (internalFormat)
+    {
+    case GL_R8:
+        return (1);
+    case GL_RG8:
+    case GL_R16F:
+        return (2);
+    case GL_RGB8:
+    case GL_SRGB8:
+        return (3);
+    case GL_RGB16F:
+        return (6);
+    case GL_RGBA16F:
+    case GL_RG32F:
+        return (8);
+    case GL_RGB32F:
+        return (12);
+    case GL_RGBA32F:
+        return (16);
+    default:    // RGBA8, SRGB8_ALPHA8, RG16F, R32F, DEPTH_COMPONENT24, DEPTH24_STENCIL8
+        return (4);
+    }
+};
+
+bool    Texture::IsCompressedFormat(uint32_t internalFormat)
+{
+    return (internalFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT || internalFormat == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+            || internalFormat == GL_COMPRESSED_RG_RGTC2);
+};
+
+size_t  Texture::GetLevelSize(uint32_t internalFormat, int width, int height)
+{
+    switch (internalFormat)
+    {
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+        return (BlockCompressor::GetCompressedSize(BLOCK_FORMAT_BC1, width, height));
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+        return (BlockCompressor::GetCompressedSize(BLOCK_FORMAT_BC3, width, height));
+    case GL_COMPRESSED_RG_RGTC2:
+        return (BlockCompressor::GetCompressedSize(BLOCK_FORMAT_BC5, width, height));
+    default:
+        return (static_cast<size_t>(width) * height * GetPixelSize(internalFormat));
+    }
+};
+
+int     Texture::GetMipLevelCount(int width, int height)
+{
+    int levels = 1;
+    for (int size = std::max(width, height); size > 1; size >>= 1)
+        ++levels;
+    return (levels);
 };
 
 void    Texture::SetFilter(uint32_t minFilter, uint32_t magFilter) const
@@ -73,6 +292,74 @@ void    Texture::SetWrap(uint32_t sWrap, uint32_t tWrap) const
 void    Texture::SetBorderColor(const glm::vec4& color) const
 { glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, glm::value_ptr(color)); };
 
+void    Texture::SetImage(const Image* image, PixelUploadRing* ring, bool generateMipmap)
+{
+    Bind();
+    SetTextureFromImage(image, ring, generateMipmap);
+};
+
+void    Texture::SetImageLevels(const std::vector<const Image*>& levels, PixelUploadRing* ring)
+{
+    // Level 0에서 저장 공간(1x1까지)을 잡고 올린 뒤 나머지 Level을 채운다.
+    SetImage(levels[0], ring, false);
+    int levelCount = std::min(static_cast<int>(levels.size()), this->m_levelCount);
+    for (int i = 1; i < levelCount; ++i)
+    {
+        size_t  size = static_cast<size_t>(levels[i]->GetWidth()) * levels[i]->GetHeight() * levels[i]->GetChannelCount();
+        UploadLevel(i, { levels[i]->GetWidth(), levels[i]->GetHeight(), levels[i]->GetData(), size }, ring);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+};
+
+void    Texture::SetCompressedImage(const CompressedImage* image, PixelUploadRing* ring)
+{
+    Bind();
+    switch (image->GetFormat())
+    {
+    case BLOCK_FORMAT_BC1:
+        this->m_format = GL_RGB;
+        break;
+    case BLOCK_FORMAT_BC3:
+        this->m_format = GL_RGBA;
+        break;
+    case BLOCK_FORMAT_BC5:
+        this->m_format = GL_RG;
+        break;
+    }
+    this->m_type = GL_UNSIGNED_BYTE;
+    AllocateStorage(image->GetWidth(), image->GetHeight(), image->GetGLFormat(), image->GetLevelCount());
+
+    for (int i = 0; i < image->GetLevelCount(); ++i)
+        UploadLevel(i, image->GetLevel(i), ring);
+    // 모든 Level을 올렸으므로 바로 완전한 Texture가 된다.
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, this->m_levelCount - 1);
+};
+
+void    Texture::SetImage(const KtxImage* image, PixelUploadRing* ring)
+{
+    Bind();
+    this->m_format = image->GetGLFormat();
+    this->m_type = image->GetGLType();
+    // 비압축 Level 0만 있으면 나머지는 GPU에서 만든다.
+    bool    generateMipmap = !image->IsCompressed() && image->GetLevelCount() == 1;
+    int     levelCount = generateMipmap ? GetMipLevelCount(image->GetWidth(), image->GetHeight())
+                                        : image->GetLevelCount();
+    AllocateStorage(image->GetWidth(), image->GetHeight(), image->GetGLInternalFormat(), levelCount);
+    for (int i = 0; i < image->GetLevelCount(); ++i)
+        UploadLevel(i, image->GetLevel(i), ring);
+    if (generateMipmap)
+        GenerateMipmap();
+    else
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, this->m_levelCount - 1);
+};
+
+void    Texture::GenerateMipmap(void)
+{
+    Bind();
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, this->m_levelCount - 1);
+    glGenerateMipmap(GL_TEXTURE_2D);
+};
+
 void    Texture::CreateTexture(void)
 {
     glGenTextures(1, &this->m_texture);
@@ -81,7 +368,32 @@ void    Texture::CreateTexture(void)
     SetWrap(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
 };
 
-void    Texture::SetTextureFromImage(const Image* image)
+void    Texture::AllocateStorage(int width, int height, uint32_t internalFormat, int levelCount)
+{
+    // 같은 모양이면 잡아 둔 저장 공간에 내용만 다시 올린다.
+    if (this->m_levelCount == levelCount && this->m_internalFormat == internalFormat
+        && this->m_width == width && this->m_height == height)
+        return ;
+    // Immutable Storage는 다시 잡을 수 없으므로 Object를 새로 만든다.
+    if (this->m_levelCount > 0)
+    {
+        GLStateCache::Get().ForgetTexture(this->m_texture);
+        glDeleteTextures(1, &this->m_texture);
+        CreateTexture();
+    }
+
+    this->m_width = width;
+    this->m_height = height;
+    this->m_internalFormat = internalFormat;
+    this->m_levelCount = levelCount;
+    glTexStorage2D(GL_TEXTURE_2D, levelCount, internalFormat, width, height);
+
+    this->m_memorySize = 0;
+    for (int level = 0; level < levelCount; ++level)
+        this->m_memorySize += GetLevelSize(internalFormat, std::max(1, width >> level), std::max(1, height >> level));
+};
+
+void    Texture::SetTextureFromImage(const Image* image, PixelUploadRing* ring, bool generateMipmap)
 {
     GLenum format = GL_RGBA;
     switch (image->GetChannelCount())
@@ -98,25 +410,49 @@ void    Texture::SetTextureFromImage(const Image* image)
         format = GL_RGB;
         break;
     }
-    this->m_width = image->GetWidth();
-    this->m_height = image->GetHeight();
     this->m_format = format;
     this->m_type = GL_UNSIGNED_BYTE;
+    AllocateStorage(image->GetWidth(), image->GetHeight(), GetSizedFormat(format, this->m_type, this->m_srgb),
+                    GetMipLevelCount(image->GetWidth(), image->GetHeight()));
 
-    glTexImage2D(GL_TEXTURE_2D, 0, this->m_format, this->m_width, this->m_height, 0,
-                this->m_format, this->m_type, image->GetData());
-    glGenerateMipmap(GL_TEXTURE_2D);
+    size_t  size = static_cast<size_t>(this->m_width) * this->m_height * image->GetChannelCount();
+    UploadLevel(0, { this->m_width, this->m_height, image->GetData(), size }, ring);
+    if (generateMipmap)
+        GenerateMipmap();
+    else
+    {
+        // Mipmap을 만들기 전까지 Level 0만 써서 Texture가 불완전(검은색)해지지 않게 한다.
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    }
 };
 
 void    Texture::SetTextureFormat(int width, int height, uint32_t format, uint32_t type)
 {
-    this->m_width = width;
-    this->m_height = height;
+    // Render Target / Shadow Map : Mipmap 없이 Level 1개
     this->m_format = format;
     this->m_type = type;
+    AllocateStorage(width, height, GetSizedFormat(format, type), 1);
+};
 
-    glTexImage2D(GL_TEXTURE_2D, 0, this->m_format, this->m_width, this->m_height, 0,
-                this->m_format, this->m_type, nullptr);
+void    Texture::UploadLevel(int level, const KtxImage::Level& data, PixelUploadRing* ring)
+{
+    const void*                 pixels = data.data;
+    PixelUploadRing::Allocation allocation;
+    bool                        staged = ring && ring->Allocate(data.size, allocation);
+    if (staged)
+    {
+        // 내용은 Staging Buffer의 Offset에서 읽게 한다.
+        memcpy(allocation.data, data.data, data.size);
+        ring->Bind();
+        pixels = reinterpret_cast<const void*>(allocation.offset);
+    }
+    if (IsCompressedFormat(this->m_internalFormat))
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, data.width, data.height, this->m_internalFormat,
+                                static_cast<GLsizei>(data.size), pixels);
+    else
+        glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, data.width, data.height, this->m_format, this->m_type, pixels);
+    if (staged)
+        ring->Unbind();
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,152 @@
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include "Common.hpp"
+
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <atomic>
+
+// CPU 작업용 Worker Thread Pool
+// Get()은 (코어 수 - 1)개의 Worker를 가진 공용 Pool. 호출한 Thread도 작업 한 조각을 맡는다.
+CLASS_PTR(ThreadPool);
+class ThreadPool
+{
+public:
+    static ThreadPoolUPtr   Create(uint32_t threadCount = 0);
+    static ThreadPool&      Get(void);
+
+    ~ThreadPool();
+    uint32_t    GetThreadCount(void) const
+    { return (static_cast<uint32_t>(this->m_threads.size())); };
+
+    void        Submit(std::function<void()> job);
+    // [0, count)를 (Worker 수 + 1)개 이하의 조각으로 나눠 실행하고 모두 끝날 때까지 기다린다.
+    // func(chunk, begin, end) : chunk는 0부터 시작하는 조각 번호 (Thread별 임시 Buffer 인덱스로 쓴다.)
+    // 호출한 Thread도 남은 조각을 가져가므로 Worker 안에서 다시 호출해도 멈추지 않는다.
+    uint32_t    GetChunkCount(size_t count, size_t minChunkSize) const;
+    void        ParallelFor(size_t count, size_t minChunkSize,
+                            const std::function<void(uint32_t, size_t, size_t)>& func);
+private:
+    std::vector<std::thread>            m_threads;
+    std::deque<std::function<void()>>   m_jobs;
+    std::mutex                          m_mutex;
+    std::condition_variable             m_condition;
+    bool                                m_stop { false };
+
+    ThreadPool() {};
+    void    init(uint32_t threadCount);
+    void    WorkerLoop(void);
+};
+
+ThreadPoolUPtr  ThreadPool::Create(uint32_t threadCount)
+{
+    ThreadPoolUPtr  pool = ThreadPoolUPtr(new ThreadPool());
+    pool->init(threadCount);
+    return (std::move(pool));
+};
+
+ThreadPool& ThreadPool::Get(void)
+{
+    static ThreadPoolUPtr   instance = Create();
+    return (*instance);
+};
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->m_mutex);
+        this->m_stop = true;
+    }
+    this->m_condition.notify_all();
+    for (auto& thread : this->m_threads)
+        thread.join();
+};
+
+void    ThreadPool::init(uint32_t threadCount)
+{
+    if (threadCount == 0)
+    {
+        uint32_t    cores = std::thread::hardware_concurrency();
+        threadCount = cores > 1 ? cores - 1 : 1;
+    }
+    for (uint32_t i = 0; i < threadCount; ++i)
+        this->m_threads.emplace_back(&ThreadPool::WorkerLoop, this);
+};
+
+void    ThreadPool::WorkerLoop(void)
+{
+    while (true)
+    {
+        std::function<void()>   job;
+        {
+            std::unique_lock<std::mutex>    lock(this->m_mutex);
+            this->m_condition.wait(lock, [this]() { return (this->m_stop || !this->m_jobs.empty()); });
+            if (this->m_stop && this->m_jobs.empty())
+                return ;
+            job = std::move(this->m_jobs.front());
+            this->m_jobs.pop_front();
+        }
+        job();
+    }
+};
+
+void    ThreadPool::Submit(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> lock(this->m_mutex);
+        this->m_jobs.push_back(std::move(job));
+    }
+    this->m_condition.notify_one();
+};
+
+uint32_t    ThreadPool::GetChunkCount(size_t count, size_t minChunkSize) const
+{
+    size_t  maxChunks = GetThreadCount() + 1;
+    size_t  chunks = std::max<size_t>(1, count / std::max<size_t>(1, minChunkSize));
+    return (static_cast<uint32_t>(std::min(maxChunks, chunks)));
+};
+
+void    ThreadPool::ParallelFor(size_t count, size_t minChunkSize,
+                                const std::function<void(uint32_t, size_t, size_t)>& func)
+{
+    uint32_t    chunks = GetChunkCount(count, minChunkSize);
+    if (chunks <= 1)
+    {
+        func(0, 0, count);
+        return ;
+    }
+
+    // 조각 번호는 먼저 가져간 Thread가 실행한다. 늦게 시작한 Job은 남은 조각이 없으면 바로 끝나고
+    // func에는 손대지 않으므로, 공유 상태만 shared_ptr로 살려 둔다.
+    struct State {
+        std::atomic<uint32_t>   next { 0 };
+        uint32_t                done { 0 };
+        std::mutex              mutex;
+        std::condition_variable condition;
+    };
+    auto    state = std::make_shared<State>();
+    size_t  chunkSize = (count + chunks - 1) / chunks;
+    auto    runChunks = [state, chunks, chunkSize, count, &func]()
+    {
+        for (uint32_t chunk = state->next++; chunk < chunks; chunk = state->next++)
+        {
+            size_t  begin = std::min(count, chunk * chunkSize);
+            func(chunk, begin, std::min(count, begin + chunkSize));
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (++state->done == chunks)
+                state->condition.notify_one();
+        }
+    };
+    for (uint32_t chunk = 1; chunk < chunks; ++chunk)
+        Submit(runChunks);
+    runChunks();
+
+    // 남은 조각은 모두 다른 Thread가 실행 중이다.
+    std::unique_lock<std::mutex>    lock(state->mutex);
+    state->condition.wait(lock, [&state, chunks]() { return (state->done == chunks); });
+};
+
+#endif
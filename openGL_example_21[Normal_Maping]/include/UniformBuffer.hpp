@@ -0,0 +1,63 @@
+#ifndef UNIFORMBUFFER_HPP
+#define UNIFORMBUFFER_HPP
+
+#include "Common.hpp"
+#include "Buffer.hpp"
+
+// Shader의 layout (std140, binding = N) 값과 맞춰야 한다.
+enum UniformBinding : uint32_t
+{
+    CAMERA_BINDING = 0,
+    LIGHT_BINDING = 1,
+};
+
+CLASS_PTR(UniformBuffer);
+class UniformBuffer
+{
+public:
+    static UniformBufferUPtr    Create(uint32_t binding, size_t size);
+
+    uint32_t    Get(void) const
+    { return (this->m_buffer->Get()); };
+    uint32_t    GetBinding(void) const
+    { return (this->m_binding); };
+    size_t      GetSize(void) const
+    { return (this->m_buffer->GetStride()); };
+    void        BindBase(void) const
+    { GLStateCache::Get().BindBufferBase(GL_UNIFORM_BUFFER, this->m_binding, this->m_buffer->Get()); };
+
+    void        Update(const void* data, size_t size, size_t offset = 0) const
+    { this->m_buffer->SetData(data, size, offset); };
+    // C++ 구조체는 std140 규칙에 맞게 padding을 직접 넣어서 사용한다.
+    template <typename T>
+    void        Update(const T& block) const
+    { Update(&block, sizeof(T)); };
+private:
+    BufferUPtr  m_buffer;
+    uint32_t    m_binding { 0 };
+
+    UniformBuffer() {};
+    bool    init(uint32_t binding, size_t size);
+};
+
+UniformBufferUPtr   UniformBuffer::Create(uint32_t binding, size_t size)
+{
+    UniformBufferUPtr   uniformBuffer = UniformBufferUPtr(new UniformBuffer());
+    if (!uniformBuffer->init(binding, size))
+        return (nullptr);
+    return (std::move(uniformBuffer));
+};
+
+bool    UniformBuffer::init(uint32_t binding, size_t size)
+{
+    this->m_binding = binding;
+    this->m_buffer = Buffer::CreateWithData(GL_UNIFORM_BUFFER, GL_DYNAMIC_DRAW,
+                                            nullptr, size, 1);
+    if (!this->m_buffer)
+        return (false);
+    // binding point는 고정이므로 한 번만 연결한다.
+    BindBase();
+    return (true);
+};
+
+#endif
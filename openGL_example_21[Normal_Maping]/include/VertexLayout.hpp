@@ -2,6 +2,7 @@
 #define VERTEXLAYOUR_HPP
 
 #include "Common.hpp"
+#include "GLStateCache.hpp"
 
 CLASS_PTR(VertexLayout);
 class VertexLayout
@@ -13,7 +14,7 @@ public:
     uint32_t    Get(void) const
     { return (this->m_VAO); };
     void    Bind(void) const
-    { glBindVertexArray(this->m_VAO); };
+    { GLStateCache::Get().BindVertexArray(this->m_VAO); };
     void    SetAttrib(uint32_t attribIndex, int count,
                         uint32_t type, bool normalized,
                         size_t stride, uint64_t offset) const;
@@ -35,7 +36,10 @@ VertexLayoutUPtr    VertexLayout::Create(void)
 VertexLayout::~VertexLayout()
 {
     if (this->m_VAO)
+    {
+        GLStateCache::Get().ForgetVertexArray(this->m_VAO);
         glDeleteVertexArrays(1, &this->m_VAO);
+    }
 };
 
 void    VertexLayout::SetAttrib(uint32_t attribIndex, int count,
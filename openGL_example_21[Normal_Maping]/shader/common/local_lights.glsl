@@ -0,0 +1,95 @@
+// 여러 개의 Spot / Point Light (LocalLightSet). Shadow는 모두 한 장의 Atlas에 들어 있다.
+// shadow_kernel.glsl, specular.glsl 다음에 include 한다.
+struct LocalLight {
+    vec4    positionRange;      // xyz : 위치, w : 영향 거리
+    vec4    directionType;      // xyz : 방향, w : 0 Spot / 1 Point
+    vec4    color;
+    vec4    cutoff;             // x : 안쪽 cos, y : 바깥쪽 cos, z : Shadow 면 수 (0이면 없음), w : tan(반 화각)
+    vec4    rects[6];           // Atlas 안의 (x, y, width, height), [0, 1]
+    mat4    transforms[6];      // Point Light : +X, -X, +Y, -Y, +Z, -Z
+};
+
+layout (std430, binding = 2) readonly buffer LocalLightBlock {
+    LocalLight  localLights[];
+};
+
+uniform int             localLightCount;
+uniform sampler2DShadow shadowAtlas;
+
+// 중심에서 주축으로 면을 고른다. (LocalLightSet::ComputeTransforms와 같은 순서)
+int     LocalLightFace(vec3 toFrag)
+{
+    vec3    axis = abs(toFrag);
+    if (axis.x >= axis.y && axis.x >= axis.z)
+        return (toFrag.x > 0.0 ? 0 : 1);
+    if (axis.y >= axis.z)
+        return (toFrag.y > 0.0 ? 2 : 3);
+    return (toFrag.z > 0.0 ? 4 : 5);
+}
+
+float   LocalLightShadow(int index, vec3 fragPos, vec3 normal, vec3 lightDir, float dist)
+{
+    LocalLight  localLight = localLights[index];
+    if (localLight.cutoff.z < 0.5)
+        return (0.0);
+    int     face = localLight.directionType.w > 0.5 ? LocalLightFace(fragPos - localLight.positionRange.xyz) : 0;
+    vec4    rect = localLight.rects[face];
+
+    // Texel 하나가 덮는 World 크기만큼 Normal 방향으로 밀어서 비교한다.
+    vec2    atlasSize = vec2(textureSize(shadowAtlas, 0));
+    float   texelWorld = 2.0 * dist * localLight.cutoff.w / (rect.z * atlasSize.x);
+    float   cosTheta = clamp(dot(normal, lightDir), 0.0, 1.0);
+    vec3    offsetPos = fragPos + normal * texelWorld * (1.0 + 2.0 * (1.0 - cosTheta));
+    vec4    clipPos = localLight.transforms[face] * vec4(offsetPos, 1.0);
+    vec3    projCoords = clipPos.xyz / clipPos.w * 0.5 + 0.5;
+    if (any(lessThan(projCoords, vec3(0.0))) || any(greaterThan(projCoords, vec3(1.0))))
+        return (0.0);
+
+    // Kernel이 옆 Tile을 읽지 않도록 Tile 안쪽(반 Texel)으로 자른다.
+    vec2    texelSize = 1.0 / atlasSize;
+    vec2    rectMin = rect.xy + texelSize * 0.5;
+    vec2    rectMax = rect.xy + rect.zw - texelSize * 0.5;
+    vec2    uv = rect.xy + projCoords.xy * rect.zw;
+    mat2    rotation = ShadowKernelRotation(gl_FragCoord.xy);
+    int     sampleCount = clamp(shadowSampleCount, 1, SHADOW_MAX_SAMPLE_COUNT);
+    float   lit = 0.0;
+    for (int i = 0; i < sampleCount; ++i)
+    {
+        vec2    sampleUV = clamp(uv + ShadowKernelOffset(rotation, i, texelSize), rectMin, rectMax);
+        lit += texture(shadowAtlas, vec3(sampleUV, projCoords.z));
+    }
+    return (1.0 - lit / float(sampleCount));
+}
+
+vec3    LocalLighting(vec3 fragPos, vec3 normal, vec3 viewDir, vec3 albedo, vec3 specColor, float shininess)
+{
+    vec3    result = vec3(0.0);
+    for (int index = 0; index < localLightCount; ++index)
+    {
+        LocalLight  localLight = localLights[index];
+        vec3    toLight = localLight.positionRange.xyz - fragPos;
+        float   dist = length(toLight);
+        float   range = localLight.positionRange.w;
+        if (dist >= range)
+            continue;
+        vec3    lightDir = toLight / dist;
+
+        // 영향 거리에서 0이 되도록 부드럽게 줄인다.
+        float   falloff = clamp(1.0 - pow(dist / range, 4.0), 0.0, 1.0);
+        float   attenuation = falloff * falloff / (1.0 + dist * dist);
+        if (localLight.directionType.w < 0.5)
+        {
+            float   theta = dot(lightDir, -localLight.directionType.xyz);
+            attenuation *= clamp((theta - localLight.cutoff.y) / (localLight.cutoff.x - localLight.cutoff.y),
+                                0.0, 1.0);
+        }
+        if (attenuation <= 0.0)
+            continue;
+
+        float   diff = max(dot(normal, lightDir), 0.0);
+        float   spec = SpecularTerm(lightDir, viewDir, normal, shininess);
+        float   shadow = LocalLightShadow(index, fragPos, normal, lightDir, dist);
+        result += (diff * albedo + spec * specColor) * localLight.color.rgb * attenuation * (1.0 - shadow);
+    }
+    return (result);
+}
@@ -0,0 +1,32 @@
+// SHADOW_COMPARE일 때 쓰는 PCF Kernel.
+// 각 Tap은 sampler2DShadow의 Bilinear 비교(2x2 Texel)라서 적은 Tap으로도 부드럽다.
+// Fragment마다 Kernel을 돌려서 남는 Banding을 Noise로 바꾼다.
+const int   SHADOW_MAX_SAMPLE_COUNT = 16;
+const vec2  poissonDisk[SHADOW_MAX_SAMPLE_COUNT] = vec2[](
+    vec2(-0.94201624, -0.39906216), vec2(0.94558609, -0.76890725),
+    vec2(-0.09418410, -0.92938870), vec2(0.34495938, 0.29387760),
+    vec2(-0.91588581, 0.45771432), vec2(-0.81544232, -0.87912464),
+    vec2(-0.38277543, 0.27676845), vec2(0.97484398, 0.75648379),
+    vec2(0.44323325, -0.97511554), vec2(0.53742981, -0.47373420),
+    vec2(-0.26496911, -0.41893023), vec2(0.79197514, 0.19090188),
+    vec2(-0.24188840, 0.99706507), vec2(-0.81409955, 0.91437590),
+    vec2(0.19984126, 0.78641367), vec2(0.14383161, -0.14100790)
+);
+
+uniform int     shadowSampleCount;      // 1 ~ SHADOW_MAX_SAMPLE_COUNT
+uniform float   shadowFilterRadius;     // Texel 단위
+
+// Interleaved Gradient Noise (화면 좌표마다 다른 회전)
+mat2    ShadowKernelRotation(vec2 fragCoord)
+{
+    float   noise = fract(52.9829189 * fract(dot(fragCoord, vec2(0.06711056, 0.00583715))));
+    float   angle = noise * 6.28318531;
+    float   s = sin(angle);
+    float   c = cos(angle);
+    return (mat2(c, s, -s, c));
+}
+
+vec2    ShadowKernelOffset(mat2 rotation, int index, vec2 texelSize)
+{
+    return (rotation * poissonDisk[index] * shadowFilterRadius * texelSize);
+}
@@ -0,0 +1,11 @@
+// BLINN이 정의되면 Blinn-Phong, 아니면 Phong
+float   SpecularTerm(vec3 lightDir, vec3 viewDir, vec3 normal, float shininess)
+{
+#ifdef BLINN
+    vec3    halfDir = normalize(lightDir + viewDir);
+    return (pow(max(dot(halfDir, normal), 0.0), shininess));
+#else
+    vec3    reflectDir = reflect(-lightDir, normal);
+    return (pow(max(dot(viewDir, reflectDir), 0.0), shininess));
+#endif
+}
@@ -0,0 +1,23 @@
+layout (std140, binding = 0) uniform CameraBlock {
+    mat4    view;
+    mat4    projection;
+    vec3    viewPos;
+};
+
+layout (std140, binding = 1) uniform LightBlock {
+    mat4    transform;
+    vec3    position;
+    int     directional;
+    vec3    direction;
+    int     blinn;
+    vec3    attenuation;
+    vec3    ambient;
+    vec3    diffuse;
+    vec3    specular;
+    vec2    cutoff;
+    // Directional Light의 Cascaded Shadow Map
+    mat4    cascadeTransforms[4];
+    vec4    cascadeSplits;      // Cascade가 끝나는 view space 깊이
+    vec4    cascadeTexelSizes;  // Cascade의 Texel 하나가 덮는 World 크기
+    int     cascadeCount;
+} light;
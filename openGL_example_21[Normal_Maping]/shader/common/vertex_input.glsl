@@ -0,0 +1,40 @@
+// Mesh Vertex 입력 : PACKED_VERTEX면 PackedVertex(Mesh.hpp) 형식을 Decode 한다.
+layout (location = 0) in vec3   aPos;
+#ifdef PACKED_VERTEX
+layout (location = 1) in vec2   aNormal;    // Octahedral (snorm16 x 2)
+layout (location = 2) in vec2   aTexCoord;  // half float x 2
+layout (location = 3) in vec4   aTangent;   // Octahedral xy, w = Bitangent 부호 (INT_2_10_10_10_REV)
+
+vec3    DecodeOctahedral(vec2 e)
+{
+    vec3    n = vec3(e.x, e.y, 1.0 - abs(e.x) - abs(e.y));
+    float   t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return (normalize(n));
+}
+
+vec3    GetVertexNormal()
+{
+    return (DecodeOctahedral(aNormal));
+}
+
+vec4    GetVertexTangent()
+{
+    return (vec4(DecodeOctahedral(aTangent.xy), aTangent.w));
+}
+#else
+layout (location = 1) in vec3   aNormal;
+layout (location = 2) in vec2   aTexCoord;
+layout (location = 3) in vec4   aTangent;   // w = Bitangent 부호
+
+vec3    GetVertexNormal()
+{
+    return (aNormal);
+}
+
+vec4    GetVertexTangent()
+{
+    return (aTangent);
+}
+#endif
@@ -6,15 +6,8 @@ in vec3 position;
 
 out vec4 fragColor;
 
-struct Light {
-    vec3 position;
-    vec3 direction;
-    vec2 cutoff;
-    vec3 attenuation;
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
+#include "common/uniform_blocks.glsl"
+#include "common/specular.glsl"
 
 struct Material {
     sampler2D diffuse;
@@ -22,10 +15,7 @@ struct Material {
     float shininess;
 };
 
-uniform vec3 viewPos;
 uniform Material material;
-uniform Light light;
-uniform int blinn;
 
 void main() {
     vec3 texColor = texture2D(material.diffuse, texCoord).xyz;
@@ -48,19 +38,8 @@ void main() {
         vec3 diffuse = diff * texColor * light.diffuse;
 
         vec3 specColor = texture2D(material.specular, texCoord).xyz;
-        float spec = 0.0;
-        if (blinn == 0)
-        {
-            vec3 viewDir = normalize(viewPos - position);
-            vec3 reflectDir = reflect(-lightDir, pixelNorm);
-            spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-        }
-        else
-        {
-            vec3 viewDir = normalize(viewPos - position);
-            vec3 halfDir = normalize(lightDir + viewDir);
-            spec = pow(max(dot(halfDir, pixelNorm), 0.0), material.shininess);
-        }
+        vec3 viewDir = normalize(viewPos - position);
+        float spec = SpecularTerm(lightDir, viewDir, pixelNorm, material.shininess);
         vec3 specular = spec * specColor * light.specular;
 
         result += (diffuse + specular) * intensity;
@@ -9,16 +9,10 @@ in VS_OUT {
     vec4    fragPosLight;
 } fs_in;
 
-struct Light {
-    int     directional;
-    vec3    position;
-    vec3    direction;
-    vec2    cutoff;
-    vec3    attenuation;
-    vec3    ambient;
-    vec3    diffuse;
-    vec3    specular;
-};
+#include "common/uniform_blocks.glsl"
+#include "common/specular.glsl"
+#include "common/shadow_kernel.glsl"
+#include "common/local_lights.glsl"
 
 struct Material {
     sampler2D   diffuse;
@@ -26,11 +20,60 @@ struct Material {
     float       shininess;
 };
 
-uniform vec3        viewPos;
-uniform Light       light;
 uniform Material    material;
-uniform int         blinn;
-uniform sampler2D   shadowMap;
+
+#ifdef DIRECTIONAL_LIGHT
+#ifdef SHADOW_COMPARE
+uniform sampler2DArrayShadow    cascadeShadowMap;
+#else
+uniform sampler2DArray          cascadeShadowMap;
+#endif
+
+// view space 깊이로 Cascade를 고르고, 그 Layer에서 PCF
+float ShadowCalculation(vec3 fragPos, vec3 normal, vec3 lightDir)
+{
+    float   viewDepth = -(view * vec4(fragPos, 1.0)).z;
+    int     cascade = 0;
+    while (cascade < light.cascadeCount - 1 && viewDepth > light.cascadeSplits[cascade])
+        ++cascade;
+    if (viewDepth > light.cascadeSplits[light.cascadeCount - 1])
+        return (0.0);
+
+    // Cascade마다 Texel 크기가 달라서 Depth Bias 대신 Texel 크기만큼 Normal 방향으로 밀어서 비교한다.
+    float   cosTheta = clamp(dot(normal, lightDir), 0.0, 1.0);
+    vec3    offsetPos = fragPos + normal * light.cascadeTexelSizes[cascade] * (1.0 + 2.0 * (1.0 - cosTheta));
+    vec3    projCoords = (light.cascadeTransforms[cascade] * vec4(offsetPos, 1.0)).xyz * 0.5 + 0.5;
+    if (projCoords.z > 1.0)
+        return (0.0);
+    float   currentDepth = projCoords.z - 0.0005;
+    vec2    texelSize = 1.0 / vec2(textureSize(cascadeShadowMap, 0).xy);
+#ifdef SHADOW_COMPARE
+    mat2    rotation = ShadowKernelRotation(gl_FragCoord.xy);
+    int     sampleCount = clamp(shadowSampleCount, 1, SHADOW_MAX_SAMPLE_COUNT);
+    float   lit = 0.0;
+    for (int i = 0; i < sampleCount; ++i)
+        lit += texture(cascadeShadowMap, vec4(projCoords.xy + ShadowKernelOffset(rotation, i, texelSize),
+                                            cascade, currentDepth));
+    return (1.0 - lit / float(sampleCount));
+#else
+    float   shadow = 0.0;
+    for (int x = -1; x <= 1; ++x)
+    {
+        for (int y = -1; y <= 1; ++y)
+        {
+            float pcfDepth = texture(cascadeShadowMap, vec3(projCoords.xy + vec2(x, y) * texelSize, cascade)).r;
+            shadow += currentDepth > pcfDepth ? 1.0 : 0.0;
+        }
+    }
+    return (shadow / 9.0);
+#endif
+};
+#else
+#ifdef SHADOW_COMPARE
+uniform sampler2DShadow shadowMap;
+#else
+uniform sampler2D       shadowMap;
+#endif
 
 float ShadowCalculation(vec4 fragPosLight, vec3 normal, vec3 lightDir)
 {
@@ -38,15 +81,22 @@ float ShadowCalculation(vec4 fragPosLight, vec3 normal, vec3 lightDir)
     vec3    projCoords = fragPosLight.xyz / fragPosLight.w;
     // transform to [0,1] range, from [-1,1] range
     projCoords = projCoords * 0.5 + 0.5;
-    // get closest depth value from light’s perspective (using
-    // [0,1] range fragPosLight as coords)
-    float   closestDepth = texture(shadowMap, projCoords.xy).r;
     // get depth of current fragment from light’s perspective
     float   currentDepth = projCoords.z;
     // check whether current frag pos is in shadow
     float   bias = max(0.05 * (1.0 - dot(normal, lightDir)), 0.005);
-    float shadow = 0.0;
     vec2 texelSize = 1.0 / textureSize(shadowMap, 0);
+#ifdef SHADOW_COMPARE
+    // texture()가 (currentDepth - bias) <= 저장된 깊이인 비율을 2x2 Bilinear로 돌려준다.
+    mat2    rotation = ShadowKernelRotation(gl_FragCoord.xy);
+    int     sampleCount = clamp(shadowSampleCount, 1, SHADOW_MAX_SAMPLE_COUNT);
+    float   lit = 0.0;
+    for (int i = 0; i < sampleCount; ++i)
+        lit += texture(shadowMap, vec3(projCoords.xy + ShadowKernelOffset(rotation, i, texelSize),
+                                    currentDepth - bias));
+    return (1.0 - lit / float(sampleCount));
+#else
+    float shadow = 0.0;
     for(int x = -1; x <= 1; ++x)
     {
         for (int y = -1; y <= 1; ++y)
@@ -57,7 +107,9 @@ float ShadowCalculation(vec4 fragPosLight, vec3 normal, vec3 lightDir)
     }
     shadow /= 9.0;
     return (shadow);
+#endif
 };
+#endif
 
 void    main()
 {
@@ -68,19 +120,18 @@ void    main()
     vec3    lightDir;
     float   intensity = 1.0;
     float   attenuation = 1.0;
-    if (light.directional == 1)
-        lightDir = normalize(-light.direction);
-    else
-    {
-        float   dist = length(light.position - fs_in.fragPos);
-        vec3    distPoly = vec3(1.0, dist, dist*dist);
-        attenuation = 1.0 / dot(distPoly, light.attenuation);
-        lightDir = (light.position - fs_in.fragPos) / dist;
-        
-        float   theta = dot(lightDir, normalize(-light.direction));
-        intensity = clamp((theta - light.cutoff[1]) / (light.cutoff[0] - light.cutoff[1]),
-                        0.0, 1.0);
-    }
+#ifdef DIRECTIONAL_LIGHT
+    lightDir = normalize(-light.direction);
+#else
+    float   dist = length(light.position - fs_in.fragPos);
+    vec3    distPoly = vec3(1.0, dist, dist*dist);
+    attenuation = 1.0 / dot(distPoly, light.attenuation);
+    lightDir = (light.position - fs_in.fragPos) / dist;
+
+    float   theta = dot(lightDir, normalize(-light.direction));
+    intensity = clamp((theta - light.cutoff[1]) / (light.cutoff[0] - light.cutoff[1]),
+                    0.0, 1.0);
+#endif
 
     if (intensity > 0.0)
     {
@@ -89,25 +140,21 @@ void    main()
         vec3    diffuse = diff * texColor * light.diffuse;
 
         vec3    specColor = texture2D(material.specular, fs_in.texCoord).xyz;
-        float   spec = 0.0;
-        if (blinn == 0)
-        {
-            vec3    viewDir = normalize(viewPos - fs_in.fragPos);
-            vec3    reflectDir = reflect(-lightDir, pixelNorm);
-            spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-        }
-        else
-        {
-            vec3    viewDir = normalize(viewPos - fs_in.fragPos);
-            vec3    halfDir = normalize(lightDir + viewDir);
-            spec = pow(max(dot(halfDir, pixelNorm), 0.0), material.shininess);
-        }
+        vec3    viewDir = normalize(viewPos - fs_in.fragPos);
+        float   spec = SpecularTerm(lightDir, viewDir, pixelNorm, material.shininess);
         vec3    specular = spec * specColor * light.specular;
+#ifdef DIRECTIONAL_LIGHT
+        float   shadow = ShadowCalculation(fs_in.fragPos, pixelNorm, lightDir);
+#else
         float   shadow = ShadowCalculation(fs_in.fragPosLight, pixelNorm, lightDir);
+#endif
 
         result += (diffuse + specular) * intensity * (1.0 - shadow);
     }
 
     result *= attenuation;
+    // Shadow Atlas를 쓰는 나머지 Light들
+    result += LocalLighting(fs_in.fragPos, normalize(fs_in.normal), normalize(viewPos - fs_in.fragPos), texColor,
+                            texture2D(material.specular, fs_in.texCoord).xyz, material.shininess);
     fragColor = vec4(result, 1.0);
 }
\ No newline at end of file
@@ -1,8 +1,6 @@
 #version 460 core
 
-layout (location = 0) in vec3   aPos;
-layout (location = 1) in vec3   aNormal;
-layout (location = 2) in vec2   aTexCoord;
+#include "common/vertex_input.glsl"
 
 out VS_OUT {
     vec3    fragPos;
@@ -13,12 +11,13 @@ out VS_OUT {
 
 uniform mat4    transform;
 uniform mat4    modelTransform;
-uniform mat4    lightTransform;
+
+#include "common/uniform_blocks.glsl"
 
 void    main() {
     gl_Position = transform * vec4(aPos, 1.0);
     vs_out.fragPos = vec3(modelTransform * vec4(aPos, 1.0));
-    vs_out.normal = transpose(inverse(mat3(modelTransform))) * aNormal;
+    vs_out.normal = transpose(inverse(mat3(modelTransform))) * GetVertexNormal();
     vs_out.texCoord = aTexCoord;
-    vs_out.fragPosLight = lightTransform * vec4(vs_out.fragPos, 1.0);
+    vs_out.fragPosLight = light.transform * vec4(vs_out.fragPos, 1.0);
 }
\ No newline at end of file
@@ -3,11 +3,10 @@
 in vec2     texCoord;
 in vec3     position;
 in vec3     normal;
-in vec3     tangent;
+in vec4     tangent;
 out vec4    fragColor;
 
-uniform vec3    viewPos;
-uniform vec3    lightPos;
+#include "common/uniform_blocks.glsl"
 
 uniform sampler2D   diffuse;
 uniform sampler2D   normalMap;
@@ -15,16 +14,18 @@ uniform sampler2D   normalMap;
 void    main()
 {
   vec3  texColor = texture(diffuse, texCoord).xyz;
-  vec3  texNorm = normalize(texture(normalMap, texCoord).xyz * 2.0 - 1.0);
+  // BC5 Normal Map은 RG만 저장하므로 Z는 항상 XY로부터 복원한다. (RGB Normal Map에서도 같은 값)
+  vec2  texNormXY = texture(normalMap, texCoord).rg * 2.0 - 1.0;
+  vec3  texNorm = vec3(texNormXY, sqrt(max(1.0 - dot(texNormXY, texNormXY), 0.0)));
   vec3  N = normalize(normal);
-  vec3  T = normalize(tangent);
-  vec3  B = cross(N, T);
+  vec3  T = normalize(tangent.xyz);
+  vec3  B = cross(N, T) * tangent.w;
   mat3  TBN = mat3(T, B, N);
   vec3  pixelNorm = normalize(TBN * texNorm);
 
   vec3  ambient = texColor * 0.2;
 
-  vec3  lightDir = normalize(lightPos - position);
+  vec3  lightDir = normalize(light.position - position);
   float diff = max(dot(pixelNorm, lightDir), 0.0);
   vec3  diffuse = diff * texColor * 0.8;
 
@@ -1,9 +1,6 @@
 #version 460 core
 
-layout (location = 0) in vec3   aPos;
-layout (location = 1) in vec3   aNormal;
-layout (location = 2) in vec2   aTexCoord;
-layout (location = 3) in vec3   aTangent;
+#include "common/vertex_input.glsl"
 
 uniform mat4    transform;
 uniform mat4    modelTransform;
@@ -11,7 +8,7 @@ uniform mat4    modelTransform;
 out vec2    texCoord;
 out vec3    position;
 out vec3    normal;
-out vec3    tangent;
+out vec4    tangent;   // w = Bitangent 부호
 
 void    main()
 {
@@ -20,6 +17,7 @@ void    main()
     position = (modelTransform * vec4(aPos, 1.0)).xyz;
 
     mat4    InvTransModelTransform = transpose(inverse(modelTransform));
-    normal = (InvTransModelTransform * vec4(aNormal, 0.0)).xyz;
-    tangent = (InvTransModelTransform * vec4(aTangent, 0.0)).xyz;
+    normal = (InvTransModelTransform * vec4(GetVertexNormal(), 0.0)).xyz;
+    vec4    vertexTangent = GetVertexTangent();
+    tangent = vec4((InvTransModelTransform * vec4(vertexTangent.xyz, 0.0)).xyz, vertexTangent.w);
 }
\ No newline at end of file